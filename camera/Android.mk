@@ -17,18 +17,30 @@
 
 LOCAL_PATH := $(call my-dir)
 
-include $(CLEAR_VARS)
-
-LOCAL_SRC_FILES := \
+exynos_camera_src_files := \
 	exynos_camera.c \
+	exynos_convert.c \
 	exynos_exif.c \
+	exynos_jpeg.c \
+	exynos_memory.c \
 	exynos_param.c \
+	exynos_scale.c \
+	exynos_stats.c \
 	exynos_v4l2.c
 
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := $(exynos_camera_src_files)
+
 LOCAL_C_INCLUDES := \
 	system/media/camera/include \
 	hardware/samsung/exynos4/hal/include
 
+ifeq ($(strip $(BOARD_CAMERA_FAKE_V4L2)),true)
+LOCAL_SRC_FILES += exynos_v4l2_fake.c
+LOCAL_CFLAGS += -DEXYNOS_CAMERA_FAKE_V4L2
+endif
+
 LOCAL_SHARED_LIBRARIES := libutils libcutils liblog libcamera_client libhardware libs5pjpeg
 LOCAL_PRELINK_MODULE := false
 
@@ -38,3 +50,41 @@ LOCAL_MODULE_TAGS := optional
 LOCAL_VENDOR_MODULE := true
 
 include $(BUILD_SHARED_LIBRARY)
+
+ifeq ($(strip $(BOARD_CAMERA_FAKE_V4L2)),true)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := exynos_camera_bench.c
+
+LOCAL_SHARED_LIBRARIES := libcutils libhardware
+
+LOCAL_MODULE := exynos_camera_bench
+LOCAL_MODULE_TAGS := optional
+LOCAL_VENDOR_MODULE := true
+
+include $(BUILD_EXECUTABLE)
+
+# HAL internals checks, linked with the HAL sources
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+	$(exynos_camera_src_files) \
+	exynos_v4l2_fake.c \
+	exynos_camera_test.c
+
+LOCAL_C_INCLUDES := \
+	system/media/camera/include \
+	hardware/samsung/exynos4/hal/include
+
+LOCAL_CFLAGS += -DEXYNOS_CAMERA_FAKE_V4L2
+
+LOCAL_SHARED_LIBRARIES := libutils libcutils liblog libcamera_client libhardware libs5pjpeg
+
+LOCAL_MODULE := exynos_camera_test
+LOCAL_MODULE_TAGS := optional
+LOCAL_VENDOR_MODULE := true
+
+include $(BUILD_EXECUTABLE)
+
+endif
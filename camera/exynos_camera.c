@@ -77,7 +77,7 @@ struct exynos_camera_preset exynos_camera_presets_galaxys2[] = {
 			.jpeg_thumbnail_quality = 100,
 			.jpeg_quality = 90,
 
-			.video_snapshot_supported = 0,
+			.video_snapshot_supported = 1,
 			.full_video_snap_supported = 0,
 
 			.recording_size = "1280x720",
@@ -85,7 +85,7 @@ struct exynos_camera_preset exynos_camera_presets_galaxys2[] = {
 			.recording_format = "yuv420sp",
 
 			.focus_mode = "auto",
-			.focus_mode_values = "auto,infinity,macro,fixed,facedetect,continuous-video",
+			.focus_mode_values = "auto,infinity,macro,fixed,facedetect,continuous-video,continuous-picture",
 			.focus_distances = "0.15,1.20,Infinity",
 			.focus_areas = "(0,0,0,0,0)",
 			.max_num_focus_areas = 1,
@@ -150,7 +150,7 @@ struct exynos_camera_preset exynos_camera_presets_galaxys2[] = {
 			.jpeg_thumbnail_quality = 100,
 			.jpeg_quality = 90,
 
-			.video_snapshot_supported = 0,
+			.video_snapshot_supported = 1,
 			.full_video_snap_supported = 0,
 
 			.recording_size = "640x480",
@@ -222,9 +222,12 @@ struct exynox_camera_config exynos_camera_config_galaxys2 = {
 struct exynox_camera_config *exynos_camera_config =
 	&exynos_camera_config_galaxys2;
 
+// The sensor firmware doesn't change while the HAL is loaded
+static char exynos_camera_firmware_versions[EXYNOS_CAMERA_MAX_PRESETS_COUNT][7];
+static int exynos_camera_firmware_read[EXYNOS_CAMERA_MAX_PRESETS_COUNT];
+
 int exynos_camera_init(struct exynos_camera *exynos_camera, int id)
 {
-	char firmware_version[7] = { 0 };
 	struct exynos_v4l2_ext_control control;
 	int rc;
 
@@ -256,42 +259,37 @@ int exynos_camera_init(struct exynos_camera *exynos_camera, int id)
 		return -1;
 	}
 
-	// Init FIMC2
-	rc = exynos_v4l2_open(exynos_camera, 2);
-	if (rc < 0) {
-		ALOGE("Unable to open v4l2 device");
-		return -1;
-	}
+	exynos_camera->id = id;
 
-	rc = exynos_v4l2_querycap_cap(exynos_camera, 2);
-	if (rc < 0) {
-		ALOGE("%s: querycap failed", __func__);
-		return -1;
-	}
+	// FIMC2 is only opened when recording is about to be used
 
-	rc = exynos_v4l2_enum_input(exynos_camera, 2, id);
-	if (rc < 0) {
-		ALOGE("%s: enum input failed", __func__);
-		return -1;
-	}
+	// Get firmware information
+	if (!exynos_camera_firmware_read[id]) {
+		memset(&control, 0, sizeof(control));
+		control.id = V4L2_CID_CAM_SENSOR_FW_VER;
+		control.data.string = exynos_camera_firmware_versions[id];
 
-	rc = exynos_v4l2_s_input(exynos_camera, 2, id);
-	if (rc < 0) {
-		ALOGE("%s: s input failed", __func__);
-		return -1;
+		rc = exynos_v4l2_g_ext_ctrls(exynos_camera, 0, (struct v4l2_ext_control *) &control, 1);
+		if (rc < 0) {
+			ALOGE("%s: g ext ctrls failed", __func__);
+			exynos_camera_firmware_versions[id][0] = '\0';
+		} else {
+			exynos_camera_firmware_read[id] = 1;
+		}
 	}
 
-	// Get firmware information
-	memset(&control, 0, sizeof(control));
-	control.id = V4L2_CID_CAM_SENSOR_FW_VER;
-	control.data.string = firmware_version;
+	if (exynos_camera_firmware_versions[id][0] != '\0')
+		ALOGD("Firmware version: %s", exynos_camera_firmware_versions[id]);
 
-	rc = exynos_v4l2_g_ext_ctrls(exynos_camera, 0, (struct v4l2_ext_control *) &control, 1);
-	if (rc < 0) {
-		ALOGE("%s: g ext ctrls failed", __func__);
-	} else {
-		ALOGD("Firmware version: %s", firmware_version);
-	}
+	pthread_mutex_init(&exynos_camera->auto_focus_mutex, NULL);
+	pthread_mutex_init(&exynos_camera->exif_mutex, NULL);
+	pthread_mutex_init(&exynos_camera->params_deferred_ctrls_mutex, NULL);
+	pthread_mutex_init(&exynos_camera->params_mutex, NULL);
+	pthread_mutex_init(&exynos_camera->picture_snapshot_mutex, NULL);
+
+	exynos_memory_pool_init(exynos_camera);
+
+	exynos_camera->initialized = 1;
 
 	// Params
 	rc = exynos_camera_params_init(exynos_camera, id);
@@ -315,7 +313,77 @@ void exynos_camera_deinit(struct exynos_camera *exynos_camera)
 		return;
 
 	exynos_v4l2_close(exynos_camera, 0);
+
+	if (exynos_camera->recording_node_opened) {
+		exynos_v4l2_close(exynos_camera, 2);
+		exynos_camera->recording_node_opened = 0;
+	}
+
+	if (!exynos_camera->initialized)
+		return;
+
+	// The snapshot worker still uses the encoder
+	exynos_camera_picture_snapshot_stop(exynos_camera);
+
+	exynos_jpeg_stop(exynos_camera);
+	exynos_exif_template_release(exynos_camera);
+
+	pthread_mutex_destroy(&exynos_camera->auto_focus_mutex);
+	pthread_mutex_destroy(&exynos_camera->exif_mutex);
+	pthread_mutex_destroy(&exynos_camera->params_deferred_ctrls_mutex);
+	pthread_mutex_destroy(&exynos_camera->params_mutex);
+	pthread_mutex_destroy(&exynos_camera->picture_snapshot_mutex);
+
+	exynos_memory_pool_deinit(exynos_camera);
+
+	exynos_params_deinit(exynos_camera);
+
+	exynos_camera->initialized = 0;
+}
+
+int exynos_camera_recording_node_init(struct exynos_camera *exynos_camera)
+{
+	int rc;
+
+	if (exynos_camera == NULL)
+		return -EINVAL;
+
+	if (exynos_camera->recording_node_opened)
+		return 0;
+
+	// Init FIMC2
+	rc = exynos_v4l2_open(exynos_camera, 2);
+	if (rc < 0) {
+		ALOGE("Unable to open v4l2 device");
+		return -1;
+	}
+
+	rc = exynos_v4l2_querycap_cap(exynos_camera, 2);
+	if (rc < 0) {
+		ALOGE("%s: querycap failed", __func__);
+		goto error;
+	}
+
+	rc = exynos_v4l2_enum_input(exynos_camera, 2, exynos_camera->id);
+	if (rc < 0) {
+		ALOGE("%s: enum input failed", __func__);
+		goto error;
+	}
+
+	rc = exynos_v4l2_s_input(exynos_camera, 2, exynos_camera->id);
+	if (rc < 0) {
+		ALOGE("%s: s input failed", __func__);
+		goto error;
+	}
+
+	exynos_camera->recording_node_opened = 1;
+
+	return 0;
+
+error:
 	exynos_v4l2_close(exynos_camera, 2);
+
+	return -1;
 }
 
 // Params
@@ -327,6 +395,12 @@ int exynos_camera_params_init(struct exynos_camera *exynos_camera, int id)
 	if (exynos_camera == NULL || id >= exynos_camera->config->presets_count)
 		return -EINVAL;
 
+	rc = exynos_params_init(exynos_camera);
+	if (rc < 0) {
+		ALOGE("%s: Unable to init params store", __func__);
+		return -1;
+	}
+
 	// Camera params
 	exynos_camera->camera_rotation = exynos_camera->config->presets[id].rotation;
 	exynos_camera->camera_hflip = exynos_camera->config->presets[id].hflip;
@@ -336,137 +410,138 @@ int exynos_camera_params_init(struct exynos_camera *exynos_camera, int id)
 	exynos_camera->camera_metering = exynos_camera->config->presets[id].metering;
 
 	// Recording preview
-	exynos_param_string_set(exynos_camera, "preferred-preview-size-for-video",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PREFERRED_PREVIEW_SIZE_FOR_VIDEO,
 		exynos_camera->config->presets[id].params.preview_size);
 
 	// Preview
-	exynos_param_string_set(exynos_camera, "preview-size-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_SIZE_VALUES,
 		exynos_camera->config->presets[id].params.preview_size_values);
-	exynos_param_string_set(exynos_camera, "preview-size",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_SIZE,
 		exynos_camera->config->presets[id].params.preview_size);
-	exynos_param_string_set(exynos_camera, "preview-format-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_FORMAT_VALUES,
 		exynos_camera->config->presets[id].params.preview_format_values);
-	exynos_param_string_set(exynos_camera, "preview-format",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_FORMAT,
 		exynos_camera->config->presets[id].params.preview_format);
-	exynos_param_string_set(exynos_camera, "preview-frame-rate-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_FRAME_RATE_VALUES,
 		exynos_camera->config->presets[id].params.preview_frame_rate_values);
-	exynos_param_int_set(exynos_camera, "preview-frame-rate",
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_FRAME_RATE,
 		exynos_camera->config->presets[id].params.preview_frame_rate);
-	exynos_param_string_set(exynos_camera, "preview-fps-range-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_FPS_RANGE_VALUES,
 		exynos_camera->config->presets[id].params.preview_fps_range_values);
-	exynos_param_string_set(exynos_camera, "preview-fps-range",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_FPS_RANGE,
 		exynos_camera->config->presets[id].params.preview_fps_range);
 
 	// Picture
-	exynos_param_string_set(exynos_camera, "picture-size-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PICTURE_SIZE_VALUES,
 		exynos_camera->config->presets[id].params.picture_size_values);
-	exynos_param_string_set(exynos_camera, "picture-size",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PICTURE_SIZE,
 		exynos_camera->config->presets[id].params.picture_size);
-	exynos_param_string_set(exynos_camera, "picture-format-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PICTURE_FORMAT_VALUES,
 		exynos_camera->config->presets[id].params.picture_format_values);
-	exynos_param_string_set(exynos_camera, "picture-format",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_PICTURE_FORMAT,
 		exynos_camera->config->presets[id].params.picture_format);
-	exynos_param_string_set(exynos_camera, "jpeg-thumbnail-size-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_SIZE_VALUES,
 		exynos_camera->config->presets[id].params.jpeg_thumbnail_size_values);
-	exynos_param_int_set(exynos_camera, "jpeg-thumbnail-width",
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_WIDTH,
 		exynos_camera->config->presets[id].params.jpeg_thumbnail_width);
-	exynos_param_int_set(exynos_camera, "jpeg-thumbnail-height",
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_HEIGHT,
 		exynos_camera->config->presets[id].params.jpeg_thumbnail_height);
-	exynos_param_int_set(exynos_camera, "jpeg-thumbnail-quality",
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_QUALITY,
 		exynos_camera->config->presets[id].params.jpeg_thumbnail_quality);
-	exynos_param_int_set(exynos_camera, "jpeg-quality",
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_JPEG_QUALITY,
 		exynos_camera->config->presets[id].params.jpeg_quality);
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_NUM_SNAPS_PER_SHUTTER, 1);
 
 	if (exynos_camera->config->presets[id].params.video_snapshot_supported == 1)
-		exynos_param_string_set(exynos_camera, "video-snapshot-supported", "true");
+		exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_VIDEO_SNAPSHOT_SUPPORTED, "true");
 	else
-		exynos_param_string_set(exynos_camera, "video-snapshot-supported", "false");
+		exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_VIDEO_SNAPSHOT_SUPPORTED, "false");
 
 	if (exynos_camera->config->presets[id].params.full_video_snap_supported == 1)
-		exynos_param_string_set(exynos_camera, "full-video-snap-supported", "true");
+		exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FULL_VIDEO_SNAP_SUPPORTED, "true");
 	else
-		exynos_param_string_set(exynos_camera, "full-video-snap-supported", "false");
+		exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FULL_VIDEO_SNAP_SUPPORTED, "false");
 
 	// Recording
-	exynos_param_string_set(exynos_camera, "video-size",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_VIDEO_SIZE,
 		exynos_camera->config->presets[id].params.recording_size);
-	exynos_param_string_set(exynos_camera, "video-size-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_VIDEO_SIZE_VALUES,
 		exynos_camera->config->presets[id].params.recording_size_values);
-	exynos_param_string_set(exynos_camera, "video-frame-format",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_VIDEO_FRAME_FORMAT,
 		exynos_camera->config->presets[id].params.recording_format);
 
 	// Focus
-	exynos_param_string_set(exynos_camera, "focus-mode",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_MODE,
 		exynos_camera->config->presets[id].params.focus_mode);
-	exynos_param_string_set(exynos_camera, "focus-mode-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_MODE_VALUES,
 		exynos_camera->config->presets[id].params.focus_mode_values);
-	exynos_param_string_set(exynos_camera, "focus-distances",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_DISTANCES,
 		exynos_camera->config->presets[id].params.focus_distances);
 	if (exynos_camera->config->presets[id].params.max_num_focus_areas > 0) {
-		exynos_param_string_set(exynos_camera, "focus-areas",
+		exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_AREAS,
 			exynos_camera->config->presets[id].params.focus_areas);
-		exynos_param_int_set(exynos_camera, "max-num-focus-areas",
+		exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_MAX_NUM_FOCUS_AREAS,
 			exynos_camera->config->presets[id].params.max_num_focus_areas);
 	}
-	exynos_param_string_set(exynos_camera, "touch-af-aec",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_TOUCH_AF_AEC,
 		exynos_camera->config->presets[id].params.touch_af_aec);
 
 	// Zoom
-	exynos_param_string_set(exynos_camera, "zoom-supported",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM_SUPPORTED,
 		exynos_camera->config->presets[id].params.zoom_supported == 1 ? "true" : "false");
-	exynos_param_string_set(exynos_camera, "smooth-zoom-supported",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_SMOOTH_ZOOM_SUPPORTED,
 		exynos_camera->config->presets[id].params.smooth_zoom_supported == 1 ? "true": "false");
-	exynos_param_string_set(exynos_camera, "zoom-ratios",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM_RATIOS,
 		exynos_camera->config->presets[id].params.zoom_ratios);
-	exynos_param_int_set(exynos_camera, "zoom", exynos_camera->config->presets[id].params.zoom);
-	exynos_param_int_set(exynos_camera, "max-zoom", exynos_camera->config->presets[id].params.max_zoom);
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM, exynos_camera->config->presets[id].params.zoom);
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_MAX_ZOOM, exynos_camera->config->presets[id].params.max_zoom);
 
 	// Flash
-	exynos_param_string_set(exynos_camera, "flash-mode",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FLASH_MODE,
 		exynos_camera->config->presets[id].params.flash_mode);
-	exynos_param_string_set(exynos_camera, "flash-mode-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FLASH_MODE_VALUES,
 		exynos_camera->config->presets[id].params.flash_mode_values);
 
 	// Exposure
-	exynos_param_int_set(exynos_camera, "exposure-compensation",
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION,
 		exynos_camera->config->presets[id].params.exposure_compensation);
-	exynos_param_float_set(exynos_camera, "exposure-compensation-step",
+	exynos_param_float_set_id(exynos_camera, EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION_STEP,
 		exynos_camera->config->presets[id].params.exposure_compensation_step);
-	exynos_param_int_set(exynos_camera, "min-exposure-compensation",
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_MIN_EXPOSURE_COMPENSATION,
 		exynos_camera->config->presets[id].params.min_exposure_compensation);
-	exynos_param_int_set(exynos_camera, "max-exposure-compensation",
+	exynos_param_int_set_id(exynos_camera, EXYNOS_PARAM_KEY_MAX_EXPOSURE_COMPENSATION,
 		exynos_camera->config->presets[id].params.max_exposure_compensation);
 
 	// WB
-	exynos_param_string_set(exynos_camera, "whitebalance",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_WHITEBALANCE,
 		exynos_camera->config->presets[id].params.whitebalance);
-	exynos_param_string_set(exynos_camera, "whitebalance-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_WHITEBALANCE_VALUES,
 		exynos_camera->config->presets[id].params.whitebalance_values);
 
 	// Scene mode
-	exynos_param_string_set(exynos_camera, "scene-mode",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_SCENE_MODE,
 		exynos_camera->config->presets[id].params.scene_mode);
-	exynos_param_string_set(exynos_camera, "scene-mode-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_SCENE_MODE_VALUES,
 		exynos_camera->config->presets[id].params.scene_mode_values);
 
 	// Effect
-	exynos_param_string_set(exynos_camera, "effect",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_EFFECT,
 		exynos_camera->config->presets[id].params.effect);
-	exynos_param_string_set(exynos_camera, "effect-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_EFFECT_VALUES,
 		exynos_camera->config->presets[id].params.effect_values);
 
 	// ISO
-	exynos_param_string_set(exynos_camera, "iso",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_ISO,
 		exynos_camera->config->presets[id].params.iso);
-	exynos_param_string_set(exynos_camera, "iso-values",
+	exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_ISO_VALUES,
 		exynos_camera->config->presets[id].params.iso_values);
 
 	// Camera
-	exynos_param_float_set(exynos_camera, "focal-length",
+	exynos_param_float_set_id(exynos_camera, EXYNOS_PARAM_KEY_FOCAL_LENGTH,
 		exynos_camera->config->presets[id].focal_length);
-	exynos_param_float_set(exynos_camera, "horizontal-view-angle",
+	exynos_param_float_set_id(exynos_camera, EXYNOS_PARAM_KEY_HORIZONTAL_VIEW_ANGLE,
 		exynos_camera->config->presets[id].horizontal_view_angle);
-	exynos_param_float_set(exynos_camera, "vertical-view-angle",
+	exynos_param_float_set_id(exynos_camera, EXYNOS_PARAM_KEY_VERTICAL_VIEW_ANGLE,
 		exynos_camera->config->presets[id].vertical_view_angle);
 
 	rc = exynos_camera_params_apply(exynos_camera);
@@ -489,7 +564,7 @@ void exynos_camera_get_supported_preview_size(struct exynos_camera *exynos_camer
 
 	ALOGD("%s: Find supported preview-size for %d x %d", __func__, preview_width, preview_height);
 
-	k = exynos_param_string_get(exynos_camera, "preview-size-values");
+	k = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_SIZE_VALUES);
 	while (preview_width != 0 && preview_height != 0) {
 		if (k == NULL)
 			break;
@@ -526,6 +601,38 @@ void exynos_camera_get_supported_preview_size(struct exynos_camera *exynos_camer
 	}
 }
 
+static int exynos_camera_params_ctrl_defer(struct exynos_camera *exynos_camera,
+	int id, int value)
+{
+	int rc;
+
+	pthread_mutex_lock(&exynos_camera->params_deferred_ctrls_mutex);
+
+	rc = exynos_v4l2_ctrls_defer(&exynos_camera->params_deferred_ctrls, id, value);
+	if (rc < 0) {
+		exynos_v4l2_ctrls_flush(exynos_camera, 0, &exynos_camera->params_deferred_ctrls);
+		rc = exynos_v4l2_ctrls_defer(&exynos_camera->params_deferred_ctrls, id, value);
+	}
+
+	pthread_mutex_unlock(&exynos_camera->params_deferred_ctrls_mutex);
+
+	return rc;
+}
+
+int exynos_camera_params_deferred_ctrls_flush(struct exynos_camera *exynos_camera)
+{
+	int rc;
+
+	if (exynos_camera == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&exynos_camera->params_deferred_ctrls_mutex);
+	rc = exynos_v4l2_ctrls_flush(exynos_camera, 0, &exynos_camera->params_deferred_ctrls);
+	pthread_mutex_unlock(&exynos_camera->params_deferred_ctrls_mutex);
+
+	return rc;
+}
+
 int exynos_camera_params_set_scene_mode(struct exynos_camera *exynos_camera, int force)
 {
 	char *scene_mode_string;
@@ -534,7 +641,7 @@ int exynos_camera_params_set_scene_mode(struct exynos_camera *exynos_camera, int
 	int rc = 0;
 
 	// Scene mode
-	scene_mode_string = exynos_param_string_get(exynos_camera, "scene-mode");
+	scene_mode_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_SCENE_MODE);
 	if (scene_mode_string != NULL) {
 		if (strcmp(scene_mode_string, "auto") == 0)
 			scene_mode = SCENE_MODE_NONE;
@@ -575,13 +682,13 @@ int exynos_camera_params_set_scene_mode(struct exynos_camera *exynos_camera, int
 			// Set focus-mode temporary to 'continuous' if not set
 			// This sets actually the camera in full automatic-mode
 			// (like exposure, focus and probably other things)
-			focus_mode_string = exynos_param_string_get(exynos_camera, "focus-mode");
+			focus_mode_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_MODE);
 			if (strcmp(focus_mode_string, "continuous-video") != 0 &&
 				!exynos_camera->recording_enabled)
-				exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_FOCUS_MODE, FOCUS_MODE_CONTINOUS);
+				exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_FOCUS_MODE, FOCUS_MODE_CONTINOUS);
 
 			ALOGD("%s: scene-mode => %d %s", __func__, exynos_camera->scene_mode, scene_mode_string);
-			rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_SCENE_MODE, scene_mode);
+			rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_SCENE_MODE, scene_mode);
 			if (rc < 0)
 				ALOGE("%s: s ctrl failed!", __func__);
 
@@ -598,9 +705,10 @@ int exynos_camera_params_set_focus_mode(struct exynos_camera *exynos_camera, int
 {
 	char *focus_mode_string;
 	int focus_mode = 0;
+	int recording_paused = 0;
 	int rc = 0;
 
-	focus_mode_string = exynos_param_string_get(exynos_camera, "focus-mode");
+	focus_mode_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_MODE);
 	if (focus_mode_string != NULL) {
 		if (focus_mode == 0) {
 			if (strcmp(focus_mode_string, "auto") == 0)
@@ -622,7 +730,13 @@ int exynos_camera_params_set_focus_mode(struct exynos_camera *exynos_camera, int
 		}
 
 		if (focus_mode != exynos_camera->focus_mode || force) {
+			// Controls queued before have to be set first
+			exynos_camera_params_deferred_ctrls_flush(exynos_camera);
+
 			if (exynos_camera->recording_enabled) {
+				pthread_mutex_lock(&exynos_camera->recording_mutex);
+				recording_paused = 1;
+
 				ALOGE("%s: Pausing recording", __func__);
 
 				//Stop recording the stream.
@@ -638,15 +752,18 @@ int exynos_camera_params_set_focus_mode(struct exynos_camera *exynos_camera, int
 			} else {
 				exynos_camera->focus_mode = focus_mode;
 			}
-			if (exynos_camera->recording_enabled) {
+			if (recording_paused) {
 				ALOGE("%s: Resuming recording", __func__);
 				rc = exynos_v4l2_streamon_cap(exynos_camera, 2);
+
+				pthread_mutex_unlock(&exynos_camera->recording_mutex);
+
 				if (rc < 0) {
 					ALOGE("%s: streamon failed!", __func__);
 				} else {
 					// Scene mode
 					char *scene_mode_string;
-					scene_mode_string = exynos_param_string_get(exynos_camera, "scene-mode");
+					scene_mode_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_SCENE_MODE);
 					if (scene_mode_string != NULL &&
 						strcmp(scene_mode_string, "auto") != 0) {
 							ALOGE("%s: Forcing scene-mode %a after recording", __func__, scene_mode_string);
@@ -663,86 +780,18 @@ int exynos_camera_params_set_focus_mode(struct exynos_camera *exynos_camera, int
 
 	return rc;
 }
-int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
-{
-	char *recording_hint_string;
-	char *recording_preview_size_string;
 
+int exynos_camera_params_apply_preview_size(struct exynos_camera *exynos_camera, int force)
+{
 	char *preview_size_string;
 	int preview_width = 0;
 	int preview_height = 0;
-	char *preview_format_string;
-	int preview_format;
-	float preview_format_bpp;
-	int preview_fps;
-
-	char *picture_size_string;
-	int picture_width = 0;
-	int picture_height = 0;
-	char *picture_format_string;
-	int picture_format;
-
-	int jpeg_thumbnail_width;
-	int jpeg_thumbnail_height;
-	int jpeg_thumbnail_quality;
-	int jpeg_quality;
-
-	char *video_size_string;
-	int recording_width = 0;
-	int recording_height = 0;
-	char *video_frame_format_string;
-	int recording_format;
-	int camera_sensor_mode;
+	int preview_supported_width, preview_supported_height;
 	int camera_sensor_output_size;
-
-	char *focus_mode_string;
-	char *focus_areas_string;
-	int focus_left, focus_top, focus_right, focus_bottom, focus_weigth;
-	int focus_x;
-	int focus_y;
-
-	char *zoom_supported_string;
-	int zoom, max_zoom;
-
-	char *flash_mode_string;
-	int flash_mode;
-
-	int exposure_compensation;
-	int min_exposure_compensation;
-	int max_exposure_compensation;
-
-	char *whitebalance_string;
-	int whitebalance;
-
-	char *effect_string;
-	int effect;
-
-	char *iso_string;
-	int iso;
-
-	int force = 0;
-
-	int w, h, preview_supported_width, preview_supported_height;
-	char *k;
-	int rc;
-
 	bool isChanged = false;
-	bool recordingSizeChanged = false;
-
-	ALOGD("%s: Start", __func__);
-
-
-	if (exynos_camera == NULL)
-		return -EINVAL;
-
-	if (!exynos_camera->preview_params_set) {
-		ALOGE("%s: Setting preview params", __func__);
-		exynos_camera->preview_params_set = 1;
-		force = 1;
-	}
+	int rc;
 
-	// Preview
-	preview_size_string = exynos_param_string_get(exynos_camera, "preview-size");
+	preview_size_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_SIZE);
 	if (preview_size_string != NULL) {
 		sscanf(preview_size_string, "%dx%d", &preview_width, &preview_height);
 
@@ -762,14 +811,21 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		ALOGD("%s: Preview-size => %d x %d", __func__, exynos_camera->preview_width, exynos_camera->preview_height);
 		ALOGD("%s: camera_sensor_output_size => %dx%d", __func__, exynos_camera->preview_width, exynos_camera->preview_height);
 		camera_sensor_output_size = ((exynos_camera->preview_width & 0xffff) << 16) | (exynos_camera->preview_height & 0xffff);
-		rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_SENSOR_OUTPUT_SIZE, camera_sensor_output_size);
+		rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_SENSOR_OUTPUT_SIZE, camera_sensor_output_size);
 		if (rc < 0)
 			ALOGE("%s: s ctrl failed!", __func__);
-
-		isChanged = false;
 	}
 
-	preview_format_string = exynos_param_string_get(exynos_camera, "preview-format");
+	return 0;
+}
+
+int exynos_camera_params_apply_preview_format(struct exynos_camera *exynos_camera, int force)
+{
+	char *preview_format_string;
+	int preview_format;
+	float preview_format_bpp;
+
+	preview_format_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_FORMAT);
 	if (preview_format_string != NULL) {
 		if (strcmp(preview_format_string, "yuv420sp") == 0) {
 			preview_format = V4L2_PIX_FMT_NV21;
@@ -796,7 +852,14 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		}
 	}
 
-	preview_fps = exynos_param_int_get(exynos_camera, "preview-frame-rate");
+	return 0;
+}
+
+int exynos_camera_params_apply_preview_fps(struct exynos_camera *exynos_camera, int force)
+{
+	int preview_fps;
+
+	preview_fps = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_PREVIEW_FRAME_RATE);
 	if (preview_fps != exynos_camera->preview_fps) {
 		if (preview_fps > 0)
 			exynos_camera->preview_fps = preview_fps;
@@ -805,8 +868,15 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		ALOGD("%s: preview-fps => %d ", __func__, preview_fps);
 	}
 
-	// Picture
-	picture_format_string = exynos_param_string_get(exynos_camera, "picture-format");
+	return 0;
+}
+
+int exynos_camera_params_apply_picture_format(struct exynos_camera *exynos_camera, int force)
+{
+	char *picture_format_string;
+	int picture_format;
+
+	picture_format_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_PICTURE_FORMAT);
 	if (picture_format_string != NULL) {
 		if (strcmp(picture_format_string, "jpeg") == 0) {
 			picture_format = V4L2_PIX_FMT_JPEG;
@@ -821,7 +891,17 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		}
 	}
 
-	picture_size_string = exynos_param_string_get(exynos_camera, "picture-size");
+	return 0;
+}
+
+int exynos_camera_params_apply_picture_size(struct exynos_camera *exynos_camera, int force)
+{
+	char *picture_size_string;
+	int picture_width = 0;
+	int picture_height = 0;
+	bool isChanged = false;
+
+	picture_size_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_PICTURE_SIZE);
 	if (picture_size_string != NULL) {
 		sscanf(picture_size_string, "%dx%d", &picture_width, &picture_height);
 
@@ -835,45 +915,92 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 			isChanged = true;
 		}
 	}
-	if (isChanged) {
+	if (isChanged)
 		ALOGD("%s: picture-size => %d x %d", __func__, exynos_camera->picture_width, exynos_camera->picture_height);
-		isChanged = false;
-	}
 
+	return 0;
+}
+
+int exynos_camera_params_apply_jpeg_thumbnail(struct exynos_camera *exynos_camera, int force)
+{
+	int jpeg_thumbnail_width;
+	int jpeg_thumbnail_height;
+	int jpeg_thumbnail_quality;
+	bool isChanged = false;
 
-	jpeg_thumbnail_width = exynos_param_int_get(exynos_camera, "jpeg-thumbnail-width");
+	jpeg_thumbnail_width = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_WIDTH);
 	if (jpeg_thumbnail_width > 0 && jpeg_thumbnail_width != exynos_camera->jpeg_thumbnail_width) {
 		exynos_camera->jpeg_thumbnail_width = jpeg_thumbnail_width;
 		isChanged = true;
 	}
 
-	jpeg_thumbnail_height = exynos_param_int_get(exynos_camera, "jpeg-thumbnail-height");
+	jpeg_thumbnail_height = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_HEIGHT);
 	if (jpeg_thumbnail_height > 0 && jpeg_thumbnail_height != exynos_camera->jpeg_thumbnail_height) {
 		exynos_camera->jpeg_thumbnail_height = jpeg_thumbnail_height;
 		isChanged = true;
 	}
-	if (isChanged) {
+	if (isChanged)
 		ALOGD("%s: jpeg-thumbnail => %d x %d", __func__, exynos_camera->jpeg_thumbnail_width, exynos_camera->jpeg_thumbnail_height);
-		isChanged = false;
-	}
 
-	jpeg_thumbnail_quality = exynos_param_int_get(exynos_camera, "jpeg-thumbnail-quality");
+	jpeg_thumbnail_quality = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_QUALITY);
 	if ((exynos_camera->jpeg_thumbnail_quality != jpeg_thumbnail_quality) && (jpeg_thumbnail_quality > 0)) {
 		exynos_camera->jpeg_thumbnail_quality = jpeg_thumbnail_quality;
 		ALOGD("%s: jpeg-thumbnail-quality => %d", __func__, jpeg_thumbnail_quality);
 	}
-	jpeg_quality = exynos_param_int_get(exynos_camera, "jpeg-quality");
+
+	return 0;
+}
+
+int exynos_camera_params_apply_jpeg_quality(struct exynos_camera *exynos_camera, int force)
+{
+	int jpeg_quality;
+	int rc;
+
+	jpeg_quality = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_JPEG_QUALITY);
 	if (jpeg_quality <= 100 && jpeg_quality >= 0 && (jpeg_quality != exynos_camera->jpeg_quality || force)) {
 		exynos_camera->jpeg_quality = jpeg_quality;
 		ALOGD("%s: jpeg-quality => %d", __func__, jpeg_quality);
 
-		rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAM_JPEG_QUALITY, jpeg_quality);
+		rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAM_JPEG_QUALITY, jpeg_quality);
 		if (rc < 0)
 			ALOGE("%s: s ctrl failed!", __func__);
 	}
 
-	// Recording
-	video_size_string = exynos_param_string_get(exynos_camera, "video-size");
+	return 0;
+}
+
+/*
+ * CameraClient keeps COMPRESSED_IMAGE enabled for num-snaps-per-shutter
+ * pictures and drops SHUTTER after the first one, so the burst follows it.
+ */
+int exynos_camera_params_apply_burst_capture(struct exynos_camera *exynos_camera, int force)
+{
+	int burst_capture;
+
+	burst_capture = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_NUM_SNAPS_PER_SHUTTER);
+	if (burst_capture < 1)
+		burst_capture = 1;
+	else if (burst_capture > EXYNOS_CAMERA_BURST_MAX)
+		burst_capture = EXYNOS_CAMERA_BURST_MAX;
+
+	if (burst_capture != exynos_camera->burst_capture || force) {
+		exynos_camera->burst_capture = burst_capture;
+		ALOGD("%s: num-snaps-per-shutter => %d", __func__, burst_capture);
+	}
+
+	return 0;
+}
+
+int exynos_camera_params_apply_video_size(struct exynos_camera *exynos_camera, int force)
+{
+	char *video_size_string;
+	int recording_width = 0;
+	int recording_height = 0;
+	int camera_sensor_output_size;
+	bool isChanged = false;
+	int rc;
+
+	video_size_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_VIDEO_SIZE);
 	if (video_size_string != NULL) {
 		sscanf(video_size_string, "%dx%d", &recording_width, &recording_height);
 
@@ -887,18 +1014,23 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		}
 	}
 	if (isChanged) {
-		recordingSizeChanged = true;
 		ALOGD("%s: video-size => %d x %d", __func__, exynos_camera->recording_width, exynos_camera->recording_height);
 		ALOGD("%s: camera_sensor_output_size => %dx%d", __func__, exynos_camera->recording_width, exynos_camera->recording_height);
 		camera_sensor_output_size = ((exynos_camera->preview_width & 0xffff) << 16) | (exynos_camera->preview_height & 0xffff);
-		rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_SENSOR_OUTPUT_SIZE, camera_sensor_output_size);
+		rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_SENSOR_OUTPUT_SIZE, camera_sensor_output_size);
 		if (rc < 0)
 			ALOGE("%s: s ctrl failed!", __func__);
-
-		isChanged = false;
 	}
 
-	video_frame_format_string = exynos_param_string_get(exynos_camera, "video-frame-format");
+	return 0;
+}
+
+int exynos_camera_params_apply_video_frame_format(struct exynos_camera *exynos_camera, int force)
+{
+	char *video_frame_format_string;
+	int recording_format;
+
+	video_frame_format_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_VIDEO_FRAME_FORMAT);
 	if (video_frame_format_string != NULL) {
 		if (strcmp(video_frame_format_string, "yuv420sp") == 0) {
 			recording_format = V4L2_PIX_FMT_NV12;
@@ -920,13 +1052,23 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		}
 	}
 
+	return 0;
+}
+
+int exynos_camera_params_apply_sensor_mode(struct exynos_camera *exynos_camera, int force)
+{
+	char *focus_mode_string;
+	char *recording_hint_string;
+	int camera_sensor_mode;
+	int rc;
+
 	// Force recording-hint if focus-mode is in continuous-video
-	focus_mode_string = exynos_param_string_get(exynos_camera, "focus-mode");
-	recording_hint_string = exynos_param_string_get(exynos_camera, "recording-hint");
+	focus_mode_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_MODE);
+	recording_hint_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_RECORDING_HINT);
 	if (focus_mode_string != NULL && (strcmp(focus_mode_string, "continuous-video") == 0)) {
 		if (recording_hint_string == NULL || strcmp(recording_hint_string, "false") == 0) {
 			ALOGD("%s: Force recording-hint => true", __func__);
-			exynos_param_string_set(exynos_camera, "recording-hint", "true");
+			exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_RECORDING_HINT, "true");
 		}
 	}
 
@@ -938,19 +1080,40 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		}
 	}
 
+	// Have FIMC2 ready before recording starts
+	if (camera_sensor_mode == SENSOR_MOVIE) {
+		rc = exynos_camera_recording_node_init(exynos_camera);
+		if (rc < 0)
+			ALOGE("%s: Unable to init recording node", __func__);
+	}
+
 	// Switching modes
 	if (camera_sensor_mode != exynos_camera->camera_sensor_mode) {
 		exynos_camera->camera_sensor_mode = camera_sensor_mode;
 		ALOGD("%s: camera_sensor_mode => %d", __func__, exynos_camera->camera_sensor_mode);
-		rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_SENSOR_MODE, camera_sensor_mode);
+		rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_SENSOR_MODE, camera_sensor_mode);
 		if (rc < 0)
 			ALOGE("%s: s ctrl failed!", __func__);
 	}
 
-	// Focus
-	exynos_camera_params_set_focus_mode(exynos_camera, force);
+	return 0;
+}
+
+int exynos_camera_params_apply_focus_mode(struct exynos_camera *exynos_camera, int force)
+{
+	return exynos_camera_params_set_focus_mode(exynos_camera, force);
+}
+
+int exynos_camera_params_apply_focus_areas(struct exynos_camera *exynos_camera, int force)
+{
+	char *focus_areas_string;
+	int focus_left, focus_top, focus_right, focus_bottom, focus_weigth;
+	int focus_x;
+	int focus_y;
+	bool isChanged = false;
+	int rc;
 
-	focus_areas_string = exynos_param_string_get(exynos_camera, "focus-areas");
+	focus_areas_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_AREAS);
 	if (focus_areas_string != NULL) {
 		focus_left = focus_top = focus_right = focus_bottom = focus_weigth = 0;
 
@@ -959,13 +1122,13 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		if (rc != 5) {
 			ALOGE("%s: sscanf failed!", __func__);
 		} else if (focus_left != 0 && focus_top != 0 && focus_right != 0 && focus_bottom != 0) {
-			focus_x = (((focus_left + focus_right) / 2) + 1000) * preview_width / 2000;
-			focus_y =  (((focus_top + focus_bottom) / 2) + 1000) * preview_height / 2000;
+			focus_x = (((focus_left + focus_right) / 2) + 1000) * exynos_camera->preview_width / 2000;
+			focus_y =  (((focus_top + focus_bottom) / 2) + 1000) * exynos_camera->preview_height / 2000;
 
 			if (focus_x != exynos_camera->focus_x || force) {
 				exynos_camera->focus_x = focus_x;
 				isChanged = true;
-				rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_OBJECT_POSITION_X, focus_x);
+				rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_OBJECT_POSITION_X, focus_x);
 				if (rc < 0)
 					ALOGE("%s: s ctrl failed!", __func__);
 			}
@@ -974,7 +1137,7 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 				exynos_camera->focus_y = focus_y;
 				isChanged = true;
 
-				rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_OBJECT_POSITION_Y, focus_y);
+				rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_OBJECT_POSITION_Y, focus_y);
 				if (rc < 0)
 					ALOGE("%s: s ctrl failed!", __func__);
 			}
@@ -983,37 +1146,52 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 
 				if (exynos_camera->focus_mode != FOCUS_MODE_AUTO) {
 					ALOGD("%s: Forcing focus-mode (s_ctrl) => %d %s ", __func__, FOCUS_MODE_AUTO, "auto");
-					exynos_param_string_set(exynos_camera, "focus-mode", "auto");
-					rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_FOCUS_MODE, FOCUS_MODE_AUTO);
+					exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_MODE, "auto");
+					rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_FOCUS_MODE, FOCUS_MODE_AUTO);
+					if (rc >= 0)
+						exynos_camera->focus_mode = FOCUS_MODE_AUTO;
 				}
 
-				rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_TOUCH_AF_START_STOP, 1);
+				rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_TOUCH_AF_START_STOP, 1);
 				if (rc < 0)
 					ALOGE("%s: s ctrl failed!", __func__);
-
-				isChanged = false;
 			}
 		}
 	}
 
+	return 0;
+}
 
-	// Zoom
-	zoom_supported_string = exynos_param_string_get(exynos_camera, "zoom-supported");
+int exynos_camera_params_apply_zoom(struct exynos_camera *exynos_camera, int force)
+{
+	char *zoom_supported_string;
+	int zoom, max_zoom;
+	int rc;
+
+	zoom_supported_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM_SUPPORTED);
 	if (zoom_supported_string != NULL && strcmp(zoom_supported_string, "true") == 0) {
-		zoom = exynos_param_int_get(exynos_camera, "zoom");
-		max_zoom = exynos_param_int_get(exynos_camera, "max-zoom");
+		zoom = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM);
+		max_zoom = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_MAX_ZOOM);
 		if (zoom <= max_zoom && zoom >= 0 && (zoom != exynos_camera->zoom || force)) {
 			exynos_camera->zoom = zoom;
 			ALOGD("%s: zoom => %d", __func__, exynos_camera->zoom);
-			rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_ZOOM, zoom);
+			rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_ZOOM, zoom);
 			if (rc < 0)
 				ALOGE("%s: s ctrl failed!", __func__);
 		}
 
 	}
 
-	// Flash
-	flash_mode_string = exynos_param_string_get(exynos_camera, "flash-mode");
+	return 0;
+}
+
+int exynos_camera_params_apply_flash_mode(struct exynos_camera *exynos_camera, int force)
+{
+	char *flash_mode_string;
+	int flash_mode;
+	int rc;
+
+	flash_mode_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_FLASH_MODE);
 	if (flash_mode_string != NULL) {
 		if (strcmp(flash_mode_string, "off") == 0)
 			flash_mode = FLASH_MODE_OFF;
@@ -1030,28 +1208,45 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 			exynos_camera->flash_mode = flash_mode;
 			ALOGD("%s: flash-mode => %d %s", __func__, exynos_camera->flash_mode, flash_mode_string);
 
-			rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_FLASH_MODE, flash_mode);
+			rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_FLASH_MODE, flash_mode);
 			if (rc < 0)
 				ALOGE("%s: s ctrl failed!", __func__);
 		}
 	}
 
-	// Exposure
-	exposure_compensation = exynos_param_int_get(exynos_camera, "exposure-compensation");
-	min_exposure_compensation = exynos_param_int_get(exynos_camera, "min-exposure-compensation");
-	max_exposure_compensation = exynos_param_int_get(exynos_camera, "max-exposure-compensation");
+	return 0;
+}
+
+int exynos_camera_params_apply_exposure(struct exynos_camera *exynos_camera, int force)
+{
+	int exposure_compensation;
+	int min_exposure_compensation;
+	int max_exposure_compensation;
+	int rc;
+
+	exposure_compensation = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION);
+	min_exposure_compensation = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_MIN_EXPOSURE_COMPENSATION);
+	max_exposure_compensation = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_MAX_EXPOSURE_COMPENSATION);
 
 	if (exposure_compensation <= max_exposure_compensation && exposure_compensation >= min_exposure_compensation &&
 		(exposure_compensation != exynos_camera->exposure_compensation || force)) {
 		exynos_camera->exposure_compensation = exposure_compensation;
 		ALOGD("%s: exposure-compensation => %d" , __func__, exynos_camera->exposure_compensation);
-		rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_BRIGHTNESS, exposure_compensation);
+		rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_BRIGHTNESS, exposure_compensation);
 		if (rc < 0)
 			ALOGE("%s: s ctrl failed!", __func__);
 	}
 
-	// WB
-	whitebalance_string = exynos_param_string_get(exynos_camera, "whitebalance");
+	return 0;
+}
+
+int exynos_camera_params_apply_whitebalance(struct exynos_camera *exynos_camera, int force)
+{
+	char *whitebalance_string;
+	int whitebalance;
+	int rc;
+
+	whitebalance_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_WHITEBALANCE);
 	if (whitebalance_string != NULL) {
 		if (strcmp(whitebalance_string, "auto") == 0)
 			whitebalance = WHITE_BALANCE_AUTO;
@@ -1069,17 +1264,27 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		if (whitebalance != exynos_camera->whitebalance || force) {
 			exynos_camera->whitebalance = whitebalance;
 			ALOGD("%s: exposure-whitebalance => %d %s" , __func__, exynos_camera->whitebalance, whitebalance_string);
-			rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_WHITE_BALANCE, whitebalance);
+			rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_WHITE_BALANCE, whitebalance);
 			if (rc < 0)
 				ALOGE("%s: s ctrl failed!", __func__);
 		}
 	}
 
-	// Scene-mode
-	exynos_camera_params_set_scene_mode(exynos_camera, force);
+	return 0;
+}
+
+int exynos_camera_params_apply_scene_mode(struct exynos_camera *exynos_camera, int force)
+{
+	return exynos_camera_params_set_scene_mode(exynos_camera, force);
+}
 
-	// Effect
-	effect_string = exynos_param_string_get(exynos_camera, "effect");
+int exynos_camera_params_apply_effect(struct exynos_camera *exynos_camera, int force)
+{
+	char *effect_string;
+	int effect;
+	int rc;
+
+	effect_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_EFFECT);
 	if (effect_string != NULL) {
 		if (strcmp(effect_string, "auto") == 0)
 			effect = IMAGE_EFFECT_NONE;
@@ -1097,14 +1302,22 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		if (effect != exynos_camera->effect || force) {
 			exynos_camera->effect = effect;
 			ALOGD("%s: effect => %d %s", __func__, exynos_camera->effect, effect_string);
-			rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_EFFECT, effect);
+			rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_EFFECT, effect);
 			if (rc < 0)
 				ALOGE("%s: s ctrl failed!", __func__);
 		}
 	}
 
-	// ISO
-	iso_string = exynos_param_string_get(exynos_camera, "iso");
+	return 0;
+}
+
+int exynos_camera_params_apply_iso(struct exynos_camera *exynos_camera, int force)
+{
+	char *iso_string;
+	int iso;
+	int rc;
+
+	iso_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_ISO);
 	if (iso_string != NULL) {
 		if (strcmp(iso_string, "auto") == 0)
 			iso = ISO_AUTO;
@@ -1124,12 +1337,209 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 		if (iso != exynos_camera->iso || force) {
 			exynos_camera->iso = iso;
 			ALOGD("%s: iso => %d %s", __func__, exynos_camera->iso, iso_string);
-			rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_ISO, iso);
+			rc = exynos_camera_params_ctrl_defer(exynos_camera, V4L2_CID_CAMERA_ISO, iso);
 			if (rc < 0)
 				ALOGE("%s: s ctrl failed!", __func__);
 		}
 	}
 
+	return 0;
+}
+
+/*
+ * Handlers are called in this order, only when one of their keys changed
+ * since the last apply (or when all the params have to be set again).
+ */
+
+struct exynos_camera_params_handler exynos_camera_params_handlers[] = {
+	{
+		.keys = { EXYNOS_PARAM_KEY_PREVIEW_SIZE },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_preview_size,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_PREVIEW_FORMAT },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_preview_format,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_PREVIEW_FRAME_RATE },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_preview_fps,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_PICTURE_FORMAT },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_picture_format,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_PICTURE_SIZE },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_picture_size,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_WIDTH, EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_HEIGHT,
+			EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_QUALITY },
+		.keys_count = 3,
+		.apply = exynos_camera_params_apply_jpeg_thumbnail,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_JPEG_QUALITY },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_jpeg_quality,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_NUM_SNAPS_PER_SHUTTER },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_burst_capture,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_VIDEO_SIZE },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_video_size,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_VIDEO_FRAME_FORMAT },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_video_frame_format,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_FOCUS_MODE, EXYNOS_PARAM_KEY_RECORDING_HINT },
+		.keys_count = 2,
+		.apply = exynos_camera_params_apply_sensor_mode,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_FOCUS_MODE },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_focus_mode,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_FOCUS_AREAS },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_focus_areas,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_ZOOM, EXYNOS_PARAM_KEY_MAX_ZOOM, EXYNOS_PARAM_KEY_ZOOM_SUPPORTED },
+		.keys_count = 3,
+		.apply = exynos_camera_params_apply_zoom,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_FLASH_MODE },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_flash_mode,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION, EXYNOS_PARAM_KEY_MIN_EXPOSURE_COMPENSATION,
+			EXYNOS_PARAM_KEY_MAX_EXPOSURE_COMPENSATION },
+		.keys_count = 3,
+		.apply = exynos_camera_params_apply_exposure,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_WHITEBALANCE },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_whitebalance,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_SCENE_MODE },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_scene_mode,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_EFFECT },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_effect,
+	},
+	{
+		.keys = { EXYNOS_PARAM_KEY_ISO },
+		.keys_count = 1,
+		.apply = exynos_camera_params_apply_iso,
+	},
+};
+
+// Runs the handlers of the pending settings, with the params mutex held
+int exynos_camera_params_settings_apply(struct exynos_camera *exynos_camera)
+{
+	struct exynos_camera_params_handler *handler;
+	struct exynos_camera_settings settings;
+	int handlers_count;
+	int apply;
+	int i, j;
+
+	if (exynos_camera == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&exynos_camera->params_mutex);
+
+	if (!exynos_camera->params_settings.pending) {
+		pthread_mutex_unlock(&exynos_camera->params_mutex);
+		return 0;
+	}
+
+	memcpy(&settings, &exynos_camera->params_settings, sizeof(settings));
+	memset(&exynos_camera->params_settings, 0, sizeof(exynos_camera->params_settings));
+
+	handlers_count = sizeof(exynos_camera_params_handlers) / sizeof(struct exynos_camera_params_handler);
+
+	for (i = 0; i < handlers_count; i++) {
+		handler = &exynos_camera_params_handlers[i];
+
+		apply = settings.force;
+		for (j = 0; j < handler->keys_count && !apply; j++)
+			if (settings.dirty[handler->keys[j]])
+				apply = 1;
+
+		if (!apply)
+			continue;
+
+		handler->apply(exynos_camera, settings.force);
+	}
+
+	pthread_mutex_unlock(&exynos_camera->params_mutex);
+
+	return 0;
+}
+
+int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
+{
+	struct exynos_camera_settings *settings;
+	int i;
+
+	ALOGD("%s: Start", __func__);
+
+	if (exynos_camera == NULL)
+		return -EINVAL;
+
+	pthread_mutex_lock(&exynos_camera->params_mutex);
+
+	settings = &exynos_camera->params_settings;
+
+	if (!exynos_camera->preview_params_set) {
+		ALOGE("%s: Setting preview params", __func__);
+		exynos_camera->preview_params_set = 1;
+		settings->force = 1;
+	}
+
+	// Take the dirty keys first, handlers may set keys again
+	for (i = 0; i < EXYNOS_PARAM_KEYS_COUNT; i++) {
+		if (!exynos_param_dirty_get_id(exynos_camera, i))
+			continue;
+
+		exynos_param_dirty_clear_id(exynos_camera, i);
+		settings->dirty[i] = 1;
+		settings->pending = 1;
+	}
+
+	if (settings->force)
+		settings->pending = 1;
+
+	pthread_mutex_unlock(&exynos_camera->params_mutex);
+
+	// Otherwise, the preview thread applies them on the next frame boundary
+	if (!exynos_camera->preview_thread_running) {
+		exynos_camera_params_settings_apply(exynos_camera);
+		exynos_camera_params_deferred_ctrls_flush(exynos_camera);
+	}
+
 	ALOGD("%s: End", __func__);
 
 	return 0;
@@ -1137,367 +1547,312 @@ int exynos_camera_params_apply(struct exynos_camera *exynos_camera)
 
 // Picture
 
-int exynos_camera_picture(struct exynos_camera *exynos_camera)
+// Encodes the raw picture in the encoder input buffer and its thumbnail
+static int exynos_camera_picture_encode(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame, int format, void *jpeg_in_buffer,
+	void **picture_addr, int *picture_size)
 {
-	camera_memory_t *data_memory = NULL;
-	camera_memory_t *exif_data_memory = NULL;
-	camera_memory_t *picture_data_memory = NULL;
 	camera_memory_t *jpeg_thumbnail_data_memory = NULL;
 
-	int camera_picture_format;
-	int picture_width;
-	int picture_height;
-	int picture_format;
-
+	int width;
+	int height;
 	int jpeg_thumbnail_width;
 	int jpeg_thumbnail_height;
-	int jpeg_thumbnail_quality;
-	int jpeg_quality;
-
-	int data_size;
-
-	int offset = 0;
-	void *picture_addr = NULL;
-	int picture_size = 0;
-	void *jpeg_thumbnail_addr = NULL;
-	int jpeg_thumbnail_size = 0;
 
-	int jpeg_fd;
-	struct jpeg_enc_param jpeg_enc_params;
-	enum jpeg_frame_format jpeg_in_format;
-	enum jpeg_stream_format jpeg_out_format;
-	enum jpeg_ret_type jpeg_result;
-	void *jpeg_in_buffer;
-	int jpeg_in_size;
+	void *thumbnail_buffer = NULL;
+	int thumbnail_size;
 	void *jpeg_out_buffer;
 	int jpeg_out_size;
 
-	exif_attribute_t exif_attributes;
-	int exif_size = 0;
-
-	int index;
 	int rc;
 
-	if (exynos_camera == NULL)
+	if (exynos_camera == NULL || frame == NULL || jpeg_in_buffer == NULL ||
+		picture_addr == NULL || picture_size == NULL)
 		return -EINVAL;
 
-	picture_width = exynos_camera->picture_width;
-	picture_height = exynos_camera->picture_height;
-	picture_format = exynos_camera->picture_format;
-	camera_picture_format = exynos_camera->camera_picture_format;
+	width = frame->width;
+	height = frame->height;
 	jpeg_thumbnail_width = exynos_camera->jpeg_thumbnail_width;
 	jpeg_thumbnail_height = exynos_camera->jpeg_thumbnail_height;
-	jpeg_thumbnail_quality = exynos_camera->jpeg_thumbnail_quality;
-	jpeg_quality = exynos_camera->jpeg_quality;
 
-	if (camera_picture_format == 0)
-		camera_picture_format = picture_format;
+	// Thumbnail
 
-	// V4L2
+	// Swap a downscaled copy in front of the picture for the thumbnail encode
+	thumbnail_size = exynos_jpeg_in_size(format, jpeg_thumbnail_width, jpeg_thumbnail_height);
+	thumbnail_buffer = malloc(thumbnail_size * 2);
+	if (thumbnail_buffer != NULL) {
+		rc = exynos_scale(format, jpeg_in_buffer, width, height,
+			thumbnail_buffer, jpeg_thumbnail_width, jpeg_thumbnail_height);
+		if (rc < 0) {
+			ALOGE("%s: Unable to scale thumbnail", __func__);
+			free(thumbnail_buffer);
+			thumbnail_buffer = NULL;
+		} else {
+			memcpy((void *) ((int) thumbnail_buffer + thumbnail_size), jpeg_in_buffer, thumbnail_size);
+			memcpy(jpeg_in_buffer, thumbnail_buffer, thumbnail_size);
+		}
+	}
 
-	rc = exynos_v4l2_poll(exynos_camera, 0);
-	if (rc < 0) {
-		ALOGE("%s: poll failed!", __func__);
-		return -1;
-	} else if (rc == 0) {
-		ALOGE("%s: poll timeout!", __func__);
-		return -1;
+	rc = exynos_jpeg_encode(exynos_camera, format,
+		jpeg_thumbnail_width, jpeg_thumbnail_height, exynos_camera->jpeg_thumbnail_quality,
+		&jpeg_out_buffer, &jpeg_out_size);
+
+	if (thumbnail_buffer != NULL) {
+		memcpy(jpeg_in_buffer, (void *) ((int) thumbnail_buffer + thumbnail_size), thumbnail_size);
+		free(thumbnail_buffer);
+		thumbnail_buffer = NULL;
 	}
 
-	rc = exynos_v4l2_streamoff_cap(exynos_camera, 0);
 	if (rc < 0) {
-		ALOGE("%s: streamoff failed!", __func__);
-		return -1;
+		ALOGE("%s: Failed to encode JPEG thumbnail", __func__);
+		goto error;
 	}
 
-	index = exynos_v4l2_dqbuf_cap(exynos_camera, 0);
-	if (index < 0) {
-		ALOGE("%s: dqbuf failed!", __func__);
-		return -1;
+	if (exynos_camera->callbacks.request_memory != NULL) {
+		jpeg_thumbnail_data_memory =
+			exynos_camera->callbacks.request_memory(-1,
+				jpeg_out_size, 1, 0);
+		if (jpeg_thumbnail_data_memory == NULL) {
+			ALOGE("%s: thumbnail memory request failed!", __func__);
+			goto error;
+		}
+	} else {
+		ALOGE("%s: No memory request function!", __func__);
+		goto error;
 	}
 
-	// This assumes that the output format is JPEG
-
-	if (camera_picture_format == V4L2_PIX_FMT_JPEG) {
-		rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAM_JPEG_MAIN_SIZE,
-			&picture_size);
-		if (rc < 0) {
-			ALOGE("%s: g ctrl failed!", __func__);
-			return -1;
-		}
+	memcpy(jpeg_thumbnail_data_memory->data, jpeg_out_buffer, jpeg_out_size);
 
-		rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAM_JPEG_MAIN_OFFSET,
-			&offset);
-		if (rc < 0) {
-			ALOGE("%s: g ctrl failed!", __func__);
-			return -1;
-		}
+	frame->jpeg_thumbnail_data_memory = jpeg_thumbnail_data_memory;
+	frame->jpeg_thumbnail_size = jpeg_out_size;
 
-		picture_addr = (void *) ((int) exynos_camera->picture_memory->data + offset);
+	// Picture
 
-		rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAM_JPEG_THUMB_SIZE,
-			&jpeg_thumbnail_size);
-		if (rc < 0) {
-			ALOGE("%s: g ctrl failed!", __func__);
-			return -1;
-		}
+	rc = exynos_jpeg_encode(exynos_camera, format,
+		width, height, exynos_camera->jpeg_quality,
+		&jpeg_out_buffer, &jpeg_out_size);
+	if (rc < 0) {
+		ALOGE("%s: Failed to encode JPEG picture", __func__);
+		goto error;
+	}
 
-		rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAM_JPEG_THUMB_OFFSET,
-			&offset);
-		if (rc < 0) {
-			ALOGE("%s: g ctrl failed!", __func__);
-			return -1;
-		}
+	// The encoder output buffer is only valid until the next encode
+	*picture_addr = jpeg_out_buffer;
+	*picture_size = jpeg_out_size;
 
-		jpeg_thumbnail_addr = (void *) ((int) exynos_camera->picture_memory->data + offset);
-	}
+	return 0;
 
-	// Thumbnail
+error:
+	if (jpeg_thumbnail_data_memory != NULL && jpeg_thumbnail_data_memory->release != NULL)
+		jpeg_thumbnail_data_memory->release(jpeg_thumbnail_data_memory);
 
-	if (camera_picture_format == V4L2_PIX_FMT_JPEG && jpeg_thumbnail_addr != NULL && jpeg_thumbnail_size >= 0) {
-		if (exynos_camera->callbacks.request_memory != NULL) {
-			jpeg_thumbnail_data_memory =
-				exynos_camera->callbacks.request_memory(-1,
-					jpeg_thumbnail_size, 1, 0);
-			if (jpeg_thumbnail_data_memory == NULL) {
-				ALOGE("%s: thumb memory request failed!", __func__);
-				goto error;
-			}
-		} else {
-			ALOGE("%s: No memory request function!", __func__);
-			goto error;
-		}
+	frame->jpeg_thumbnail_data_memory = NULL;
+	frame->jpeg_thumbnail_size = 0;
 
-		memcpy(jpeg_thumbnail_data_memory->data, jpeg_thumbnail_addr, jpeg_thumbnail_size);
-	} else {
-		jpeg_fd = api_jpeg_encode_init();
-		if (jpeg_fd < 0) {
-			ALOGE("%s: Failed to init JPEG", __func__);
-			goto error;
-		}
+	return -1;
+}
 
-		switch (camera_picture_format) {
-			case V4L2_PIX_FMT_RGB565:
-				jpeg_in_format = RGB_565;
-				jpeg_out_format = JPEG_420;
-				jpeg_in_size = (picture_width * picture_height * 2);
-				break;
-			case V4L2_PIX_FMT_NV12:
-			case V4L2_PIX_FMT_NV21:
-			case V4L2_PIX_FMT_NV12T:
-			case V4L2_PIX_FMT_YUV420:
-				jpeg_in_format = YUV_420;
-				jpeg_out_format = JPEG_420;
-				jpeg_in_size = (picture_width * picture_height * 1.5);
-				break;
-			case V4L2_PIX_FMT_YUYV:
-			case V4L2_PIX_FMT_UYVY:
-			case V4L2_PIX_FMT_YUV422P:
-			default:
-				jpeg_in_format = YUV_422;
-				jpeg_out_format = JPEG_422;
-				jpeg_in_size = (picture_width * picture_height * 2);
-				break;
-		}
+int exynos_camera_picture_capture(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame, int shutter)
+{
+	camera_memory_t *jpeg_thumbnail_data_memory = NULL;
 
-		memset(&jpeg_enc_params, 0, sizeof(jpeg_enc_params));
+	int camera_picture_format;
+	int picture_width;
+	int picture_height;
+	int picture_format;
 
-		jpeg_enc_params.width = jpeg_thumbnail_width;
-		jpeg_enc_params.height = jpeg_thumbnail_height;
-		jpeg_enc_params.in_fmt = jpeg_in_format;
-		jpeg_enc_params.out_fmt = jpeg_out_format;
+	int offset = 0;
+	void *picture_addr = NULL;
+	int picture_size = 0;
+	void *jpeg_thumbnail_addr = NULL;
+	int jpeg_thumbnail_size = 0;
 
-		if (jpeg_thumbnail_quality >= 90)
-			jpeg_enc_params.quality = QUALITY_LEVEL_1;
-		else if (jpeg_thumbnail_quality >= 80)
-			jpeg_enc_params.quality = QUALITY_LEVEL_2;
-		else if (jpeg_thumbnail_quality >= 70)
-			jpeg_enc_params.quality = QUALITY_LEVEL_3;
-		else
-			jpeg_enc_params.quality = QUALITY_LEVEL_4;
+	void *jpeg_in_buffer = NULL;
+	int jpeg_in_size;
 
-		api_jpeg_set_encode_param(&jpeg_enc_params);
+	int index;
+	int rc;
 
-		jpeg_in_buffer = api_jpeg_get_encode_in_buf(jpeg_fd, jpeg_in_size);
-		if (jpeg_in_buffer == NULL) {
-			ALOGE("%s: Failed to get JPEG in buffer", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
-			goto error;
-		}
+	if (exynos_camera == NULL || frame == NULL)
+		return -EINVAL;
 
-		jpeg_out_buffer = api_jpeg_get_encode_out_buf(jpeg_fd);
-		if (jpeg_out_buffer == NULL) {
-			ALOGE("%s: Failed to get JPEG out buffer", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
-			goto error;
-		}
+	memset(frame, 0, sizeof(struct exynos_camera_picture_frame));
 
-		memcpy(jpeg_in_buffer, exynos_camera->picture_memory->data, jpeg_in_size);
+	picture_width = exynos_camera->picture_width;
+	picture_height = exynos_camera->picture_height;
+	picture_format = exynos_camera->picture_format;
+	camera_picture_format = exynos_camera->camera_picture_format;
 
-		jpeg_result = api_jpeg_encode_exe(jpeg_fd, &jpeg_enc_params);
-		if (jpeg_result != JPEG_ENCODE_OK) {
-			ALOGE("%s: Failed to encode JPEG", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
-			goto error;
-		}
+	if (camera_picture_format == 0)
+		camera_picture_format = picture_format;
 
-		jpeg_out_size = jpeg_enc_params.size;
-		if (jpeg_out_size <= 0) {
-			ALOGE("%s: Failed to get JPEG out size", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
-			goto error;
-		}
+	// V4L2
 
-		if (exynos_camera->callbacks.request_memory != NULL) {
-			jpeg_thumbnail_data_memory =
-				exynos_camera->callbacks.request_memory(-1,
-					jpeg_out_size, 1, 0);
-			if (jpeg_thumbnail_data_memory == NULL) {
-				ALOGE("%s: thumbnail memory request failed!", __func__);
-				api_jpeg_encode_deinit(jpeg_fd);
-				goto error;
-			}
-		} else {
-			ALOGE("%s: No memory request function!", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
-			goto error;
-		}
+	rc = exynos_v4l2_poll(exynos_camera, 0);
+	if (rc < 0) {
+		ALOGE("%s: poll failed!", __func__);
+		return -1;
+	} else if (rc == 0) {
+		ALOGE("%s: poll timeout!", __func__);
+		return -1;
+	}
 
-		memcpy(jpeg_thumbnail_data_memory->data, jpeg_out_buffer, jpeg_out_size);
-		jpeg_thumbnail_size = jpeg_out_size;
+	rc = exynos_v4l2_streamoff_cap(exynos_camera, 0);
+	if (rc < 0) {
+		ALOGE("%s: streamoff failed!", __func__);
+		return -1;
+	}
 
-		api_jpeg_encode_deinit(jpeg_fd);
+	index = exynos_v4l2_dqbuf_cap(exynos_camera, 0);
+	if (index < 0) {
+		ALOGE("%s: dqbuf failed!", __func__);
+		return -1;
 	}
 
-	// Picture
+	// The frame is exposed, no need to hold the shutter until encoding is done
+	if (shutter && EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_SHUTTER) && EXYNOS_CAMERA_CALLBACK_DEFINED(notify))
+		exynos_camera->callbacks.notify(CAMERA_MSG_SHUTTER, 0, 0,
+			exynos_camera->callbacks.user);
 
-	if (camera_picture_format == V4L2_PIX_FMT_JPEG && picture_addr != NULL && picture_size >= 0) {
-		if (exynos_camera->callbacks.request_memory != NULL) {
-			picture_data_memory =
-				exynos_camera->callbacks.request_memory(-1,
-					picture_size, 1, 0);
-			if (picture_data_memory == NULL) {
-				ALOGE("%s: picture memory request failed!", __func__);
-				goto error;
-			}
-		} else {
-			ALOGE("%s: No memory request function!", __func__);
-			goto error;
+	// This assumes that the output format is JPEG
+
+	if (camera_picture_format == V4L2_PIX_FMT_JPEG) {
+		rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAM_JPEG_MAIN_SIZE,
+			&picture_size);
+		if (rc < 0) {
+			ALOGE("%s: g ctrl failed!", __func__);
+			return -1;
 		}
 
-		memcpy(picture_data_memory->data, picture_addr, picture_size);
-	} else {
-		jpeg_fd = api_jpeg_encode_init();
-		if (jpeg_fd < 0) {
-			ALOGE("%s: Failed to init JPEG", __func__);
-			goto error;
+		rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAM_JPEG_MAIN_OFFSET,
+			&offset);
+		if (rc < 0) {
+			ALOGE("%s: g ctrl failed!", __func__);
+			return -1;
 		}
 
-		switch (camera_picture_format) {
-			case V4L2_PIX_FMT_RGB565:
-				jpeg_in_format = RGB_565;
-				jpeg_out_format = JPEG_420;
-				jpeg_in_size = (picture_width * picture_height * 2);
-				break;
-			case V4L2_PIX_FMT_NV12:
-			case V4L2_PIX_FMT_NV21:
-			case V4L2_PIX_FMT_NV12T:
-			case V4L2_PIX_FMT_YUV420:
-				jpeg_in_format = YUV_420;
-				jpeg_out_format = JPEG_420;
-				jpeg_in_size = (picture_width * picture_height * 1.5);
-				break;
-			case V4L2_PIX_FMT_YUYV:
-			case V4L2_PIX_FMT_UYVY:
-			case V4L2_PIX_FMT_YUV422P:
-			default:
-				jpeg_in_format = YUV_422;
-				jpeg_out_format = JPEG_422;
-				jpeg_in_size = (picture_width * picture_height * 2);
-				break;
+		picture_addr = (void *) ((int) exynos_camera->picture_memory->data + offset);
+
+		rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAM_JPEG_THUMB_SIZE,
+			&jpeg_thumbnail_size);
+		if (rc < 0) {
+			ALOGE("%s: g ctrl failed!", __func__);
+			return -1;
 		}
 
-		memset(&jpeg_enc_params, 0, sizeof(jpeg_enc_params));
+		rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAM_JPEG_THUMB_OFFSET,
+			&offset);
+		if (rc < 0) {
+			ALOGE("%s: g ctrl failed!", __func__);
+			return -1;
+		}
 
-		jpeg_enc_params.width = picture_width;
-		jpeg_enc_params.height = picture_height;
-		jpeg_enc_params.in_fmt = jpeg_in_format;
-		jpeg_enc_params.out_fmt = jpeg_out_format;
+		jpeg_thumbnail_addr = (void *) ((int) exynos_camera->picture_memory->data + offset);
+	}
 
-		if (jpeg_quality >= 90)
-			jpeg_enc_params.quality = QUALITY_LEVEL_1;
-		else if (jpeg_quality >= 80)
-			jpeg_enc_params.quality = QUALITY_LEVEL_2;
-		else if (jpeg_quality >= 70)
-			jpeg_enc_params.quality = QUALITY_LEVEL_3;
-		else
-			jpeg_enc_params.quality = QUALITY_LEVEL_4;
+	frame->width = picture_width;
+	frame->height = picture_height;
 
-		api_jpeg_set_encode_param(&jpeg_enc_params);
+	if (camera_picture_format != V4L2_PIX_FMT_JPEG) {
+		jpeg_in_size = exynos_jpeg_in_size(camera_picture_format, picture_width, picture_height);
 
-		jpeg_in_buffer = api_jpeg_get_encode_in_buf(jpeg_fd, jpeg_in_size);
+		jpeg_in_buffer = exynos_jpeg_in_buffer(exynos_camera, jpeg_in_size);
 		if (jpeg_in_buffer == NULL) {
 			ALOGE("%s: Failed to get JPEG in buffer", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
-			goto error;
-		}
-
-		jpeg_out_buffer = api_jpeg_get_encode_out_buf(jpeg_fd);
-		if (jpeg_out_buffer == NULL) {
-			ALOGE("%s: Failed to get JPEG out buffer", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
 			goto error;
 		}
 
 		memcpy(jpeg_in_buffer, exynos_camera->picture_memory->data, jpeg_in_size);
 
-		jpeg_result = api_jpeg_encode_exe(jpeg_fd, &jpeg_enc_params);
-		if (jpeg_result != JPEG_ENCODE_OK) {
-			ALOGE("%s: Failed to encode JPEG", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
+		rc = exynos_camera_picture_encode(exynos_camera, frame, camera_picture_format, jpeg_in_buffer,
+			&picture_addr, &picture_size);
+		if (rc < 0)
 			goto error;
-		}
 
-		jpeg_out_size = jpeg_enc_params.size;
-		if (jpeg_out_size <= 0) {
-			ALOGE("%s: Failed to get JPEG out size", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
-			goto error;
-		}
+		jpeg_thumbnail_data_memory = frame->jpeg_thumbnail_data_memory;
+
+		goto picture;
+	}
+
+	// Thumbnail
 
+	if (jpeg_thumbnail_addr != NULL && jpeg_thumbnail_size >= 0) {
 		if (exynos_camera->callbacks.request_memory != NULL) {
-			picture_data_memory =
+			jpeg_thumbnail_data_memory =
 				exynos_camera->callbacks.request_memory(-1,
-					jpeg_out_size, 1, 0);
-			if (picture_data_memory == NULL) {
-				ALOGE("%s: picture memory request failed!", __func__);
-				api_jpeg_encode_deinit(jpeg_fd);
+					jpeg_thumbnail_size, 1, 0);
+			if (jpeg_thumbnail_data_memory == NULL) {
+				ALOGE("%s: thumb memory request failed!", __func__);
 				goto error;
 			}
 		} else {
 			ALOGE("%s: No memory request function!", __func__);
-			api_jpeg_encode_deinit(jpeg_fd);
 			goto error;
 		}
 
-		memcpy(picture_data_memory->data, jpeg_out_buffer, jpeg_out_size);
-		picture_size = jpeg_out_size;
+		memcpy(jpeg_thumbnail_data_memory->data, jpeg_thumbnail_addr, jpeg_thumbnail_size);
+	}
+
+	frame->jpeg_thumbnail_data_memory = jpeg_thumbnail_data_memory;
+	frame->jpeg_thumbnail_size = jpeg_thumbnail_size;
+
+picture:
+	// Picture
+
+	// The capture and encoder buffers are reused by the next frame
+	rc = exynos_camera_picture_reserve(exynos_camera, frame, picture_addr, picture_size);
+	if (rc < 0)
+		goto error;
+
+	return 0;
+
+error:
+	if (jpeg_thumbnail_data_memory != NULL && jpeg_thumbnail_data_memory->release != NULL)
+		jpeg_thumbnail_data_memory->release(jpeg_thumbnail_data_memory);
+
+	memset(frame, 0, sizeof(struct exynos_camera_picture_frame));
+
+	return -1;
+}
+
+/*
+ * The EXIF size is known from its template before it is written: the final
+ * buffer is requested once and the JPEG copied a single time, leaving room for
+ * the EXIF right after the SOI marker. The EXIF is written in place later on.
+ */
+int exynos_camera_picture_reserve(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame, void *picture_addr, int picture_size)
+{
+	camera_memory_t *data_memory = NULL;
+	int exif_size;
+	int data_size;
+
+	if (exynos_camera == NULL || frame == NULL)
+		return -EINVAL;
 
-		api_jpeg_encode_deinit(jpeg_fd);
+	if (picture_addr == NULL || picture_size < 2) {
+		ALOGE("%s: Invalid picture size: %d", __func__, picture_size);
+		return -1;
 	}
 
 	// EXIF
 
-	memset(&exif_attributes, 0, sizeof(exif_attributes));
-	exynos_exif_attributes_create_static(exynos_camera, &exif_attributes);
-	exynos_exif_attributes_create_params(exynos_camera, &exif_attributes);
+	memset(&frame->exif_attributes, 0, sizeof(frame->exif_attributes));
+	exynos_exif_attributes_create_static(exynos_camera, &frame->exif_attributes);
+	exynos_exif_attributes_create_params(exynos_camera, &frame->exif_attributes);
 
-	rc = exynos_exif_create(exynos_camera, &exif_attributes,
-		jpeg_thumbnail_data_memory, jpeg_thumbnail_size,
-		&exif_data_memory, &exif_size);
-	if (rc < 0 || exif_data_memory == NULL || exif_size <= 0) {
-		ALOGE("%s: EXIF create failed!", __func__);
-		goto error;
+	// Video snapshots are not taken at the picture size
+	if (frame->width > 0 && frame->height > 0) {
+		frame->exif_attributes.width = frame->width;
+		frame->exif_attributes.height = frame->height;
+	}
+
+	exif_size = exynos_exif_size(exynos_camera, &frame->exif_attributes,
+		frame->jpeg_thumbnail_data_memory, frame->jpeg_thumbnail_size);
+	if (exif_size <= 0) {
+		ALOGE("%s: EXIF size failed!", __func__);
+		return -1;
 	}
 
 	data_size = exif_size + picture_size;
@@ -1508,29 +1863,58 @@ int exynos_camera_picture(struct exynos_camera *exynos_camera)
 				data_size, 1, 0);
 		if (data_memory == NULL) {
 			ALOGE("%s: data memory request failed!", __func__);
-			goto error;
+			return -1;
 		}
 	} else {
 		ALOGE("%s: No memory request function!", __func__);
-		goto error;
+		return -1;
 	}
 
 	// Copy the first two bytes of the JPEG picture
-	memcpy(data_memory->data, picture_data_memory->data, 2);
-
-	// Copy the EXIF data
-	memcpy((void *) ((int) data_memory->data + 2), exif_data_memory->data,
-		exif_size);
+	memcpy(data_memory->data, picture_addr, 2);
 
-	// Copy the JPEG picture
+	// Copy the JPEG picture after the EXIF space
 	memcpy((void *) ((int) data_memory->data + 2 + exif_size),
-		(void *) ((int) picture_data_memory->data + 2), picture_size - 2);
+		(void *) ((int) picture_addr + 2), picture_size - 2);
 
-	// Callbacks
+	frame->data_memory = data_memory;
+	frame->exif_size = exif_size;
 
-	if (EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_SHUTTER) && EXYNOS_CAMERA_CALLBACK_DEFINED(notify))
-		exynos_camera->callbacks.notify(CAMERA_MSG_SHUTTER, 0, 0,
-			exynos_camera->callbacks.user);
+	return 0;
+}
+
+int exynos_camera_picture_assemble(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame)
+{
+	int rc;
+
+	if (exynos_camera == NULL || frame == NULL || frame->data_memory == NULL)
+		return -EINVAL;
+
+	rc = exynos_exif_write(exynos_camera, &frame->exif_attributes,
+		frame->jpeg_thumbnail_data_memory, frame->jpeg_thumbnail_size,
+		(void *) ((int) frame->data_memory->data + 2), frame->exif_size);
+	if (rc < 0) {
+		ALOGE("%s: EXIF write failed!", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+int exynos_camera_picture_deliver(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame)
+{
+	camera_memory_t *data_memory;
+	camera_memory_t *jpeg_thumbnail_data_memory;
+
+	if (exynos_camera == NULL || frame == NULL)
+		return -EINVAL;
+
+	data_memory = frame->data_memory;
+	jpeg_thumbnail_data_memory = frame->jpeg_thumbnail_data_memory;
+
+	// Callbacks
 
 	if (EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_RAW_IMAGE) && EXYNOS_CAMERA_CALLBACK_DEFINED(data) &&
 		jpeg_thumbnail_data_memory != NULL)
@@ -1542,66 +1926,241 @@ int exynos_camera_picture(struct exynos_camera *exynos_camera)
 		exynos_camera->callbacks.data(CAMERA_MSG_COMPRESSED_IMAGE,
 			data_memory, 0, NULL, exynos_camera->callbacks.user);
 
+	exynos_stats_count(exynos_camera, EXYNOS_STATS_PICTURES);
+	exynos_stats_add_since(exynos_camera, EXYNOS_STATS_SHUTTER_TO_JPEG,
+		exynos_camera->picture_shutter_time);
+
+	ALOGD("%s: shutter to callback: %lld ms, shot to shot: %lld ms", __func__,
+		(long long) ns2ms(systemTime(SYSTEM_TIME_MONOTONIC) - exynos_camera->picture_shutter_time),
+		exynos_camera->picture_last_shutter_time > 0 ?
+		(long long) ns2ms(exynos_camera->picture_shutter_time - exynos_camera->picture_last_shutter_time) : 0LL);
+
 	// Release memory
 
 	if (jpeg_thumbnail_data_memory != NULL && jpeg_thumbnail_data_memory->release != NULL)
 		jpeg_thumbnail_data_memory->release(jpeg_thumbnail_data_memory);
 
-	if (picture_data_memory != NULL && picture_data_memory->release != NULL)
-		picture_data_memory->release(picture_data_memory);
-
-	if (exif_data_memory != NULL && exif_data_memory->release != NULL)
-		exif_data_memory->release(exif_data_memory);
-
 	if (data_memory != NULL && data_memory->release != NULL)
 		data_memory->release(data_memory);
 
 	return 0;
+}
 
-error:
-	if (jpeg_thumbnail_data_memory != NULL && jpeg_thumbnail_data_memory->release != NULL)
-		jpeg_thumbnail_data_memory->release(jpeg_thumbnail_data_memory);
+// Writes the EXIF of a captured frame in place, then delivers it
+static int exynos_camera_picture_complete(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame)
+{
+	int rc;
+
+	rc = exynos_camera_picture_assemble(exynos_camera, frame);
+	if (rc < 0) {
+		ALOGE("%s: Unable to assemble picture", __func__);
 
-	if (picture_data_memory != NULL && picture_data_memory->release != NULL)
-		picture_data_memory->release(picture_data_memory);
+		if (frame->jpeg_thumbnail_data_memory != NULL && frame->jpeg_thumbnail_data_memory->release != NULL)
+			frame->jpeg_thumbnail_data_memory->release(frame->jpeg_thumbnail_data_memory);
 
-	if (exif_data_memory != NULL && exif_data_memory->release != NULL)
-		exif_data_memory->release(exif_data_memory);
+		if (frame->data_memory != NULL && frame->data_memory->release != NULL)
+			frame->data_memory->release(frame->data_memory);
 
-	if (data_memory != NULL && data_memory->release != NULL)
-		data_memory->release(data_memory);
+		frame->jpeg_thumbnail_data_memory = NULL;
+		frame->data_memory = NULL;
 
-	return -1;
+		return -1;
+	}
+
+	return exynos_camera_picture_deliver(exynos_camera, frame);
 }
 
-void *exynos_camera_picture_thread(void *data)
+int exynos_camera_picture(struct exynos_camera *exynos_camera)
 {
-	struct exynos_camera *exynos_camera;
+	struct exynos_camera_picture_frame frame;
 	int rc;
-	int i;
 
-	if (data == NULL)
-		return NULL;
+	if (exynos_camera == NULL)
+		return -EINVAL;
 
-	exynos_camera = (struct exynos_camera *) data;
+	rc = exynos_camera_picture_capture(exynos_camera, &frame, 1);
+	if (rc < 0)
+		return -1;
 
-	ALOGD("%s: Starting thread", __func__);
-	exynos_camera->picture_thread_running = 1;
+	// The picture was copied out, give FIMC1 back to the preview
+	rc = exynos_camera_preview_rearm(exynos_camera);
+	if (rc < 0)
+		ALOGE("%s: Unable to re-arm preview", __func__);
+
+	return exynos_camera_picture_complete(exynos_camera, &frame);
+}
+
+/*
+ * Burst: the picture thread keeps triggering the sensor while a second thread
+ * delivers the previous frames. The queue between them is
+ * bounded so that a slow consumer throttles the capture.
+ */
+
+void *exynos_camera_picture_burst_thread(void *data)
+{
+	struct exynos_camera *exynos_camera;
+	struct exynos_camera_picture_frame frame;
+	int rc;
+
+	if (data == NULL)
+		return NULL;
+
+	exynos_camera = (struct exynos_camera *) data;
+
+	ALOGD("%s: Starting thread", __func__);
+
+	while (1) {
+		pthread_mutex_lock(&exynos_camera->picture_burst_mutex);
+
+		while (exynos_camera->picture_burst_count == 0 && !exynos_camera->picture_burst_done)
+			pthread_cond_wait(&exynos_camera->picture_burst_cond, &exynos_camera->picture_burst_mutex);
+
+		if (exynos_camera->picture_burst_count == 0) {
+			pthread_mutex_unlock(&exynos_camera->picture_burst_mutex);
+			break;
+		}
+
+		frame = exynos_camera->picture_burst_frames[exynos_camera->picture_burst_head];
+		exynos_camera->picture_burst_head = (exynos_camera->picture_burst_head + 1) % EXYNOS_CAMERA_BURST_QUEUE_SIZE;
+		exynos_camera->picture_burst_count--;
+
+		pthread_cond_signal(&exynos_camera->picture_burst_cond);
+		pthread_mutex_unlock(&exynos_camera->picture_burst_mutex);
+
+		// EXIF for this frame overlaps with the capture of the next one
+		rc = exynos_camera_picture_complete(exynos_camera, &frame);
+		if (rc < 0)
+			ALOGE("%s: Unable to deliver picture", __func__);
+	}
+
+	ALOGD("%s: Exiting thread", __func__);
+
+	return NULL;
+}
+
+static void exynos_camera_picture_burst_queue(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame)
+{
+	int index;
+
+	pthread_mutex_lock(&exynos_camera->picture_burst_mutex);
+
+	while (exynos_camera->picture_burst_count == EXYNOS_CAMERA_BURST_QUEUE_SIZE)
+		pthread_cond_wait(&exynos_camera->picture_burst_cond, &exynos_camera->picture_burst_mutex);
+
+	index = (exynos_camera->picture_burst_head + exynos_camera->picture_burst_count) % EXYNOS_CAMERA_BURST_QUEUE_SIZE;
+	exynos_camera->picture_burst_frames[index] = *frame;
+	exynos_camera->picture_burst_count++;
+
+	pthread_cond_signal(&exynos_camera->picture_burst_cond);
+	pthread_mutex_unlock(&exynos_camera->picture_burst_mutex);
+}
+
+int exynos_camera_picture_burst(struct exynos_camera *exynos_camera, int count)
+{
+	struct exynos_camera_picture_frame frame;
+	int rc = 0;
+	int i;
+
+	if (exynos_camera == NULL)
+		return -EINVAL;
+
+	i = 0;
+
+	exynos_camera->picture_burst_head = 0;
+	exynos_camera->picture_burst_count = 0;
+	exynos_camera->picture_burst_done = 0;
+
+	pthread_mutex_init(&exynos_camera->picture_burst_mutex, NULL);
+	pthread_cond_init(&exynos_camera->picture_burst_cond, NULL);
+
+	rc = pthread_create(&exynos_camera->picture_burst_thread, NULL,
+		exynos_camera_picture_burst_thread, (void *) exynos_camera);
+	if (rc != 0) {
+		ALOGE("%s: Unable to create thread", __func__);
+		rc = -1;
+		goto complete;
+	}
+
+	for (i = 0; i < count; i++) {
+		// The capture buffer is only reused once the previous frame was copied out
+		if (i > 0) {
+			rc = exynos_v4l2_qbuf_cap(exynos_camera, 0, 0);
+			if (rc < 0) {
+				ALOGE("%s: qbuf failed!", __func__);
+				break;
+			}
+
+			rc = exynos_v4l2_streamon_cap(exynos_camera, 0);
+			if (rc < 0) {
+				ALOGE("%s: streamon failed!", __func__);
+				break;
+			}
+
+			rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_CAPTURE, 0);
+			if (rc < 0) {
+				ALOGE("%s: s ctrl failed!", __func__);
+				break;
+			}
+		}
+
+		// A burst is a single shutter press
+		rc = exynos_camera_picture_capture(exynos_camera, &frame, i == 0);
+		if (rc < 0) {
+			ALOGE("%s: Unable to capture picture %d/%d", __func__, i + 1, count);
+			break;
+		}
+
+		exynos_camera_picture_burst_queue(exynos_camera, &frame);
+	}
+
+	// The picture was copied out, give FIMC1 back to the preview
+	if (exynos_camera_preview_rearm(exynos_camera) < 0)
+		ALOGE("%s: Unable to re-arm preview", __func__);
+
+	pthread_mutex_lock(&exynos_camera->picture_burst_mutex);
+	exynos_camera->picture_burst_done = 1;
+	pthread_cond_signal(&exynos_camera->picture_burst_cond);
+	pthread_mutex_unlock(&exynos_camera->picture_burst_mutex);
+
+	pthread_join(exynos_camera->picture_burst_thread, NULL);
+
+complete:
+	pthread_cond_destroy(&exynos_camera->picture_burst_cond);
+	pthread_mutex_destroy(&exynos_camera->picture_burst_mutex);
+
+	// Frames that were captured are still delivered
+	return i > 0 ? 0 : rc;
+}
+
+void *exynos_camera_picture_thread(void *data)
+{
+	struct exynos_camera *exynos_camera;
+	int rc;
+	int i;
+
+	if (data == NULL)
+		return NULL;
+
+	exynos_camera = (struct exynos_camera *) data;
+
+	ALOGD("%s: Starting thread", __func__);
+	exynos_camera->picture_thread_running = 1;
 
 	if (exynos_camera->picture_enabled == 1) {
 		pthread_mutex_lock(&exynos_camera->picture_mutex);
 
-		rc = exynos_camera_picture(exynos_camera);
+		if (exynos_camera->burst_capture > 1)
+			rc = exynos_camera_picture_burst(exynos_camera, exynos_camera->burst_capture);
+		else
+			rc = exynos_camera_picture(exynos_camera);
+
 		if (rc < 0) {
 			ALOGE("%s: picture failed!", __func__);
 			exynos_camera->picture_enabled = 0;
 		}
 
-		if (exynos_camera->picture_memory != NULL && exynos_camera->picture_memory->release != NULL) {
-			exynos_camera->picture_memory->release(exynos_camera->picture_memory);
-			exynos_camera->picture_memory = NULL;
-		}
-
 		pthread_mutex_unlock(&exynos_camera->picture_mutex);
 	}
 
@@ -1618,6 +2177,7 @@ int exynos_camera_picture_start(struct exynos_camera *exynos_camera)
 	pthread_attr_t thread_attr;
 
 	int width, height, format, camera_format;
+	unsigned int offset;
 
 	int fd;
 	int rc;
@@ -1625,8 +2185,21 @@ int exynos_camera_picture_start(struct exynos_camera *exynos_camera)
 	if (exynos_camera == NULL)
 		return -EINVAL;
 
-	// Stop preview thread
-	exynos_camera_preview_stop(exynos_camera);
+	// Both share the encoder input buffer
+	if (exynos_camera->picture_snapshot_running) {
+		ALOGE("%s: Snapshot is still being encoded", __func__);
+		return -1;
+	}
+
+	exynos_camera->picture_last_shutter_time = exynos_camera->picture_shutter_time;
+	exynos_camera->picture_shutter_time = systemTime(SYSTEM_TIME_MONOTONIC);
+
+	// Pause preview, its buffers are re-armed after the capture
+	exynos_camera_preview_pause(exynos_camera);
+
+	// Settings still waiting for a preview frame boundary
+	exynos_camera_params_settings_apply(exynos_camera);
+	exynos_camera_params_deferred_ctrls_flush(exynos_camera);
 
 	width = exynos_camera->picture_width;
 	height = exynos_camera->picture_height;
@@ -1638,140 +2211,588 @@ int exynos_camera_picture_start(struct exynos_camera *exynos_camera)
 	if (camera_format == 0)
 		camera_format = format;
 
-	rc = exynos_v4l2_enum_fmt_cap(exynos_camera, 0, camera_format);
+	// The supported formats don't change, only check a new one
+	if (camera_format != exynos_camera->picture_camera_format) {
+		rc = exynos_v4l2_enum_fmt_cap(exynos_camera, 0, camera_format);
+		if (rc < 0) {
+			ALOGE("%s: enum fmt failed!", __func__);
+			return -1;
+		}
+
+		exynos_camera->picture_camera_format = camera_format;
+	}
+
+	rc = exynos_v4l2_s_fmt_pix_cap(exynos_camera, 0, width, height, camera_format, V4L2_PIX_FMT_MODE_CAPTURE);
 	if (rc < 0) {
-		ALOGE("%s: enum fmt failed!", __func__);
+		ALOGE("%s: s fmt failed!", __func__);
+		return -1;
+	}
+
+	// Only use 1 buffer, FIMC1 is given back to the preview after each shot
+	rc = exynos_v4l2_reqbufs_cap(exynos_camera, 0, 1);
+	if (rc < 0) {
+		ALOGE("%s: reqbufs failed!", __func__);
+		return -1;
+	}
+
+	rc = exynos_v4l2_querybuf_cap(exynos_camera, 0, 0, &offset);
+	if (rc < 0) {
+		ALOGE("%s: querybuf failed!", __func__);
 		return -1;
 	}
 
-	rc = exynos_v4l2_s_fmt_pix_cap(exynos_camera, 0, width, height, camera_format, V4L2_PIX_FMT_MODE_CAPTURE);
-	if (rc < 0) {
-		ALOGE("%s: s fmt failed!", __func__);
-		return -1;
+	// The mapping is kept across shots, unless the buffer moved or changed size
+	if (exynos_camera->picture_memory == NULL || rc != exynos_camera->picture_buffer_length ||
+		offset != exynos_camera->picture_buffer_offset) {
+		if (exynos_camera->callbacks.request_memory == NULL) {
+			ALOGE("%s: No memory request function!", __func__);
+			return -1;
+		}
+
+		fd = exynos_v4l2_find_mmap_fd(exynos_camera, 0);
+		if (fd < 0) {
+			ALOGE("%s: Unable to find v4l2 fd", __func__);
+			return -1;
+		}
+
+		if (exynos_camera->picture_memory != NULL && exynos_camera->picture_memory->release != NULL)
+			exynos_camera->picture_memory->release(exynos_camera->picture_memory);
+
+		exynos_camera->picture_buffer_length = rc;
+		exynos_camera->picture_buffer_offset = offset;
+
+		exynos_camera->picture_memory =
+			exynos_camera->callbacks.request_memory(fd,
+				exynos_camera->picture_buffer_length, 1, 0);
+		if (exynos_camera->picture_memory == NULL) {
+			ALOGE("%s: memory request failed!", __func__);
+			return -1;
+		}
+	}
+
+	rc = exynos_v4l2_qbuf_cap(exynos_camera, 0, 0);
+	if (rc < 0) {
+		ALOGE("%s: qbuf failed!", __func__);
+		return -1;
+	}
+
+	rc = exynos_v4l2_streamon_cap(exynos_camera, 0);
+	if (rc < 0) {
+		ALOGE("%s: streamon failed!", __func__);
+		return -1;
+	}
+
+	// Force scene-mode
+	exynos_camera_params_set_scene_mode(exynos_camera, 1);
+
+	rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_CAPTURE, 0);
+	if (rc < 0) {
+		ALOGE("%s: s ctrl failed!", __func__);
+		return -1;
+	}
+
+	// Thread
+
+	if (exynos_camera->picture_thread_running) {
+		ALOGE("Picture thread is already running!");
+		return -1;
+	}
+
+	pthread_mutex_init(&exynos_camera->picture_mutex, NULL);
+
+	pthread_attr_init(&thread_attr);
+	pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+
+	exynos_camera->picture_enabled = 1;
+
+	rc = pthread_create(&exynos_camera->picture_thread, &thread_attr,
+		exynos_camera_picture_thread, (void *) exynos_camera);
+	if (rc < 0) {
+		ALOGE("%s: Unable to create thread", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+void exynos_camera_picture_stop(struct exynos_camera *exynos_camera)
+{
+	int rc;
+	int i;
+
+	if (exynos_camera == NULL)
+		return;
+
+	if (!exynos_camera->picture_enabled) {
+		ALOGE("Picture was already stopped!");
+		return;
+	}
+
+	pthread_mutex_lock(&exynos_camera->picture_mutex);
+
+	// Disable picture to make the thread end
+	exynos_camera->picture_enabled = 0;
+
+	pthread_mutex_unlock(&exynos_camera->picture_mutex);
+
+	// Wait for the thread to end
+	for (i = 0; i < 10; i++) {
+		if (!exynos_camera->picture_thread_running)
+			break;
+
+		usleep(500);
+	}
+
+	pthread_mutex_destroy(&exynos_camera->picture_mutex);
+}
+
+/*
+ * Video snapshot: the preview thread converts its next frame in the encoder
+ * input buffer and a worker encodes it, so that recording goes on. FIMC2
+ * buffers are only known by their physical addresses here.
+ */
+
+static int exynos_camera_picture_snapshot_format(int format)
+{
+	switch (format) {
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+		case V4L2_PIX_FMT_RGB565:
+			return format;
+		case V4L2_PIX_FMT_NV21:
+		case V4L2_PIX_FMT_NV12T:
+		case V4L2_PIX_FMT_YUV420:
+			return V4L2_PIX_FMT_NV12;
+		default:
+			return -1;
+	}
+}
+
+void *exynos_camera_picture_snapshot_thread(void *data)
+{
+	struct exynos_camera *exynos_camera;
+	struct exynos_camera_picture_frame frame;
+	void *picture_addr = NULL;
+	int picture_size = 0;
+	int rc;
+
+	if (data == NULL)
+		return NULL;
+
+	exynos_camera = (struct exynos_camera *) data;
+
+	ALOGD("%s: Starting thread", __func__);
+
+	if (EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_SHUTTER) && EXYNOS_CAMERA_CALLBACK_DEFINED(notify))
+		exynos_camera->callbacks.notify(CAMERA_MSG_SHUTTER, 0, 0,
+			exynos_camera->callbacks.user);
+
+	memset(&frame, 0, sizeof(frame));
+	frame.width = exynos_camera->picture_snapshot_width;
+	frame.height = exynos_camera->picture_snapshot_height;
+
+	rc = exynos_camera_picture_encode(exynos_camera, &frame,
+		exynos_camera->picture_snapshot_format, exynos_camera->jpeg.in_buffer,
+		&picture_addr, &picture_size);
+	if (rc >= 0) {
+		rc = exynos_camera_picture_reserve(exynos_camera, &frame, picture_addr, picture_size);
+		if (rc < 0 && frame.jpeg_thumbnail_data_memory != NULL && frame.jpeg_thumbnail_data_memory->release != NULL)
+			frame.jpeg_thumbnail_data_memory->release(frame.jpeg_thumbnail_data_memory);
+	}
+
+	if (rc >= 0)
+		rc = exynos_camera_picture_complete(exynos_camera, &frame);
+
+	if (rc < 0)
+		ALOGE("%s: Unable to encode snapshot", __func__);
+
+	exynos_camera->picture_snapshot_running = 0;
+
+	ALOGD("%s: Exiting thread", __func__);
+
+	return NULL;
+}
+
+// Called by the preview thread with the frame it just dequeued
+void exynos_camera_picture_snapshot_grab(struct exynos_camera *exynos_camera,
+	void *data, int format)
+{
+	pthread_attr_t thread_attr;
+	void *jpeg_in_buffer;
+	int snapshot_format;
+	int width, height;
+	int rc;
+
+	if (exynos_camera == NULL || data == NULL)
+		return;
+
+	pthread_mutex_lock(&exynos_camera->picture_snapshot_mutex);
+
+	if (!exynos_camera->picture_snapshot_pending)
+		goto complete;
+
+	exynos_camera->picture_snapshot_pending = 0;
+
+	// The previous worker is done, snapshots don't start while it runs
+	if (exynos_camera->picture_snapshot_joinable) {
+		pthread_join(exynos_camera->picture_snapshot_thread, NULL);
+		exynos_camera->picture_snapshot_joinable = 0;
+	}
+
+	width = exynos_camera->preview_width;
+	height = exynos_camera->preview_height;
+
+	snapshot_format = exynos_camera_picture_snapshot_format(format);
+	if (snapshot_format < 0) {
+		ALOGE("%s: Unsupported format for snapshot", __func__);
+		goto complete;
+	}
+
+	jpeg_in_buffer = exynos_jpeg_in_buffer(exynos_camera,
+		exynos_jpeg_in_size(snapshot_format, width, height));
+	if (jpeg_in_buffer == NULL) {
+		ALOGE("%s: Failed to get JPEG in buffer", __func__);
+		goto complete;
+	}
+
+	rc = exynos_convert(format, data, width, height, snapshot_format, jpeg_in_buffer);
+	if (rc < 0) {
+		ALOGE("%s: Unable to convert snapshot", __func__);
+		goto complete;
+	}
+
+	exynos_camera->picture_snapshot_format = snapshot_format;
+	exynos_camera->picture_snapshot_width = width;
+	exynos_camera->picture_snapshot_height = height;
+	exynos_camera->picture_snapshot_running = 1;
+
+	// Joinable, so that stopping waits for the encode to end
+	pthread_attr_init(&thread_attr);
+	pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
+
+	rc = pthread_create(&exynos_camera->picture_snapshot_thread, &thread_attr,
+		exynos_camera_picture_snapshot_thread, (void *) exynos_camera);
+	if (rc != 0) {
+		ALOGE("%s: Unable to create thread", __func__);
+		exynos_camera->picture_snapshot_running = 0;
+		goto complete;
+	}
+
+	exynos_camera->picture_snapshot_joinable = 1;
+
+complete:
+	pthread_mutex_unlock(&exynos_camera->picture_snapshot_mutex);
+}
+
+int exynos_camera_picture_snapshot_start(struct exynos_camera *exynos_camera)
+{
+	int rc = 0;
+
+	if (exynos_camera == NULL)
+		return -EINVAL;
+
+	if (!exynos_camera->preview_enabled) {
+		ALOGE("%s: Snapshot needs preview", __func__);
+		return -1;
+	}
+
+	if (exynos_camera_picture_snapshot_format(exynos_camera->preview_format) < 0) {
+		ALOGE("%s: Unsupported preview format for snapshot", __func__);
+		return -1;
+	}
+
+	pthread_mutex_lock(&exynos_camera->picture_snapshot_mutex);
+
+	if (exynos_camera->picture_snapshot_pending || exynos_camera->picture_snapshot_running) {
+		ALOGE("Snapshot is already running!");
+		rc = -1;
+		goto complete;
+	}
+
+	exynos_camera->picture_last_shutter_time = exynos_camera->picture_shutter_time;
+	exynos_camera->picture_shutter_time = systemTime(SYSTEM_TIME_MONOTONIC);
+
+	exynos_camera->picture_snapshot_pending = 1;
+
+complete:
+	pthread_mutex_unlock(&exynos_camera->picture_snapshot_mutex);
+
+	return rc;
+}
+
+void exynos_camera_picture_snapshot_stop(struct exynos_camera *exynos_camera)
+{
+	if (exynos_camera == NULL)
+		return;
+
+	pthread_mutex_lock(&exynos_camera->picture_snapshot_mutex);
+
+	exynos_camera->picture_snapshot_pending = 0;
+
+	// Wait for the encode to end, the worker doesn't take the mutex
+	if (exynos_camera->picture_snapshot_joinable) {
+		pthread_join(exynos_camera->picture_snapshot_thread, NULL);
+		exynos_camera->picture_snapshot_joinable = 0;
+	}
+
+	pthread_mutex_unlock(&exynos_camera->picture_snapshot_mutex);
+}
+
+// Auto-focus
+
+static int exynos_camera_auto_focus_trigger(struct exynos_camera *exynos_camera)
+{
+	int rc;
+
+	// Touch position and focus mode have to be set first
+	exynos_camera_params_settings_apply(exynos_camera);
+	exynos_camera_params_deferred_ctrls_flush(exynos_camera);
+
+	rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_SET_AUTO_FOCUS, AUTO_FOCUS_ON);
+	if (rc < 0) {
+		ALOGE("%s: s ctrl failed!", __func__);
+		return -1;
+	}
+
+	exynos_camera->focus_state = EXYNOS_CAMERA_FOCUS_SCANNING;
+
+	return 0;
+}
+
+static void exynos_camera_auto_focus_finish(struct exynos_camera *exynos_camera)
+{
+	int rc;
+
+	if (exynos_camera->focus_state == EXYNOS_CAMERA_FOCUS_SCANNING) {
+		rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_SET_AUTO_FOCUS, AUTO_FOCUS_OFF);
+		if (rc < 0)
+			ALOGE("%s: s ctrl failed!", __func__);
+	}
+
+	if (exynos_camera->focus_state != EXYNOS_CAMERA_FOCUS_CONTINUOUS)
+		exynos_camera->focus_state = EXYNOS_CAMERA_FOCUS_IDLE;
+
+	exynos_camera->auto_focus_enabled = 0;
+}
+
+/*
+ * Focus state machine, stepped once per preview frame from the preview thread.
+ * One-shot scans (auto-focus and touch) report their result on the first frame
+ * that has it, continuous modes report lens moves as they are seen.
+ */
+
+void exynos_camera_focus_poll(struct exynos_camera *exynos_camera)
+{
+	int auto_focus_status = -1;
+	int auto_focus_result = 0;
+	int focus_result = 0;
+	int focus_move = 0;
+	int moving;
+	int rc;
+
+	if (exynos_camera == NULL)
+		return;
+
+	if (exynos_camera->focus_state == EXYNOS_CAMERA_FOCUS_IDLE &&
+		exynos_camera->focus_mode != FOCUS_MODE_CONTINOUS)
+		return;
+
+	pthread_mutex_lock(&exynos_camera->auto_focus_mutex);
+
+	switch (exynos_camera->focus_state) {
+		case EXYNOS_CAMERA_FOCUS_IDLE:
+			if (exynos_camera->focus_mode == FOCUS_MODE_CONTINOUS)
+				exynos_camera->focus_state = EXYNOS_CAMERA_FOCUS_CONTINUOUS;
+			break;
+		case EXYNOS_CAMERA_FOCUS_PENDING:
+			// Requested before the preview was streaming
+			rc = exynos_camera_auto_focus_trigger(exynos_camera);
+			if (rc < 0) {
+				exynos_camera_auto_focus_finish(exynos_camera);
+				focus_result = 1;
+			}
+			break;
+		case EXYNOS_CAMERA_FOCUS_SCANNING:
+			rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_AUTO_FOCUS_RESULT, &auto_focus_status);
+			if (rc < 0) {
+				ALOGE("%s: g ctrl failed!", __func__);
+			} else if (auto_focus_status & M5MO_AF_STATUS_IN_PROGRESS) { // Progress
+				break;
+			} else if (auto_focus_status == M5MO_AF_STATUS_SUCCESS || auto_focus_status == M5MO_AF_STATUS_1ST_SUCCESS) { // Success
+				auto_focus_result = 1;
+			} else {
+				ALOGE("AF failed or unknown result flag: 0x%x", auto_focus_status);
+			}
+
+			exynos_camera_auto_focus_finish(exynos_camera);
+			focus_result = 1;
+			break;
+		case EXYNOS_CAMERA_FOCUS_CONTINUOUS:
+			if (exynos_camera->focus_mode != FOCUS_MODE_CONTINOUS) {
+				exynos_camera->focus_state = EXYNOS_CAMERA_FOCUS_IDLE;
+				if (exynos_camera->focus_moving) {
+					exynos_camera->focus_moving = 0;
+					focus_move = 1;
+				}
+				break;
+			}
+
+			rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_AUTO_FOCUS_RESULT, &auto_focus_status);
+			if (rc < 0) {
+				ALOGE("%s: g ctrl failed!", __func__);
+				break;
+			}
+
+			moving = (auto_focus_status & M5MO_AF_STATUS_IN_PROGRESS) ? 1 : 0;
+			if (moving != exynos_camera->focus_moving) {
+				exynos_camera->focus_moving = moving;
+				focus_move = 1;
+			}
+
+			// Auto-focus only waits for the lens to settle in continuous modes
+			if (exynos_camera->auto_focus_enabled && !moving) {
+				auto_focus_result = (auto_focus_status == M5MO_AF_STATUS_SUCCESS ||
+					auto_focus_status == M5MO_AF_STATUS_1ST_SUCCESS) ? 1 : 0;
+				exynos_camera_auto_focus_finish(exynos_camera);
+				focus_result = 1;
+			}
+			break;
+	}
+
+	if (focus_result) {
+		exynos_camera->auto_focus_latency = systemTime(SYSTEM_TIME_MONOTONIC) - exynos_camera->auto_focus_time;
+		exynos_stats_add(exynos_camera, EXYNOS_STATS_AUTO_FOCUS, exynos_camera->auto_focus_latency);
+		ALOGD("%s: Auto-focus %s in %lld ms", __func__, auto_focus_result ? "succeeded" : "failed",
+			(long long) ns2ms(exynos_camera->auto_focus_latency));
 	}
 
-	// Only use 1 buffer
-	rc = exynos_v4l2_reqbufs_cap(exynos_camera, 0, 1);
-	if (rc < 0) {
-		ALOGE("%s: reqbufs failed!", __func__);
-		return -1;
-	}
+	moving = exynos_camera->focus_moving;
 
-	rc = exynos_v4l2_querybuf_cap(exynos_camera, 0, 0);
-	if (rc < 0) {
-		ALOGE("%s: querybuf failed!", __func__);
-		return -1;
-	}
+	pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
 
-	exynos_camera->picture_buffer_length = rc;
+	if (focus_move && EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_FOCUS_MOVE) && EXYNOS_CAMERA_CALLBACK_DEFINED(notify))
+		exynos_camera->callbacks.notify(CAMERA_MSG_FOCUS_MOVE,
+			(int32_t) moving, 0, exynos_camera->callbacks.user);
 
-	if (exynos_camera->callbacks.request_memory != NULL) {
-		fd = exynos_v4l2_find_fd(exynos_camera, 0);
-		if (fd < 0) {
-			ALOGE("%s: Unable to find v4l2 fd", __func__);
-			return -1;
-		}
+	if (focus_result && EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_FOCUS) && EXYNOS_CAMERA_CALLBACK_DEFINED(notify))
+		exynos_camera->callbacks.notify(CAMERA_MSG_FOCUS,
+			(int32_t) auto_focus_result, 0, exynos_camera->callbacks.user);
+}
 
-		if (exynos_camera->picture_memory != NULL && exynos_camera->picture_memory->release != NULL)
-			exynos_camera->picture_memory->release(exynos_camera->picture_memory);
+int exynos_camera_auto_focus_start(struct exynos_camera *exynos_camera)
+{
+	int rc;
 
-		exynos_camera->picture_memory =
-			exynos_camera->callbacks.request_memory(fd,
-				exynos_camera->picture_buffer_length, 1, 0);
-		if (exynos_camera->picture_memory == NULL) {
-			ALOGE("%s: memory request failed!", __func__);
-			return -1;
-		}
-	} else {
-		ALOGE("%s: No memory request function!", __func__);
-		return -1;
-	}
+	if (exynos_camera == NULL)
+		return -EINVAL;
 
-	rc = exynos_v4l2_qbuf_cap(exynos_camera, 0, 0);
-	if (rc < 0) {
-		ALOGE("%s: qbuf failed!", __func__);
+	if (!exynos_camera->preview_enabled) {
+		ALOGE("%s: Cannot auto-focus when preview isn't enabled!", __func__);
 		return -1;
 	}
 
-	rc = exynos_v4l2_streamon_cap(exynos_camera, 0);
-	if (rc < 0) {
-		ALOGE("%s: streamon failed!", __func__);
-		return -1;
+	pthread_mutex_lock(&exynos_camera->auto_focus_mutex);
+
+	if (exynos_camera->auto_focus_enabled) {
+		ALOGE("Auto-focus is already running!");
+		pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
+		return 0;
 	}
 
-	// Force scene-mode
-	exynos_camera_params_set_scene_mode(exynos_camera, 1);
+	exynos_camera->auto_focus_time = systemTime(SYSTEM_TIME_MONOTONIC);
 
-	rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_CAPTURE, 0);
-	if (rc < 0) {
-		ALOGE("%s: s ctrl failed!", __func__);
-		return -1;
-	}
+	// The preview thread and set/get parameters use the params too
+	pthread_mutex_lock(&exynos_camera->params_mutex);
 
-	// Thread
+	// The sensor is already focusing, only wait for it to settle
+	if (exynos_camera->focus_mode == FOCUS_MODE_CONTINOUS) {
+		pthread_mutex_unlock(&exynos_camera->params_mutex);
+		exynos_camera->auto_focus_enabled = 1;
+		pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
+		return 0;
+	}
 
-	if (exynos_camera->picture_thread_running) {
-		ALOGE("Picture thread is already running!");
-		return -1;
+	if (exynos_camera->focus_mode != FOCUS_MODE_AUTO) {
+		exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_MODE, "auto");
+		rc = exynos_camera_params_set_focus_mode(exynos_camera, 0);
+		if (rc < 0) {
+			ALOGE("%s: Unable to set focus mode", __func__);
+			pthread_mutex_unlock(&exynos_camera->params_mutex);
+			goto error;
+		}
 	}
 
-	pthread_mutex_init(&exynos_camera->picture_mutex, NULL);
+	pthread_mutex_unlock(&exynos_camera->params_mutex);
 
-	pthread_attr_init(&thread_attr);
-	pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+	// Otherwise, the preview thread triggers it on the first frame
+	if (exynos_camera->preview_thread_running) {
+		rc = exynos_camera_auto_focus_trigger(exynos_camera);
+		if (rc < 0)
+			goto error;
+	} else {
+		exynos_camera->focus_state = EXYNOS_CAMERA_FOCUS_PENDING;
+	}
 
-	exynos_camera->picture_enabled = 1;
+	exynos_camera->auto_focus_enabled = 1;
 
-	rc = pthread_create(&exynos_camera->picture_thread, &thread_attr,
-		exynos_camera_picture_thread, (void *) exynos_camera);
-	if (rc < 0) {
-		ALOGE("%s: Unable to create thread", __func__);
-		return -1;
-	}
+	pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
 
 	return 0;
+
+error:
+	pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
+
+	return -1;
 }
 
-void exynos_camera_picture_stop(struct exynos_camera *exynos_camera)
+void exynos_camera_auto_focus_stop(struct exynos_camera *exynos_camera)
 {
-	int rc;
-	int i;
-
 	if (exynos_camera == NULL)
 		return;
 
-	if (!exynos_camera->picture_enabled) {
-		ALOGE("Picture was already stopped!");
+	pthread_mutex_lock(&exynos_camera->auto_focus_mutex);
+
+	if (!exynos_camera->auto_focus_enabled) {
+		ALOGE("Auto-focus was already stopped!");
+		pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
 		return;
 	}
 
-	pthread_mutex_lock(&exynos_camera->picture_mutex);
+	exynos_camera_auto_focus_finish(exynos_camera);
 
-	// Disable picture to make the thread end
-	exynos_camera->picture_enabled = 0;
+	pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
+}
 
-	pthread_mutex_unlock(&exynos_camera->picture_mutex);
+// Preview
 
-	// Wait for the thread to end
-	for (i = 0; i < 10; i++) {
-		if (!exynos_camera->picture_thread_running)
-			break;
+/*
+ * Preview callback frames are converted to the layout the app asked for into
+ * a ring of their own and delivered from a separate thread, so that a slow
+ * app only loses callback frames instead of stalling the display.
+ */
 
-		usleep(500);
+static int exynos_camera_preview_callback_format(int format)
+{
+	switch (format) {
+		case V4L2_PIX_FMT_YUV420:
+			// yuv420p callbacks are YV12
+			return V4L2_PIX_FMT_YVU420;
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV12T:
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+			return V4L2_PIX_FMT_NV21;
+		default:
+			return format;
 	}
-
-	pthread_mutex_destroy(&exynos_camera->picture_mutex);
 }
 
-// Auto-focus
-
-void *exynos_camera_auto_focus_thread(void *data)
+void *exynos_camera_preview_callback_thread(void *data)
 {
 	struct exynos_camera *exynos_camera;
-	int auto_focus_status = -1;
-	int auto_focus_result = 0;
-	int rc;
-	int i;
+	int64_t time;
+	int index;
 
 	if (data == NULL)
 		return NULL;
@@ -1779,148 +2800,155 @@ void *exynos_camera_auto_focus_thread(void *data)
 	exynos_camera = (struct exynos_camera *) data;
 
 	ALOGD("%s: Starting thread", __func__);
-	exynos_camera->auto_focus_thread_running = 1;
 
-	for (i = 0; i < 10; i++) {
-		if (exynos_camera->preview_thread_running) {
-			break;
-		}
-		ALOGE("%s: Cannot auto-focus when preview-thread isn't running! (Attempt %d)", __func__, i);
-		usleep(50000);
-	}
-	if (!exynos_camera->preview_thread_running) {
-		ALOGE("%s: Auto-focus ignored", __func__);
-		goto thread_exit;
-	}
+	while (1) {
+		pthread_mutex_lock(&exynos_camera->preview_callback_mutex);
 
-	if (exynos_camera->focus_mode != FOCUS_MODE_AUTO) {
-		exynos_param_string_set(exynos_camera, "focus-mode", "auto");
-		rc = exynos_camera_params_apply(exynos_camera);
-		if (rc < 0) {
-			ALOGE("%s: Unable to apply params", __func__);
-			goto thread_exit;
+		while (exynos_camera->preview_callback_count == 0 && exynos_camera->preview_callback_thread_running)
+			pthread_cond_wait(&exynos_camera->preview_callback_cond, &exynos_camera->preview_callback_mutex);
+
+		if (!exynos_camera->preview_callback_thread_running) {
+			pthread_mutex_unlock(&exynos_camera->preview_callback_mutex);
+			break;
 		}
 
-	}
+		index = exynos_camera->preview_callback_head;
+		exynos_camera->preview_callback_head = (index + 1) % EXYNOS_CAMERA_PREVIEW_CALLBACK_BUFFERS_COUNT;
+		exynos_camera->preview_callback_count--;
+		exynos_camera->preview_callback_busy = 1;
 
-	rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_SET_AUTO_FOCUS, AUTO_FOCUS_ON);
-	if (rc < 0) {
-		ALOGE("%s: s ctrl failed!", __func__);
-		auto_focus_result = 0;
-		goto thread_exit;
-	}
+		pthread_mutex_unlock(&exynos_camera->preview_callback_mutex);
 
-	while (exynos_camera->auto_focus_enabled == 1) {
-		pthread_mutex_lock(&exynos_camera->auto_focus_mutex);
+		time = systemTime(SYSTEM_TIME_MONOTONIC);
 
-		rc = exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_AUTO_FOCUS_RESULT, &auto_focus_status);
-		if (rc < 0) {
-			ALOGE("%s: g ctrl failed!", __func__);
-			auto_focus_result = 0;
-			pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
-			goto thread_exit;
-		}
+		if (EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_PREVIEW_FRAME) && EXYNOS_CAMERA_CALLBACK_DEFINED(data))
+			exynos_camera->callbacks.data(CAMERA_MSG_PREVIEW_FRAME,
+				exynos_camera->preview_callback_memory, index, NULL, exynos_camera->callbacks.user);
 
-		if (auto_focus_status & M5MO_AF_STATUS_IN_PROGRESS) { // Progress
-			ALOGD("%s: Focus in progress", __func__);
-		} else if (auto_focus_status == M5MO_AF_STATUS_SUCCESS || auto_focus_status == M5MO_AF_STATUS_1ST_SUCCESS) { // Success
-			auto_focus_result = 1;
-			pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
-			goto thread_exit;
-		} else {
-			auto_focus_result = 0;
-			ALOGE("AF failed or unknown result flag: 0x%x", auto_focus_status);
-			pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
-			goto thread_exit;
-		}
+		exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_CALLBACK, time);
 
-		pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
-		usleep(100000); // Sleep 100 ms
+		pthread_mutex_lock(&exynos_camera->preview_callback_mutex);
+		exynos_camera->preview_callback_busy = 0;
+		pthread_mutex_unlock(&exynos_camera->preview_callback_mutex);
 	}
 
-thread_exit:
-	rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_SET_AUTO_FOCUS, AUTO_FOCUS_OFF);
-	if (rc < 0)
-		ALOGE("%s: s ctrl failed!", __func__);
-
-	if (EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_FOCUS) && EXYNOS_CAMERA_CALLBACK_DEFINED(notify))
-		exynos_camera->callbacks.notify(CAMERA_MSG_FOCUS,
-			(int32_t) auto_focus_result, 0, exynos_camera->callbacks.user);
-
-	exynos_camera->auto_focus_thread_running = 0;
-	exynos_camera->auto_focus_enabled = 0;
-
 	ALOGD("%s: Exiting thread", __func__);
 
 	return NULL;
 }
 
-int exynos_camera_auto_focus_start(struct exynos_camera *exynos_camera)
+int exynos_camera_preview_callback_start(struct exynos_camera *exynos_camera)
 {
-	pthread_attr_t thread_attr;
+	int format, frame_size;
 	int rc;
 
 	if (exynos_camera == NULL)
 		return -EINVAL;
 
-	// Thread
-
-	if (exynos_camera->auto_focus_thread_running) {
-		ALOGE("Auto-focus thread is already running!");
-		return 0;
+	format = exynos_camera_preview_callback_format(exynos_camera->preview_format);
+	frame_size = exynos_convert_frame_size(format, exynos_camera->preview_width,
+		exynos_camera->preview_height);
+	if (frame_size < 0) {
+		format = exynos_camera->preview_format;
+		frame_size = exynos_camera->preview_frame_size;
 	}
 
-	pthread_mutex_init(&exynos_camera->auto_focus_mutex, NULL);
+	// Allocated with the first callback frame
+	if (frame_size != exynos_camera->preview_callback_frame_size &&
+		exynos_camera->preview_callback_memory != NULL) {
+		exynos_memory_put(exynos_camera, exynos_camera->preview_callback_memory);
+		exynos_camera->preview_callback_memory = NULL;
+	}
 
-	pthread_attr_init(&thread_attr);
-	pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+	exynos_camera->preview_callback_format = format;
+	exynos_camera->preview_callback_frame_size = frame_size;
+	exynos_camera->preview_callback_head = 0;
+	exynos_camera->preview_callback_count = 0;
+	exynos_camera->preview_callback_busy = 0;
+	exynos_camera->preview_callback_thread_running = 1;
 
-	exynos_camera->auto_focus_enabled = 1;
+	pthread_mutex_init(&exynos_camera->preview_callback_mutex, NULL);
+	pthread_cond_init(&exynos_camera->preview_callback_cond, NULL);
 
-	rc = pthread_create(&exynos_camera->auto_focus_thread, &thread_attr,
-		exynos_camera_auto_focus_thread, (void *) exynos_camera);
-	if (rc < 0) {
+	rc = pthread_create(&exynos_camera->preview_callback_thread, NULL,
+		exynos_camera_preview_callback_thread, (void *) exynos_camera);
+	if (rc != 0) {
 		ALOGE("%s: Unable to create thread", __func__);
+		exynos_camera->preview_callback_thread_running = 0;
+		pthread_cond_destroy(&exynos_camera->preview_callback_cond);
+		pthread_mutex_destroy(&exynos_camera->preview_callback_mutex);
 		return -1;
 	}
 
 	return 0;
 }
 
-void exynos_camera_auto_focus_stop(struct exynos_camera *exynos_camera)
+void exynos_camera_preview_callback_stop(struct exynos_camera *exynos_camera)
+{
+	if (exynos_camera == NULL || !exynos_camera->preview_callback_thread_running)
+		return;
+
+	pthread_mutex_lock(&exynos_camera->preview_callback_mutex);
+	exynos_camera->preview_callback_thread_running = 0;
+	pthread_cond_signal(&exynos_camera->preview_callback_cond);
+	pthread_mutex_unlock(&exynos_camera->preview_callback_mutex);
+
+	pthread_join(exynos_camera->preview_callback_thread, NULL);
+
+	pthread_cond_destroy(&exynos_camera->preview_callback_cond);
+	pthread_mutex_destroy(&exynos_camera->preview_callback_mutex);
+}
+
+static void exynos_camera_preview_callback_queue(struct exynos_camera *exynos_camera,
+	void *data, int format)
 {
+	void *frame;
+	int index;
 	int rc;
-	int i;
 
-	if (exynos_camera == NULL)
+	if (!exynos_camera->preview_callback_thread_running)
 		return;
 
-	if (!exynos_camera->auto_focus_enabled) {
-		ALOGE("Auto-focus was already stopped!");
-		return;
+	if (exynos_camera->preview_callback_memory == NULL) {
+		exynos_camera->preview_callback_memory =
+			exynos_memory_get(exynos_camera, exynos_camera->preview_callback_frame_size,
+				EXYNOS_CAMERA_PREVIEW_CALLBACK_BUFFERS_COUNT);
+		if (exynos_camera->preview_callback_memory == NULL)
+			return;
 	}
 
-	pthread_mutex_lock(&exynos_camera->auto_focus_mutex);
+	pthread_mutex_lock(&exynos_camera->preview_callback_mutex);
 
-	// Disable auto-focus to make the thread end
-	exynos_camera->auto_focus_enabled = 0;
+	// The app fell behind, drop its oldest frame
+	if (exynos_camera->preview_callback_count + exynos_camera->preview_callback_busy >=
+		EXYNOS_CAMERA_PREVIEW_CALLBACK_BUFFERS_COUNT) {
+		exynos_camera->preview_callback_head = (exynos_camera->preview_callback_head + 1) %
+			EXYNOS_CAMERA_PREVIEW_CALLBACK_BUFFERS_COUNT;
+		exynos_camera->preview_callback_count--;
+		exynos_stats_count(exynos_camera, EXYNOS_STATS_PREVIEW_CALLBACK_SKIPPED);
+	}
 
-	pthread_mutex_unlock(&exynos_camera->auto_focus_mutex);
+	// Popping doesn't move this slot, it is only handed out below
+	index = (exynos_camera->preview_callback_head + exynos_camera->preview_callback_count) %
+		EXYNOS_CAMERA_PREVIEW_CALLBACK_BUFFERS_COUNT;
 
-	// Wait for the thread to end
-	for (i = 0; i < 10; i++) {
-		if (!exynos_camera->auto_focus_thread_running)
-			break;
+	pthread_mutex_unlock(&exynos_camera->preview_callback_mutex);
 
-		usleep(500);
-	}
+	frame = (void *) ((int) exynos_camera->preview_callback_memory->data +
+		index * exynos_camera->preview_callback_frame_size);
 
-	pthread_mutex_destroy(&exynos_camera->auto_focus_mutex);
-}
+	rc = exynos_convert(format, data, exynos_camera->preview_width, exynos_camera->preview_height,
+		exynos_camera->preview_callback_format, frame);
+	if (rc < 0)
+		return;
 
-// Preview
+	pthread_mutex_lock(&exynos_camera->preview_callback_mutex);
+	exynos_camera->preview_callback_count++;
+	pthread_cond_signal(&exynos_camera->preview_callback_cond);
+	pthread_mutex_unlock(&exynos_camera->preview_callback_mutex);
+}
 
-int exynos_camera_preview(struct exynos_camera *exynos_camera)
+int exynos_camera_preview(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
 {
 	buffer_handle_t *buffer;
 	int stride;
@@ -1932,13 +2960,10 @@ int exynos_camera_preview(struct exynos_camera *exynos_camera)
 	int frame_size, offset;
 	void *preview_data;
 	void *window_data;
+	int callback;
 
-	unsigned int recording_y_addr;
-	unsigned int recording_cbcr_addr;
-	nsecs_t timestamp;
-	struct exynos_camera_addrs *addrs;
-	struct timespec ts;
-
+	int64_t timestamp;
+	int64_t time;
 	int index;
 	int rc;
 	int i;
@@ -1947,6 +2972,10 @@ int exynos_camera_preview(struct exynos_camera *exynos_camera)
 		ALOGE("%s: exynos_camera == NULL", __func__);
 		goto error;
 	}
+
+	time = exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_POLL,
+		exynos_camera->preview_poll_time);
+
 	if (exynos_camera->preview_memory == NULL) {
 		ALOGE("%s: exynos_camera->preview_memory == NULL", __func__);
 		goto error;
@@ -1956,32 +2985,41 @@ int exynos_camera_preview(struct exynos_camera *exynos_camera)
 		goto error;
 	}
 
-	timestamp = systemTime(1);
-
 	// V4L2
 	pthread_mutex_lock(&exynos_camera->preview_mutex);
 
-	rc = exynos_v4l2_poll(exynos_camera, 0);
-	if (rc < 0) {
-		ALOGE("%s: poll failed!", __func__);
-		goto error;
-	} else if (rc == 0) {
-		ALOGE("%s: poll timeout!", __func__);
-		goto error;
-	}
-
 	index = exynos_v4l2_dqbuf_cap(exynos_camera, 0);
 	if (index < 0 || index >= exynos_camera->preview_buffers_count) {
 		ALOGE("%s: dqbuf failed!", __func__);
 		goto error;
 	}
 
-	rc = exynos_v4l2_qbuf_cap(exynos_camera, 0, index);
-	if (rc < 0) {
-		ALOGE("%s: qbuf failed!", __func__);
-		goto error;
+	time = exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_DQBUF, time);
+	exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_INTERVAL,
+		exynos_camera->preview_frame_time);
+	exynos_camera->preview_frame_time = time;
+
+	// Stamp the frame with its capture time rather than when it was dequeued
+	timestamp = exynos_camera->v4l2_timestamps[0];
+	if (timestamp > 0)
+		exynos_stats_timestamp(exynos_camera, EXYNOS_STATS_PREVIEW_LATENCY, EXYNOS_STATS_PREVIEW_JITTER,
+			timestamp, &exynos_camera->preview_timestamp, &exynos_camera->preview_timestamp_interval);
+	else
+		timestamp = time;
+
+	if (exynos_camera->open_latency == 0) {
+		exynos_camera->open_latency = time - exynos_camera->open_time;
+		exynos_stats_add(exynos_camera, EXYNOS_STATS_OPEN_TO_PREVIEW, exynos_camera->open_latency);
+		ALOGD("%s: Open to first preview frame in %lld ms", __func__,
+			(long long) ns2ms(exynos_camera->open_latency));
 	}
 
+	frame_size = exynos_camera->preview_frame_size;
+	callback = EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_PREVIEW_FRAME) && EXYNOS_CAMERA_CALLBACK_DEFINED(data);
+
+	offset = index * frame_size;
+	preview_data = (void *) ((int) exynos_camera->preview_memory->data + offset);
+
 	// Preview window
 
 	width = exynos_camera->preview_width;
@@ -1990,95 +3028,54 @@ int exynos_camera_preview(struct exynos_camera *exynos_camera)
 
 	exynos_camera->preview_window->dequeue_buffer(exynos_camera->preview_window,
 		&buffer, &stride);
+	time = exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_WINDOW_DEQUEUE, time);
+
 	exynos_camera->gralloc->lock(exynos_camera->gralloc, *buffer, GRALLOC_USAGE_SW_WRITE_OFTEN,
 		0, 0, width, height, &window_data);
+	time = exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_WINDOW_LOCK, time);
 
 	if (window_data == NULL) {
 		ALOGE("%s: gralloc lock failed!", __func__);
+		exynos_v4l2_qbuf_cap(exynos_camera, 0, index);
 		goto error;
 	}
 
-	frame_size = exynos_camera->preview_frame_size;
-	offset = index * frame_size;
-
-	preview_data = (void *) ((int) exynos_camera->preview_memory->data + offset);
 	memcpy(window_data, preview_data, frame_size);
+	time = exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_COPY, time);
 
 	exynos_camera->gralloc->unlock(exynos_camera->gralloc, *buffer);
+	if (exynos_camera->preview_window->set_timestamp != NULL)
+		exynos_camera->preview_window->set_timestamp(exynos_camera->preview_window, timestamp);
 	exynos_camera->preview_window->enqueue_buffer(exynos_camera->preview_window,
 		buffer);
+	time = exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_WINDOW_ENQUEUE, time);
 
-	pthread_mutex_unlock(&exynos_camera->preview_mutex);
-
-	if (EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_PREVIEW_FRAME) && EXYNOS_CAMERA_CALLBACK_DEFINED(data)) {
-		exynos_camera->callbacks.data(CAMERA_MSG_PREVIEW_FRAME,
-			exynos_camera->preview_memory, index, NULL, exynos_camera->callbacks.user);
+	if (callback) {
+		exynos_camera_preview_callback_queue(exynos_camera, preview_data,
+			exynos_camera->preview_format);
+		exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_CONVERT, time);
 	}
 
-	// Recording
-
-	if (exynos_camera->recording_enabled && exynos_camera->recording_memory != NULL) {
-		pthread_mutex_lock(&exynos_camera->recording_mutex);
-
-		// V4L2
+	if (exynos_camera->picture_snapshot_pending)
+		exynos_camera_picture_snapshot_grab(exynos_camera, preview_data,
+			exynos_camera->preview_format);
 
-		rc = exynos_v4l2_poll(exynos_camera, 2);
-		if (rc < 0) {
-			ALOGE("%s: poll failed!", __func__);
-			goto error_recording;
-		} else if (rc == 0) {
-			ALOGE("%s: poll timeout!", __func__);
-			goto error_recording;
-		}
-
-		index = exynos_v4l2_dqbuf_cap(exynos_camera, 2);
-		if (index < 0) {
-			ALOGE("%s: dqbuf failed!", __func__);
-			goto error_recording;
-		}
-
-		recording_y_addr = exynos_v4l2_s_ctrl(exynos_camera, 2, V4L2_CID_PADDR_Y, index);
-		if (recording_y_addr == 0xffffffff) {
-			ALOGE("%s: s ctrl failed!", __func__);
-			goto error_recording;
-		}
-
-		recording_cbcr_addr = exynos_v4l2_s_ctrl(exynos_camera, 2, V4L2_CID_PADDR_CBCR, index);
-		if (recording_cbcr_addr == 0xffffffff) {
-			ALOGE("%s: s ctrl failed!", __func__);
-			goto error_recording;
-		}
-
-		addrs = (struct exynos_camera_addrs *) exynos_camera->recording_memory->data;
-
-		addrs[index].type = 0; // kMetadataBufferTypeCameraSource
-		addrs[index].y = recording_y_addr;
-		addrs[index].cbcr = recording_cbcr_addr;
-		addrs[index].index = index;
-		addrs[index].reserved = 0;
+	// FIMC1 can only write to the buffer once everything was read from it
+	rc = exynos_v4l2_qbuf_cap(exynos_camera, 0, index);
+	if (rc < 0) {
+		ALOGE("%s: qbuf failed!", __func__);
+		goto error;
+	}
 
-		pthread_mutex_unlock(&exynos_camera->recording_mutex);
+	pthread_mutex_unlock(&exynos_camera->preview_mutex);
 
-		if (EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_VIDEO_FRAME) && EXYNOS_CAMERA_CALLBACK_DEFINED(data_timestamp)) {
-			exynos_camera->callbacks.data_timestamp(timestamp, CAMERA_MSG_VIDEO_FRAME,
-				exynos_camera->recording_memory, index, exynos_camera->callbacks.user);
-		} else {
-			rc = exynos_v4l2_qbuf_cap(exynos_camera, 2, index);
-			if (rc < 0) {
-				ALOGE("%s: qbuf failed!", __func__);
-				goto error;
-			}
-		}
-	}
+	exynos_stats_count(exynos_camera, EXYNOS_STATS_PREVIEW_FRAMES);
 
 	return 0;
 
-error_recording:
-	pthread_mutex_unlock(&exynos_camera->recording_mutex);
-	ALOGE("%s: Exiting with error", __func__);
-	return -1;
 error:
 	pthread_mutex_unlock(&exynos_camera->preview_mutex);
+	exynos_stats_count(exynos_camera, EXYNOS_STATS_PREVIEW_DROPPED);
 	ALOGE("%s: Exiting with error", __func__);
 	return -1;
 
@@ -2087,6 +3084,7 @@ error:
 void *exynos_camera_preview_thread(void *data)
 {
 	struct exynos_camera *exynos_camera;
+	int64_t time;
 	int rc;
 
 	if (data == NULL)
@@ -2104,6 +3102,16 @@ void *exynos_camera_preview_thread(void *data)
 	}
 
 	while (exynos_camera->preview_enabled == 1) {
+		// Settings are only changed between two frames
+		if (exynos_camera->params_settings.pending) {
+			time = systemTime(SYSTEM_TIME_MONOTONIC);
+			exynos_camera_params_settings_apply(exynos_camera);
+			exynos_stats_add_since(exynos_camera, EXYNOS_STATS_PREVIEW_SETTINGS, time);
+		}
+
+		if (exynos_camera->params_deferred_ctrls.count > 0)
+			exynos_camera_params_deferred_ctrls_flush(exynos_camera);
+
 		//Check if recording-start is triggered.
 		if (exynos_camera->recording_msg_start) {
 			exynos_camera->recording_msg_start = 0;
@@ -2120,11 +3128,18 @@ void *exynos_camera_preview_thread(void *data)
 			exynos_camera_recording_stop(exynos_camera);
 		}
 
-		//Preview (and recording routine)
-		rc = exynos_camera_preview(exynos_camera);
+		//Preview
+		exynos_camera->preview_poll_time = systemTime(SYSTEM_TIME_MONOTONIC);
+		rc = exynos_v4l2_events_wait(exynos_camera, &exynos_camera->preview_events, 1000);
 		if (rc < 0) {
 			ALOGE("%s: preview failed!", __func__);
 			exynos_camera->preview_enabled = 0;
+		} else if (rc == 0) {
+			ALOGE("%s: poll timeout!", __func__);
+			exynos_stats_count(exynos_camera, EXYNOS_STATS_PREVIEW_TIMEOUTS);
+			exynos_camera->preview_enabled = 0;
+		} else {
+			exynos_camera_focus_poll(exynos_camera);
 		}
 
 		exynos_camera->preview_thread_running = 1;
@@ -2141,10 +3156,19 @@ void *exynos_camera_preview_thread(void *data)
 	return NULL;
 }
 
+static int exynos_camera_preview_armed_match(struct exynos_camera *exynos_camera)
+{
+	return exynos_camera->preview_armed_width == exynos_camera->preview_width &&
+		exynos_camera->preview_armed_height == exynos_camera->preview_height &&
+		exynos_camera->preview_armed_format == exynos_camera->preview_format &&
+		exynos_camera->preview_armed_fps == exynos_camera->preview_fps;
+}
+
 int exynos_camera_preview_start(struct exynos_camera *exynos_camera)
 {
+	struct exynos_v4l2_deferred_ctrls ctrls;
 	struct v4l2_streamparm streamparm;
-	int width, height, format;
+	int width, height, format, camera_format;
 	float format_bpp;
 	int fps, frame_size;
 	int fd;
@@ -2162,8 +3186,43 @@ int exynos_camera_preview_start(struct exynos_camera *exynos_camera)
 		return 0;
 	}
 
+	// The thread may have ended on its own after an error
+	if (exynos_camera->preview_thread_joinable) {
+		pthread_join(exynos_camera->preview_thread, NULL);
+		exynos_camera->preview_thread_joinable = 0;
+	}
+
+	// Left over from a previous preview
+	exynos_camera_params_settings_apply(exynos_camera);
+	exynos_camera_params_deferred_ctrls_flush(exynos_camera);
+
+	exynos_camera->preview_timestamp = 0;
+	exynos_camera->preview_timestamp_interval = 0;
+
 	exynos_camera->preview_enabled = 1;
 	exynos_camera->preview_thread_started = 1;
+
+	exynos_camera->preview_paused = 0;
+
+	// Have the encoder ready before the first shot when the sensor can't do JPEG
+	camera_format = exynos_camera->camera_picture_format;
+	if (camera_format == 0)
+		camera_format = exynos_camera->picture_format;
+
+	if (camera_format != V4L2_PIX_FMT_JPEG)
+		exynos_jpeg_start(exynos_camera);
+
+	// Buffers re-armed after a capture only need the stream back on
+	if (exynos_camera->preview_armed && exynos_camera_preview_armed_match(exynos_camera)) {
+		exynos_camera->preview_armed = 0;
+		exynos_camera->preview_buffers_count = exynos_camera->preview_armed_buffers_count;
+
+		ALOGD("%s: Restarting re-armed preview", __func__);
+		goto stream;
+	}
+
+	exynos_camera->preview_armed = 0;
+
 	// V4L2
 
 	format = exynos_camera->preview_format;
@@ -2195,18 +3254,15 @@ int exynos_camera_preview_start(struct exynos_camera *exynos_camera)
 		goto error;
 	}
 
-	for (i = EXYNOS_CAMERA_MAX_BUFFERS_COUNT; i >= EXYNOS_CAMERA_MIN_BUFFERS_COUNT; i--) {
-		rc = exynos_v4l2_reqbufs_cap(exynos_camera, 0, i);
-		if (rc >= 0)
-			break;
-	}
-
+	rc = exynos_v4l2_reqbufs_negotiate(exynos_camera, 0, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+		V4L2_MEMORY_MMAP, width, height, format);
 	if (rc < 0) {
 		ALOGE("%s: reqbufs failed!", __func__);
 		goto error;
 	}
 
 	exynos_camera->preview_buffers_count = rc;
+
 	ALOGD("Found %d preview buffers available!", exynos_camera->preview_buffers_count);
 
 	fps = exynos_camera->preview_fps;
@@ -2221,164 +3277,583 @@ int exynos_camera_preview_start(struct exynos_camera *exynos_camera)
 	}
 
 	frame_size = (int) ((float) width * (float) height * format_bpp);
+
+	if (exynos_camera->preview_memory != NULL && exynos_camera->preview_memory->release != NULL) {
+		exynos_camera->preview_memory->release(exynos_camera->preview_memory);
+		exynos_camera->preview_memory = NULL;
+	}
+
+	rc = exynos_v4l2_querybuf_negotiate(exynos_camera, 0, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+		V4L2_MEMORY_MMAP, width, height, format, exynos_camera->preview_buffers_count);
+	if (rc < 0) {
+		ALOGE("%s: querybuf failed!", __func__);
+		goto error;
+	}
+
+	if (rc < frame_size) {
+		ALOGE("%s: problematic frame size: %d/%d", __func__, rc, frame_size);
+		goto error;
+	}
+
+	frame_size = rc;
+
+	fd = exynos_v4l2_find_mmap_fd(exynos_camera, 0);
+	if (fd < 0) {
+		ALOGE("%s: Unable to find v4l2 fd", __func__);
+		goto error;
+	}
+
+	if (exynos_camera->callbacks.request_memory == NULL) {
+		ALOGE("%s: No memory request function!", __func__);
+		goto error;
+	}
+
+	exynos_camera->preview_memory =
+		exynos_camera->callbacks.request_memory(fd,
+			frame_size, exynos_camera->preview_buffers_count, 0);
+	if (exynos_camera->preview_memory == NULL) {
+		ALOGE("%s: memory request failed!", __func__);
+		goto error;
+	}
+
+	exynos_camera->preview_frame_size = frame_size;
+
 	for (i = 0; i < exynos_camera->preview_buffers_count; i++) {
-		rc = exynos_v4l2_querybuf_cap(exynos_camera, 0, i);
+		rc = exynos_v4l2_qbuf_cap(exynos_camera, 0, i);
 		if (rc < 0) {
-			ALOGE("%s: querybuf failed!", __func__);
+			ALOGE("%s: qbuf failed!", __func__);
+			goto error;
+		}
+	}
+
+stream:
+	memset(&ctrls, 0, sizeof(ctrls));
+	exynos_v4l2_ctrls_defer(&ctrls, V4L2_CID_ROTATION, exynos_camera->camera_rotation);
+	exynos_v4l2_ctrls_defer(&ctrls, V4L2_CID_HFLIP, exynos_camera->camera_hflip);
+	exynos_v4l2_ctrls_defer(&ctrls, V4L2_CID_VFLIP, exynos_camera->camera_vflip);
+
+	rc = exynos_v4l2_ctrls_flush(exynos_camera, 0, &ctrls);
+	if (rc < 0) {
+		ALOGE("%s: s ctrl failed!", __func__);
+		goto error;
+	}
+
+	rc = exynos_v4l2_streamon_cap(exynos_camera, 0);
+	if (rc < 0) {
+		ALOGE("%s: streamon failed!", __func__);
+		goto error;
+	}
+
+	// Force scene-mode
+	exynos_camera_params_set_scene_mode(exynos_camera, 1);
+
+	// Events
+
+	// Still set up when the preview was paused for a capture
+	if (exynos_camera->preview_events.nodes_count == 0) {
+		exynos_v4l2_events_deinit(exynos_camera, &exynos_camera->preview_events);
+
+		rc = exynos_v4l2_events_init(exynos_camera, &exynos_camera->preview_events);
+		if (rc < 0) {
+			ALOGE("%s: Unable to init events", __func__);
+			goto error;
+		}
+
+		rc = exynos_v4l2_events_register(exynos_camera, &exynos_camera->preview_events, 0,
+			exynos_camera_preview);
+		if (rc < 0) {
+			ALOGE("%s: Unable to register events", __func__);
 			goto error;
 		}
+	}
+
+	// Thread
+
+	rc = exynos_camera_preview_callback_start(exynos_camera);
+	if (rc < 0) {
+		ALOGE("%s: Unable to start preview callbacks", __func__);
+		goto error;
+	}
+
+	pthread_mutex_init(&exynos_camera->preview_mutex, NULL);
+	pthread_mutex_init(&exynos_camera->preview_lock_mutex, NULL);
+
+	// Lock preview lock
+	pthread_mutex_lock(&exynos_camera->preview_lock_mutex);
+
+	// Joinable, so that stopping doesn't have to sleep on it
+	pthread_attr_init(&thread_attr);
+	pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
+
+	rc = pthread_create(&exynos_camera->preview_thread, &thread_attr,
+		exynos_camera_preview_thread, (void *) exynos_camera);
+	if (rc < 0) {
+		ALOGE("%s: Unable to create thread", __func__);
+		goto error;
+	}
+
+	exynos_camera->preview_thread_joinable = 1;
+
+	ALOGD("%s: Exiting ", __func__);
+	return 0;
+error:
+	exynos_camera_preview_callback_stop(exynos_camera);
+
+	ALOGD("%s: Exiting with error", __func__);
+	return -1;
+}
+
+static void exynos_camera_preview_halt(struct exynos_camera *exynos_camera)
+{
+	int rc;
+
+	exynos_camera->preview_enabled = 0;
+
+	// Wake the thread up instead of waiting for the poll timeout
+	exynos_v4l2_events_wakeup(exynos_camera, &exynos_camera->preview_events);
+
+	// Unlock preview lock
+	pthread_mutex_unlock(&exynos_camera->preview_lock_mutex);
+
+	// The thread takes the preview mutex for each frame, join it first
+	if (exynos_camera->preview_thread_joinable) {
+		pthread_join(exynos_camera->preview_thread, NULL);
+		exynos_camera->preview_thread_joinable = 0;
+	}
+
+	// Settings queued after the last frame boundary
+	exynos_camera_params_settings_apply(exynos_camera);
+
+	exynos_camera_preview_callback_stop(exynos_camera);
+
+	pthread_mutex_lock(&exynos_camera->preview_mutex);
+
+	// Recording can't go on without preview
+	if (exynos_camera->recording_enabled)
+		exynos_camera_recording_stop(exynos_camera);
+
+	rc = exynos_v4l2_streamoff_cap(exynos_camera, 0);
+	if (rc < 0) {
+		ALOGE("%s: streamoff failed!", __func__);
+	}
+
+	pthread_mutex_unlock(&exynos_camera->preview_mutex);
+
+	pthread_mutex_destroy(&exynos_camera->preview_lock_mutex);
+	pthread_mutex_destroy(&exynos_camera->preview_mutex);
+}
+
+static void exynos_camera_preview_release(struct exynos_camera *exynos_camera)
+{
+	exynos_v4l2_events_deinit(exynos_camera, &exynos_camera->preview_events);
+
+	exynos_camera->preview_params_set = 0;
+	exynos_camera->preview_paused = 0;
+	exynos_camera->preview_armed = 0;
+
+	if (exynos_camera->preview_memory != NULL && exynos_camera->preview_memory->release != NULL) {
+		exynos_camera->preview_memory->release(exynos_camera->preview_memory);
+		exynos_camera->preview_memory = NULL;
+	}
+
+	if (exynos_camera->preview_callback_memory != NULL) {
+		exynos_memory_put(exynos_camera, exynos_camera->preview_callback_memory);
+		exynos_camera->preview_callback_memory = NULL;
+	}
+}
+
+void exynos_camera_preview_stop(struct exynos_camera *exynos_camera)
+{
+	ALOGD("%s: Starting ", __func__);
+
+	if (exynos_camera == NULL)
+		goto exit;
+
+	if (!exynos_camera->preview_enabled) {
+		if (exynos_camera->preview_thread_joinable) {
+			pthread_join(exynos_camera->preview_thread, NULL);
+			exynos_camera->preview_thread_joinable = 0;
+		}
+
+		// Drop what was kept around for a capture
+		if (exynos_camera->preview_paused || exynos_camera->preview_armed)
+			exynos_camera_preview_release(exynos_camera);
+
+		ALOGE("Preview was already stopped!");
+		goto exit;
+	}
+
+	exynos_camera_preview_halt(exynos_camera);
+	exynos_camera_preview_release(exynos_camera);
+
+	// No more frames to step the focus state machine on
+	if (exynos_camera->auto_focus_enabled)
+		exynos_camera_auto_focus_stop(exynos_camera);
+
+	exynos_camera->focus_state = EXYNOS_CAMERA_FOCUS_IDLE;
+	exynos_camera->focus_moving = 0;
+
+	exynos_camera->preview_window = NULL;
+
+exit:
+	ALOGD("%s: Exiting ", __func__);
+	return;
+}
+
+/*
+ * FIMC1 only has one queue, so capture still needs the preview stream off.
+ * Pausing keeps the preview memory, events and applied params around so that
+ * the preview can be re-armed right after the capture and restarted with a
+ * single streamon.
+ */
+void exynos_camera_preview_pause(struct exynos_camera *exynos_camera)
+{
+	int count;
+	int rc;
+	int i;
+
+	if (exynos_camera == NULL)
+		return;
+
+	if (!exynos_camera->preview_enabled)
+		return;
+
+	exynos_camera_preview_halt(exynos_camera);
+
+	exynos_camera->preview_armed = 0;
+
+	if (exynos_camera->preview_memory == NULL)
+		return;
+
+	count = exynos_camera->preview_buffers_count;
+	if (count <= 0 || count > EXYNOS_CAMERA_MAX_BUFFERS_COUNT)
+		return;
+
+	// Where the mapped buffers are, to tell whether they moved once re-armed
+	for (i = 0; i < count; i++) {
+		rc = exynos_v4l2_querybuf_cap(exynos_camera, 0, i,
+			&exynos_camera->preview_armed_offsets[i]);
+		if (rc < 0) {
+			ALOGE("%s: querybuf failed!", __func__);
+			return;
+		}
+	}
+
+	exynos_camera->preview_armed_width = exynos_camera->preview_width;
+	exynos_camera->preview_armed_height = exynos_camera->preview_height;
+	exynos_camera->preview_armed_format = exynos_camera->preview_format;
+	exynos_camera->preview_armed_fps = exynos_camera->preview_fps;
+	exynos_camera->preview_armed_buffers_count = exynos_camera->preview_buffers_count;
+	exynos_camera->preview_paused = 1;
+}
+
+/*
+ * FIMC1 buffers live in its reserved memory, so for an unchanged format the
+ * preview buffers usually come back where they were and the mapping taken
+ * before the capture is still valid. Their offsets are checked again after
+ * REQBUFS and the preview memory is mapped again if they moved.
+ */
+int exynos_camera_preview_rearm(struct exynos_camera *exynos_camera)
+{
+	struct v4l2_streamparm streamparm;
+	unsigned int offset;
+	int moved = 0;
+	int count;
+	int fd;
+	int rc;
+	int i;
+
+	if (exynos_camera == NULL)
+		return -EINVAL;
+
+	if (!exynos_camera->preview_paused)
+		return 0;
+
+	exynos_camera->preview_paused = 0;
+
+	if (!exynos_camera_preview_armed_match(exynos_camera) ||
+		exynos_camera->preview_memory == NULL)
+		return 0;
+
+	count = exynos_camera->preview_armed_buffers_count;
+
+	rc = exynos_v4l2_s_fmt_pix_cap(exynos_camera, 0, exynos_camera->preview_armed_width,
+		exynos_camera->preview_armed_height, exynos_camera->preview_armed_format,
+		V4L2_PIX_FMT_MODE_PREVIEW);
+	if (rc < 0) {
+		ALOGE("%s: s fmt failed!", __func__);
+		return -1;
+	}
+
+	rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_CACHEABLE, 1);
+	if (rc < 0) {
+		ALOGE("%s: s ctrl failed!", __func__);
+		return -1;
+	}
+
+	rc = exynos_v4l2_reqbufs_cap(exynos_camera, 0, count);
+	if (rc != count) {
+		ALOGE("%s: reqbufs failed!", __func__);
+		return -1;
+	}
+
+	for (i = 0; i < count; i++) {
+		rc = exynos_v4l2_querybuf_cap(exynos_camera, 0, i, &offset);
+		if (rc < exynos_camera->preview_frame_size) {
+			ALOGE("%s: querybuf failed!", __func__);
+			return -1;
+		}
 
-		if (rc < frame_size) {
-			ALOGE("%s: problematic frame size: %d/%d", __func__, rc, frame_size);
-			goto error;
-		}
+		if (offset != exynos_camera->preview_armed_offsets[i])
+			moved = 1;
 	}
 
-	frame_size = rc;
-	exynos_camera->preview_frame_size = frame_size;
+	if (moved) {
+		ALOGD("%s: Preview buffers moved, mapping them again", __func__);
 
-	if (exynos_camera->callbacks.request_memory != NULL) {
-		fd = exynos_v4l2_find_fd(exynos_camera, 0);
+		fd = exynos_v4l2_find_mmap_fd(exynos_camera, 0);
 		if (fd < 0) {
 			ALOGE("%s: Unable to find v4l2 fd", __func__);
-			goto error;
+			return -1;
 		}
 
-		if (exynos_camera->preview_memory != NULL && exynos_camera->preview_memory->release != NULL)
+		if (exynos_camera->preview_memory->release != NULL)
 			exynos_camera->preview_memory->release(exynos_camera->preview_memory);
 
 		exynos_camera->preview_memory =
 			exynos_camera->callbacks.request_memory(fd,
-				frame_size, exynos_camera->preview_buffers_count, 0);
+				exynos_camera->preview_frame_size, count, 0);
 		if (exynos_camera->preview_memory == NULL) {
 			ALOGE("%s: memory request failed!", __func__);
-			goto error;
+			return -1;
 		}
-	} else {
-		ALOGE("%s: No memory request function!", __func__);
-		goto error;
 	}
 
-	for (i = 0; i < exynos_camera->preview_buffers_count; i++) {
+	memset(&streamparm, 0, sizeof(streamparm));
+	streamparm.parm.capture.timeperframe.numerator = 1;
+	streamparm.parm.capture.timeperframe.denominator = exynos_camera->preview_armed_fps;
+
+	rc = exynos_v4l2_s_parm_cap(exynos_camera, 0, &streamparm);
+	if (rc < 0) {
+		ALOGE("%s: s parm failed!", __func__);
+		return -1;
+	}
+
+	for (i = 0; i < count; i++) {
 		rc = exynos_v4l2_qbuf_cap(exynos_camera, 0, i);
 		if (rc < 0) {
 			ALOGE("%s: qbuf failed!", __func__);
-			goto error;
+			return -1;
 		}
 	}
 
-	rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_ROTATION,
-		exynos_camera->camera_rotation);
-	if (rc < 0) {
-		ALOGE("%s: s ctrl failed!", __func__);
-		goto error;
-	}
+	exynos_camera->preview_armed = 1;
 
-	rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_HFLIP,
-		exynos_camera->camera_hflip);
-	if (rc < 0) {
-		ALOGE("%s: s ctrl failed!", __func__);
-		goto error;
-	}
+	return 0;
+}
 
-	rc = exynos_v4l2_s_ctrl(exynos_camera, 0, V4L2_CID_VFLIP,
-		exynos_camera->camera_vflip);
-	if (rc < 0) {
-		ALOGE("%s: s ctrl failed!", __func__);
-		goto error;
-	}
+// Recording
 
-	rc = exynos_v4l2_streamon_cap(exynos_camera, 0);
-	if (rc < 0) {
-		ALOGE("%s: streamon failed!", __func__);
-		goto error;
-	}
+/*
+ * Single producer (release_recording_frame caller), single consumer
+ * (recording thread) ring of buffer indexes.
+ */
 
-	// Force scene-mode
-	exynos_camera_params_set_scene_mode(exynos_camera, 1);
+void exynos_camera_ring_reset(struct exynos_camera_ring *ring)
+{
+	__atomic_store_n(&ring->head, 0, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->tail, 0, __ATOMIC_RELEASE);
+}
 
-	// Thread
+int exynos_camera_ring_push(struct exynos_camera_ring *ring, int value)
+{
+	unsigned int head;
+	unsigned int tail;
 
-	pthread_mutex_init(&exynos_camera->preview_mutex, NULL);
-	pthread_mutex_init(&exynos_camera->preview_lock_mutex, NULL);
+	head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
 
-	// Lock preview lock
-	pthread_mutex_lock(&exynos_camera->preview_lock_mutex);
+	if (head - tail >= EXYNOS_CAMERA_RING_SIZE)
+		return -1;
 
-	pthread_attr_init(&thread_attr);
-	pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_DETACHED);
+	ring->values[head & (EXYNOS_CAMERA_RING_SIZE - 1)] = value;
+	__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
 
-	rc = pthread_create(&exynos_camera->preview_thread, &thread_attr,
-		exynos_camera_preview_thread, (void *) exynos_camera);
-	if (rc < 0) {
-		ALOGE("%s: Unable to create thread", __func__);
-		goto error;
-	}
+	return 0;
+}
+
+int exynos_camera_ring_pop(struct exynos_camera_ring *ring, int *value)
+{
+	unsigned int head;
+	unsigned int tail;
+
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+	if (head == tail)
+		return -1;
+
+	*value = ring->values[tail & (EXYNOS_CAMERA_RING_SIZE - 1)];
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
 
-	ALOGD("%s: Exiting ", __func__);
 	return 0;
-error:
-	ALOGD("%s: Exiting with error", __func__);
-	return -1;
 }
 
-void exynos_camera_preview_stop(struct exynos_camera *exynos_camera)
+int exynos_camera_recording_qbuf(struct exynos_camera *exynos_camera, int index)
 {
 	int rc;
-	int i;
 
-	ALOGD("%s: Starting ", __func__);
+	pthread_mutex_lock(&exynos_camera->recording_mutex);
 
-	if (exynos_camera == NULL)
-		goto exit;
+	rc = exynos_v4l2_qbuf_cap(exynos_camera, 2, index);
+	if (rc < 0)
+		ALOGE("%s: qbuf failed!", __func__);
+	else
+		__atomic_add_fetch(&exynos_camera->recording_buffers_queued, 1, __ATOMIC_RELAXED);
 
-	if (!exynos_camera->preview_enabled) {
-		ALOGE("Preview was already stopped!");
-		goto exit;
+	pthread_mutex_unlock(&exynos_camera->recording_mutex);
+
+	return rc;
+}
+
+void exynos_camera_recording_release_drain(struct exynos_camera *exynos_camera)
+{
+	int index;
+
+	while (exynos_camera_ring_pop(&exynos_camera->recording_release_ring, &index) == 0) {
+		// FIMC2 had no buffer left to capture into
+		if (__atomic_load_n(&exynos_camera->recording_buffers_queued, __ATOMIC_RELAXED) == 0)
+			exynos_camera->recording_release_late++;
+
+		exynos_camera_recording_qbuf(exynos_camera, index);
 	}
+}
 
-	exynos_camera->preview_enabled = 0;
+int exynos_camera_recording(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
+{
+	unsigned int recording_y_addr;
+	unsigned int recording_cbcr_addr;
+	nsecs_t timestamp;
+	struct exynos_camera_addrs *addrs;
+	int64_t time;
+	int index;
+	int rc;
 
-	// Unlock preview lock
-	pthread_mutex_unlock(&exynos_camera->preview_lock_mutex);
+	if (exynos_camera == NULL || exynos_camera->recording_memory == NULL)
+		return -EINVAL;
 
-	pthread_mutex_lock(&exynos_camera->preview_mutex);
+	// Only used when the buffer has no capture time
+	timestamp = systemTime(1);
 
-	// Wait for the thread to end
-	for (i = 0; i < 30; i++) {
-		if (!exynos_camera->preview_thread_running && !exynos_camera->preview_thread_started)
-			break;
-		ALOGE("%s: Waiting preview to stop", __func__);
+	time = exynos_stats_add_since(exynos_camera, EXYNOS_STATS_RECORDING_POLL,
+		exynos_camera->recording_poll_time);
+
+	// V4L2
+
+	pthread_mutex_lock(&exynos_camera->recording_mutex);
 
-		usleep(100000); // Sleep 100 ms
+	if (!exynos_camera->recording_enabled)
+		goto error;
 
+	index = exynos_v4l2_dqbuf_cap(exynos_camera, 2);
+	if (index < 0 || index >= exynos_camera->recording_buffers_count) {
+		ALOGE("%s: dqbuf failed!", __func__);
+		goto error;
 	}
 
-	rc = exynos_v4l2_streamoff_cap(exynos_camera, 0);
-	if (rc < 0) {
-		ALOGE("%s: streamoff failed!", __func__);
+	__atomic_sub_fetch(&exynos_camera->recording_buffers_queued, 1, __ATOMIC_RELAXED);
+
+	time = exynos_stats_add_since(exynos_camera, EXYNOS_STATS_RECORDING_DQBUF, time);
+	exynos_stats_add_since(exynos_camera, EXYNOS_STATS_RECORDING_INTERVAL,
+		exynos_camera->recording_frame_time);
+	exynos_camera->recording_frame_time = time;
+
+	// Poll wake-up and preview work are not part of the encoder timeline
+	if (exynos_camera->v4l2_timestamps[2] > 0) {
+		timestamp = exynos_camera->v4l2_timestamps[2];
+		exynos_stats_timestamp(exynos_camera, EXYNOS_STATS_RECORDING_LATENCY, EXYNOS_STATS_RECORDING_JITTER,
+			timestamp, &exynos_camera->recording_timestamp, &exynos_camera->recording_timestamp_interval);
 	}
 
-	exynos_camera->preview_params_set = 0;
+	recording_y_addr = exynos_v4l2_s_ctrl(exynos_camera, 2, V4L2_CID_PADDR_Y, index);
+	if (recording_y_addr == 0xffffffff) {
+		ALOGE("%s: s ctrl failed!", __func__);
+		goto error;
+	}
 
-	if (exynos_camera->preview_memory != NULL && exynos_camera->preview_memory->release != NULL) {
-		exynos_camera->preview_memory->release(exynos_camera->preview_memory);
-		exynos_camera->preview_memory = NULL;
+	recording_cbcr_addr = exynos_v4l2_s_ctrl(exynos_camera, 2, V4L2_CID_PADDR_CBCR, index);
+	if (recording_cbcr_addr == 0xffffffff) {
+		ALOGE("%s: s ctrl failed!", __func__);
+		goto error;
 	}
 
-	exynos_camera->preview_window = NULL;
+	addrs = (struct exynos_camera_addrs *) exynos_camera->recording_memory->data;
 
-	pthread_mutex_unlock(&exynos_camera->preview_mutex);
+	addrs[index].type = 0; // kMetadataBufferTypeCameraSource
+	addrs[index].y = recording_y_addr;
+	addrs[index].cbcr = recording_cbcr_addr;
+	addrs[index].index = index;
+	addrs[index].reserved = 0;
 
-	pthread_mutex_destroy(&exynos_camera->preview_lock_mutex);
-	pthread_mutex_destroy(&exynos_camera->preview_mutex);
+	pthread_mutex_unlock(&exynos_camera->recording_mutex);
 
-exit:
-	ALOGD("%s: Exiting ", __func__);
-	return;
+	if (EXYNOS_CAMERA_MSG_ENABLED(CAMERA_MSG_VIDEO_FRAME) && EXYNOS_CAMERA_CALLBACK_DEFINED(data_timestamp)) {
+		exynos_camera->callbacks.data_timestamp(timestamp, CAMERA_MSG_VIDEO_FRAME,
+			exynos_camera->recording_memory, index, exynos_camera->callbacks.user);
+		exynos_stats_add_since(exynos_camera, EXYNOS_STATS_RECORDING_CALLBACK, time);
+	} else {
+		rc = exynos_camera_recording_qbuf(exynos_camera, index);
+		if (rc < 0)
+			return -1;
+	}
+
+	exynos_stats_count(exynos_camera, EXYNOS_STATS_RECORDING_FRAMES);
+
+	return 0;
+
+error:
+	if (exynos_camera->recording_enabled)
+		exynos_stats_count(exynos_camera, EXYNOS_STATS_RECORDING_DROPPED);
+
+	pthread_mutex_unlock(&exynos_camera->recording_mutex);
+	return -1;
 }
 
-// Recording
+void *exynos_camera_recording_thread(void *data)
+{
+	struct exynos_camera *exynos_camera;
+	int rc;
+
+	if (data == NULL)
+		return NULL;
+
+	exynos_camera = (struct exynos_camera *) data;
+
+	ALOGD("%s: Starting thread", __func__);
+
+	while (exynos_camera->recording_enabled == 1) {
+		// Give the released buffers back to FIMC2 before waiting
+		exynos_camera_recording_release_drain(exynos_camera);
+
+		exynos_camera->recording_poll_time = systemTime(SYSTEM_TIME_MONOTONIC);
+		rc = exynos_v4l2_events_wait(exynos_camera, &exynos_camera->recording_events, 1000);
+		if (rc == 0) {
+			ALOGE("%s: poll timeout!", __func__);
+			exynos_stats_count(exynos_camera, EXYNOS_STATS_RECORDING_TIMEOUTS);
+		}
+
+		if (rc < 0 && exynos_camera->recording_enabled) {
+			// The stream may be paused, e.g. while changing focus-mode
+			ALOGE("%s: recording failed!", __func__);
+			usleep(10000);
+		}
+	}
+
+	exynos_camera->recording_thread_running = 0;
+	ALOGD("%s: Exiting thread", __func__);
+
+	return NULL;
+}
 
 void exynos_camera_recording_frame_release(struct exynos_camera *exynos_camera, void *data)
 {
@@ -2392,22 +3867,23 @@ void exynos_camera_recording_frame_release(struct exynos_camera *exynos_camera,
 	if (addrs->index >= (unsigned int) exynos_camera->recording_buffers_count)
 		return;
 
-	pthread_mutex_lock(&exynos_camera->recording_mutex);
-
-	rc = exynos_v4l2_qbuf_cap(exynos_camera, 2, addrs->index);
+	// The recording thread queues the buffer back, without locking here
+	rc = exynos_camera_ring_push(&exynos_camera->recording_release_ring, addrs->index);
 	if (rc < 0) {
-		ALOGE("%s: qbuf failed!", __func__);
-		goto error;
+		exynos_camera->recording_release_dropped++;
+		exynos_camera_recording_qbuf(exynos_camera, addrs->index);
+		return;
 	}
 
-error:
-	pthread_mutex_unlock(&exynos_camera->recording_mutex);
+	exynos_v4l2_events_wakeup(exynos_camera, &exynos_camera->recording_events);
 }
 
 int exynos_camera_recording_start(struct exynos_camera *exynos_camera)
 {
+	struct exynos_v4l2_deferred_ctrls ctrls;
 	int width, height, format;
 	int fd;
+	pthread_attr_t thread_attr;
 
 	int rc;
 	int i;
@@ -2420,6 +3896,12 @@ int exynos_camera_recording_start(struct exynos_camera *exynos_camera)
 		return 0;
 	}
 
+	rc = exynos_camera_recording_node_init(exynos_camera);
+	if (rc < 0) {
+		ALOGE("%s: Unable to init recording node", __func__);
+		goto error;
+	}
+
 	// V4L2
 
 	format = exynos_camera->recording_format;
@@ -2439,12 +3921,8 @@ int exynos_camera_recording_start(struct exynos_camera *exynos_camera)
 		goto error;
 	}
 
-	for (i = EXYNOS_CAMERA_MAX_BUFFERS_COUNT; i >= EXYNOS_CAMERA_MIN_BUFFERS_COUNT; i--) {
-		rc = exynos_v4l2_reqbufs_cap(exynos_camera, 2, i);
-		if (rc >= 0)
-			break;
-	}
-
+	rc = exynos_v4l2_reqbufs_negotiate(exynos_camera, 2, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+		V4L2_MEMORY_MMAP, width, height, format);
 	if (rc < 0) {
 		ALOGE("%s: reqbufs failed!", __func__);
 		goto error;
@@ -2453,27 +3931,20 @@ int exynos_camera_recording_start(struct exynos_camera *exynos_camera)
 	exynos_camera->recording_buffers_count = rc;
 	ALOGD("Found %d recording buffers available!", exynos_camera->recording_buffers_count);
 
-	for (i = 0; i < exynos_camera->recording_buffers_count; i++) {
-		rc = exynos_v4l2_querybuf_cap(exynos_camera, 2, i);
-		if (rc < 0) {
-			ALOGE("%s: querybuf failed!", __func__);
-			goto error;
-		}
+	rc = exynos_v4l2_querybuf_negotiate(exynos_camera, 2, V4L2_BUF_TYPE_VIDEO_CAPTURE,
+		V4L2_MEMORY_MMAP, width, height, format, exynos_camera->recording_buffers_count);
+	if (rc < 0) {
+		ALOGE("%s: querybuf failed!", __func__);
+		goto error;
 	}
 
-	if (exynos_camera->callbacks.request_memory != NULL) {
-		if (exynos_camera->recording_memory != NULL && exynos_camera->recording_memory->release != NULL)
-			exynos_camera->recording_memory->release(exynos_camera->recording_memory);
+	if (exynos_camera->recording_memory != NULL)
+		exynos_memory_put(exynos_camera, exynos_camera->recording_memory);
 
-		exynos_camera->recording_memory =
-			exynos_camera->callbacks.request_memory(-1, sizeof(struct exynos_camera_addrs),
-				exynos_camera->recording_buffers_count, 0);
-		if (exynos_camera->recording_memory == NULL) {
-			ALOGE("%s: memory request failed!", __func__);
-			goto error;
-		}
-	} else {
-		ALOGE("%s: No memory request function!", __func__);
+	exynos_camera->recording_memory = exynos_memory_get(exynos_camera,
+		sizeof(struct exynos_camera_addrs), exynos_camera->recording_buffers_count);
+	if (exynos_camera->recording_memory == NULL) {
+		ALOGE("%s: memory request failed!", __func__);
 		goto error;
 	}
 
@@ -2485,22 +3956,19 @@ int exynos_camera_recording_start(struct exynos_camera *exynos_camera)
 		}
 	}
 
-	rc = exynos_v4l2_s_ctrl(exynos_camera, 2, V4L2_CID_ROTATION,
-		exynos_camera->camera_rotation);
-	if (rc < 0) {
-		ALOGE("%s: s ctrl failed!", __func__);
-		goto error;
-	}
+	exynos_camera_ring_reset(&exynos_camera->recording_release_ring);
+	exynos_camera->recording_buffers_queued = exynos_camera->recording_buffers_count;
+	exynos_camera->recording_release_dropped = 0;
+	exynos_camera->recording_release_late = 0;
+	exynos_camera->recording_timestamp = 0;
+	exynos_camera->recording_timestamp_interval = 0;
 
-	rc = exynos_v4l2_s_ctrl(exynos_camera, 2, V4L2_CID_HFLIP,
-		exynos_camera->camera_hflip);
-	if (rc < 0) {
-		ALOGE("%s: s ctrl failed!", __func__);
-		goto error;
-	}
+	memset(&ctrls, 0, sizeof(ctrls));
+	exynos_v4l2_ctrls_defer(&ctrls, V4L2_CID_ROTATION, exynos_camera->camera_rotation);
+	exynos_v4l2_ctrls_defer(&ctrls, V4L2_CID_HFLIP, exynos_camera->camera_hflip);
+	exynos_v4l2_ctrls_defer(&ctrls, V4L2_CID_VFLIP, exynos_camera->camera_vflip);
 
-	rc = exynos_v4l2_s_ctrl(exynos_camera, 2, V4L2_CID_VFLIP,
-		exynos_camera->camera_vflip);
+	rc = exynos_v4l2_ctrls_flush(exynos_camera, 2, &ctrls);
 	if (rc < 0) {
 		ALOGE("%s: s ctrl failed!", __func__);
 		goto error;
@@ -2513,7 +3981,7 @@ int exynos_camera_recording_start(struct exynos_camera *exynos_camera)
 	} else {
 		// Scene mode
 		char *scene_mode_string;
-		scene_mode_string = exynos_param_string_get(exynos_camera, "scene-mode");
+		scene_mode_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_SCENE_MODE);
 		if (scene_mode_string != NULL &&
 			strcmp(scene_mode_string, "auto") != 0) {
 				ALOGE("%s: Forcing scene-mode %a after recording", __func__, scene_mode_string);
@@ -2526,8 +3994,41 @@ int exynos_camera_recording_start(struct exynos_camera *exynos_camera)
 	}
 	pthread_mutex_init(&exynos_camera->recording_mutex, NULL);
 
+	// Events
+
+	rc = exynos_v4l2_events_init(exynos_camera, &exynos_camera->recording_events);
+	if (rc < 0) {
+		ALOGE("%s: Unable to init events", __func__);
+		goto error;
+	}
+
+	rc = exynos_v4l2_events_register(exynos_camera, &exynos_camera->recording_events, 2,
+		exynos_camera_recording);
+	if (rc < 0) {
+		ALOGE("%s: Unable to register events", __func__);
+		goto error;
+	}
+
 	exynos_camera->recording_enabled = 1;
 
+	// Thread
+
+	// Joinable, so that stopping waits for it before releasing its buffers
+	pthread_attr_init(&thread_attr);
+	pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
+
+	exynos_camera->recording_thread_running = 1;
+
+	rc = pthread_create(&exynos_camera->recording_thread, &thread_attr,
+		exynos_camera_recording_thread, (void *) exynos_camera);
+	if (rc != 0) {
+		ALOGE("%s: Unable to create thread", __func__);
+		exynos_camera->recording_thread_running = 0;
+		goto error;
+	}
+
+	exynos_camera->recording_thread_joinable = 1;
+
 	return 0;
 error:
 	return -1;
@@ -2545,18 +4046,35 @@ void exynos_camera_recording_stop(struct exynos_camera *exynos_camera)
 		return;
 	}
 
-	//Disables the capture routine in exynos_camera_preview running in seperate thread.
+	//Disables the capture routine in the recording thread.
 	exynos_camera->recording_enabled = 0;
 
+	exynos_v4l2_events_wakeup(exynos_camera, &exynos_camera->recording_events);
+
+	pthread_mutex_lock(&exynos_camera->recording_mutex);
+
 	//Stop recording the stream.
 	rc = exynos_v4l2_streamoff_cap(exynos_camera, 2);
 	if (rc < 0) {
 		ALOGE("%s: streamoff failed!", __func__);
 	}
 
+	pthread_mutex_unlock(&exynos_camera->recording_mutex);
+
+	// The thread uses the events and the recording buffers until it exits
+	if (exynos_camera->recording_thread_joinable) {
+		pthread_join(exynos_camera->recording_thread, NULL);
+		exynos_camera->recording_thread_joinable = 0;
+	}
+
+	exynos_v4l2_events_deinit(exynos_camera, &exynos_camera->recording_events);
+
+	ALOGD("%s: Recording buffers released late: %d, dropped from ring: %d", __func__,
+		exynos_camera->recording_release_late, exynos_camera->recording_release_dropped);
+
 	//Release allocated recording-memory
-	if (exynos_camera->recording_memory != NULL && exynos_camera->recording_memory->release != NULL) {
-		exynos_camera->recording_memory->release(exynos_camera->recording_memory);
+	if (exynos_camera->recording_memory != NULL) {
+		exynos_memory_put(exynos_camera, exynos_camera->recording_memory);
 		exynos_camera->recording_memory = NULL;
 	}
 
@@ -2873,6 +4391,10 @@ int exynos_camera_take_picture(struct camera_device *dev)
 
 	exynos_camera = (struct exynos_camera *) dev->priv;
 
+	// Stopping preview would leave a gap in the recording
+	if (exynos_camera->recording_enabled)
+		return exynos_camera_picture_snapshot_start(exynos_camera);
+
 	return exynos_camera_picture_start(exynos_camera);
 }
 
@@ -2887,7 +4409,10 @@ int exynos_camera_cancel_picture(struct camera_device *dev)
 
 	exynos_camera = (struct exynos_camera *) dev->priv;
 
-	exynos_camera_picture_stop(exynos_camera);
+	exynos_camera_picture_snapshot_stop(exynos_camera);
+
+	if (exynos_camera->picture_enabled)
+		exynos_camera_picture_stop(exynos_camera);
 
 	return 0;
 }
@@ -2905,13 +4430,16 @@ int exynos_camera_set_parameters(struct camera_device *dev,
 
 	exynos_camera = (struct exynos_camera *) dev->priv;
 
+	// The preview thread may be running the params handlers
+	pthread_mutex_lock(&exynos_camera->params_mutex);
 	rc = exynos_params_string_set(exynos_camera, (char *) params);
+	pthread_mutex_unlock(&exynos_camera->params_mutex);
 	if (rc < 0) {
 		ALOGE("%s: Unable to set params string", __func__);
 		return -1;
 	}
 
-	char *recording_hint_string = exynos_param_string_get(exynos_camera, "recording-hint");
+	char *recording_hint_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_RECORDING_HINT);
 	int cam_mode = 0; // photo
 	if (recording_hint_string != NULL && strcmp(recording_hint_string, "true") == 0) {
 		cam_mode = 1; // video
@@ -2938,7 +4466,9 @@ char *exynos_camera_get_parameters(struct camera_device *dev)
 
 	exynos_camera = (struct exynos_camera *) dev->priv;
 
+	pthread_mutex_lock(&exynos_camera->params_mutex);
 	params = exynos_params_string_get(exynos_camera);
+	pthread_mutex_unlock(&exynos_camera->params_mutex);
 	if (params == NULL) {
 		ALOGE("%s: Couldn't find any param", __func__);
 		return strdup("");
@@ -2979,6 +4509,11 @@ void exynos_camera_release(struct camera_device *dev)
 		exynos_camera->preview_memory = NULL;
 	}
 
+	if (exynos_camera->preview_callback_memory != NULL) {
+		exynos_memory_put(exynos_camera, exynos_camera->preview_callback_memory);
+		exynos_camera->preview_callback_memory = NULL;
+	}
+
 	if (exynos_camera->picture_memory != NULL && exynos_camera->picture_memory->release != NULL) {
 		exynos_camera->picture_memory->release(exynos_camera->picture_memory);
 		exynos_camera->picture_memory = NULL;
@@ -2989,9 +4524,16 @@ void exynos_camera_release(struct camera_device *dev)
 
 int exynos_camera_dump(struct camera_device *dev, int fd)
 {
+	struct exynos_camera *exynos_camera;
+
 	ALOGD("%s(%p, %d)", __func__, dev, fd);
 
-	return 0;
+	if (dev == NULL || dev->priv == NULL)
+		return -EINVAL;
+
+	exynos_camera = (struct exynos_camera *) dev->priv;
+
+	return exynos_stats_dump(exynos_camera, fd);
 }
 
 /*
@@ -3065,6 +4607,8 @@ int exynos_camera_open(const struct hw_module_t* module, const char *camera_id,
 
 	exynos_camera = calloc(1, sizeof(struct exynos_camera));
 	exynos_camera->config = exynos_camera_config;
+	exynos_camera->open_time = systemTime(SYSTEM_TIME_MONOTONIC);
+	exynos_stats_reset(exynos_camera);
 
 	if (exynos_camera->config->presets_count > EXYNOS_CAMERA_MAX_PRESETS_COUNT ||
 		exynos_camera->config->v4l2_nodes_count > EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT)
@@ -36,6 +36,16 @@
 #define EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT	4
 #define EXYNOS_CAMERA_MIN_BUFFERS_COUNT		3
 #define EXYNOS_CAMERA_MAX_BUFFERS_COUNT		8
+#define EXYNOS_CAMERA_RING_SIZE			16
+#define EXYNOS_CAMERA_BURST_MAX			8
+#define EXYNOS_CAMERA_BURST_QUEUE_SIZE		2
+#define EXYNOS_CAMERA_PREVIEW_CALLBACK_BUFFERS_COUNT	3
+#define EXYNOS_EXIF_TEMPLATE_POSITIONS_MAX	32
+#define EXYNOS_V4L2_DEFERRED_CTRLS_MAX		32
+#define EXYNOS_V4L2_BUFFERS_CACHE_SIZE		8
+#define EXYNOS_STATS_BUCKETS_COUNT		10
+#define EXYNOS_MEMORY_POOL_SIZE			8
+#define EXYNOS_MEMORY_POOL_IDLE_MAX		(8 * 1024 * 1024)
 
 #define EXYNOS_CAMERA_MSG_ENABLED(msg) \
 	(exynos_camera->messages_enabled & msg)
@@ -53,9 +63,111 @@ enum m5mo_af_status {
 	M5MO_AF_STATUS_1ST_SUCCESS = 4,
 };
 
-struct list_head {
-	struct list_head *next;
-	struct list_head *prev;
+enum exynos_camera_focus_state {
+	EXYNOS_CAMERA_FOCUS_IDLE = 0,
+	EXYNOS_CAMERA_FOCUS_PENDING,
+	EXYNOS_CAMERA_FOCUS_SCANNING,
+	EXYNOS_CAMERA_FOCUS_CONTINUOUS,
+};
+
+enum exynos_stats_key {
+	EXYNOS_STATS_PREVIEW_POLL = 0,
+	EXYNOS_STATS_PREVIEW_DQBUF,
+	EXYNOS_STATS_PREVIEW_WINDOW_DEQUEUE,
+	EXYNOS_STATS_PREVIEW_WINDOW_LOCK,
+	EXYNOS_STATS_PREVIEW_COPY,
+	EXYNOS_STATS_PREVIEW_WINDOW_ENQUEUE,
+	EXYNOS_STATS_PREVIEW_CONVERT,
+	EXYNOS_STATS_PREVIEW_CALLBACK,
+	EXYNOS_STATS_PREVIEW_SETTINGS,
+	EXYNOS_STATS_PREVIEW_INTERVAL,
+	EXYNOS_STATS_PREVIEW_LATENCY,
+	EXYNOS_STATS_PREVIEW_JITTER,
+	EXYNOS_STATS_RECORDING_POLL,
+	EXYNOS_STATS_RECORDING_DQBUF,
+	EXYNOS_STATS_RECORDING_CALLBACK,
+	EXYNOS_STATS_RECORDING_INTERVAL,
+	EXYNOS_STATS_RECORDING_LATENCY,
+	EXYNOS_STATS_RECORDING_JITTER,
+	EXYNOS_STATS_AUTO_FOCUS,
+	EXYNOS_STATS_SHUTTER_TO_JPEG,
+	EXYNOS_STATS_OPEN_TO_PREVIEW,
+	EXYNOS_STATS_KEYS_COUNT,
+};
+
+enum exynos_stats_counter {
+	EXYNOS_STATS_PREVIEW_FRAMES = 0,
+	EXYNOS_STATS_PREVIEW_DROPPED,
+	EXYNOS_STATS_PREVIEW_TIMEOUTS,
+	EXYNOS_STATS_PREVIEW_CALLBACK_SKIPPED,
+	EXYNOS_STATS_RECORDING_FRAMES,
+	EXYNOS_STATS_RECORDING_DROPPED,
+	EXYNOS_STATS_RECORDING_TIMEOUTS,
+	EXYNOS_STATS_PICTURES,
+	EXYNOS_STATS_COUNTERS_COUNT,
+};
+
+enum exynos_param_key {
+	EXYNOS_PARAM_KEY_PREFERRED_PREVIEW_SIZE_FOR_VIDEO,
+	EXYNOS_PARAM_KEY_PREVIEW_SIZE_VALUES,
+	EXYNOS_PARAM_KEY_PREVIEW_SIZE,
+	EXYNOS_PARAM_KEY_PREVIEW_FORMAT_VALUES,
+	EXYNOS_PARAM_KEY_PREVIEW_FORMAT,
+	EXYNOS_PARAM_KEY_PREVIEW_FRAME_RATE_VALUES,
+	EXYNOS_PARAM_KEY_PREVIEW_FRAME_RATE,
+	EXYNOS_PARAM_KEY_PREVIEW_FPS_RANGE_VALUES,
+	EXYNOS_PARAM_KEY_PREVIEW_FPS_RANGE,
+	EXYNOS_PARAM_KEY_PICTURE_SIZE_VALUES,
+	EXYNOS_PARAM_KEY_PICTURE_SIZE,
+	EXYNOS_PARAM_KEY_PICTURE_FORMAT_VALUES,
+	EXYNOS_PARAM_KEY_PICTURE_FORMAT,
+	EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_SIZE_VALUES,
+	EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_WIDTH,
+	EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_HEIGHT,
+	EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_QUALITY,
+	EXYNOS_PARAM_KEY_JPEG_QUALITY,
+	EXYNOS_PARAM_KEY_NUM_SNAPS_PER_SHUTTER,
+	EXYNOS_PARAM_KEY_VIDEO_SNAPSHOT_SUPPORTED,
+	EXYNOS_PARAM_KEY_FULL_VIDEO_SNAP_SUPPORTED,
+	EXYNOS_PARAM_KEY_VIDEO_SIZE,
+	EXYNOS_PARAM_KEY_VIDEO_SIZE_VALUES,
+	EXYNOS_PARAM_KEY_VIDEO_FRAME_FORMAT,
+	EXYNOS_PARAM_KEY_FOCUS_MODE,
+	EXYNOS_PARAM_KEY_FOCUS_MODE_VALUES,
+	EXYNOS_PARAM_KEY_FOCUS_DISTANCES,
+	EXYNOS_PARAM_KEY_FOCUS_AREAS,
+	EXYNOS_PARAM_KEY_MAX_NUM_FOCUS_AREAS,
+	EXYNOS_PARAM_KEY_TOUCH_AF_AEC,
+	EXYNOS_PARAM_KEY_ZOOM_SUPPORTED,
+	EXYNOS_PARAM_KEY_SMOOTH_ZOOM_SUPPORTED,
+	EXYNOS_PARAM_KEY_ZOOM_RATIOS,
+	EXYNOS_PARAM_KEY_ZOOM,
+	EXYNOS_PARAM_KEY_MAX_ZOOM,
+	EXYNOS_PARAM_KEY_FLASH_MODE,
+	EXYNOS_PARAM_KEY_FLASH_MODE_VALUES,
+	EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION,
+	EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION_STEP,
+	EXYNOS_PARAM_KEY_MIN_EXPOSURE_COMPENSATION,
+	EXYNOS_PARAM_KEY_MAX_EXPOSURE_COMPENSATION,
+	EXYNOS_PARAM_KEY_WHITEBALANCE,
+	EXYNOS_PARAM_KEY_WHITEBALANCE_VALUES,
+	EXYNOS_PARAM_KEY_SCENE_MODE,
+	EXYNOS_PARAM_KEY_SCENE_MODE_VALUES,
+	EXYNOS_PARAM_KEY_EFFECT,
+	EXYNOS_PARAM_KEY_EFFECT_VALUES,
+	EXYNOS_PARAM_KEY_ISO,
+	EXYNOS_PARAM_KEY_ISO_VALUES,
+	EXYNOS_PARAM_KEY_FOCAL_LENGTH,
+	EXYNOS_PARAM_KEY_HORIZONTAL_VIEW_ANGLE,
+	EXYNOS_PARAM_KEY_VERTICAL_VIEW_ANGLE,
+	EXYNOS_PARAM_KEY_RECORDING_HINT,
+	EXYNOS_PARAM_KEY_ROTATION,
+	EXYNOS_PARAM_KEY_GPS_LATITUDE,
+	EXYNOS_PARAM_KEY_GPS_LONGITUDE,
+	EXYNOS_PARAM_KEY_GPS_ALTITUDE,
+	EXYNOS_PARAM_KEY_GPS_TIMESTAMP,
+	EXYNOS_PARAM_KEY_GPS_PROCESSING_METHOD,
+	EXYNOS_PARAM_KEYS_COUNT,
 };
 
 enum exynos_param_type {
@@ -70,12 +182,151 @@ union exynos_param_data {
 	char *string;
 };
 
-struct exynos_param {
-	struct list_head list;
+#define EXYNOS_PARAM_SET			(1 << 0)
+#define EXYNOS_PARAM_DIRTY			(1 << 1)
 
+struct exynos_param {
 	char *key;
+	unsigned int hash;
 	union exynos_param_data data;
 	enum exynos_param_type type;
+	int flags;
+};
+
+struct exynos_camera;
+
+struct exynos_camera_ring {
+	unsigned int head;
+	unsigned int tail;
+	int values[EXYNOS_CAMERA_RING_SIZE];
+};
+
+struct exynos_jpeg {
+	int fd;
+	void *in_buffer;
+	int in_size;
+	void *out_buffer;
+};
+
+struct exynos_exif_template {
+	exif_attribute_t static_attributes;
+	int static_attributes_created;
+
+	// EXIF bytes up to the thumbnail data
+	void *data;
+	int size;
+
+	// Layout key
+	int gps;
+	int gps_processing_method_length;
+	int thumb;
+
+	// Offsets of the per-shot values within data, -1 when absent
+	int positions[EXYNOS_EXIF_TEMPLATE_POSITIONS_MAX];
+	int gps_processing_method_position;
+	int thumb_size_position;
+};
+
+struct exynos_camera_picture_frame {
+	camera_memory_t *data_memory;
+	camera_memory_t *jpeg_thumbnail_data_memory;
+	int jpeg_thumbnail_size;
+	// EXIF space kept in data_memory right after the SOI marker
+	exif_attribute_t exif_attributes;
+	int exif_size;
+	int width;
+	int height;
+};
+
+#define EXYNOS_V4L2_EVENTS_WAKEUP		0xffffffff
+
+struct exynos_v4l2_buffers {
+	int exynos_v4l2_id;
+	int type;
+	int memory;
+	int width;
+	int height;
+	int fmt;
+
+	int count;
+	int length;
+};
+
+// Backend of the V4L2 file ops, the device nodes unless a stand-in is used
+struct exynos_v4l2_ops {
+	int (*open)(int exynos_v4l2_id, const char *node);
+	void (*close)(int fd);
+	int (*ioctl)(int fd, int request, void *data);
+	// Optional, the fd to map buffers from when it is not the node fd
+	int (*mmap_fd)(int fd);
+};
+
+struct exynos_v4l2_deferred_ctrls {
+	struct v4l2_ext_control controls[EXYNOS_V4L2_DEFERRED_CTRLS_MAX];
+	int count;
+};
+
+struct exynos_v4l2_events_node {
+	int id;
+	int fd;
+	int (*ready)(struct exynos_camera *exynos_camera, int exynos_v4l2_id);
+};
+
+struct exynos_v4l2_events {
+	int epoll_fd;
+	int wakeup_fd;
+	struct exynos_v4l2_events_node nodes[EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT];
+	int nodes_count;
+};
+
+// Durations in ns
+struct exynos_stats_histogram {
+	int64_t count;
+	int64_t total;
+	int64_t min;
+	int64_t max;
+	int64_t buckets[EXYNOS_STATS_BUCKETS_COUNT];
+};
+
+struct exynos_stats {
+	struct exynos_stats_histogram histograms[EXYNOS_STATS_KEYS_COUNT];
+	int64_t counters[EXYNOS_STATS_COUNTERS_COUNT];
+	int64_t start_time;
+};
+
+struct exynos_memory_entry {
+	camera_memory_t *memory;
+	int size;
+	int count;
+	int used;
+	int64_t release_time;
+};
+
+struct exynos_memory_pool {
+	struct exynos_memory_entry entries[EXYNOS_MEMORY_POOL_SIZE];
+	pthread_mutex_t mutex;
+
+	// Bytes allocated through the pool, in use or idle
+	int bytes;
+	int bytes_idle;
+	int bytes_max;
+
+	int hits;
+	int misses;
+	int evictions;
+};
+
+struct exynos_camera_params_handler {
+	enum exynos_param_key keys[3];
+	int keys_count;
+	int (*apply)(struct exynos_camera *exynos_camera, int force);
+};
+
+// Param changes waiting for a preview frame boundary, merged until applied
+struct exynos_camera_settings {
+	int dirty[EXYNOS_PARAM_KEYS_COUNT];
+	int force;
+	int pending;
 };
 
 struct exynos_camera_params {
@@ -181,10 +432,41 @@ struct exynos_camera_callbacks {
 };
 
 struct exynos_camera {
+	struct exynos_v4l2_ops *v4l2_ops;
 	int v4l2_fds[EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT];
+	int v4l2_ext_ctrls_unsupported[EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT];
+
+	// Capture time of the last dequeued buffer in the systemTime clock, 0 if unknown
+	int64_t v4l2_timestamps[EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT];
+
+	// Negotiated buffers, per node and format
+	struct exynos_v4l2_buffers v4l2_buffers[EXYNOS_V4L2_BUFFERS_CACHE_SIZE];
+	int v4l2_buffers_next;
 
 	struct exynox_camera_config *config;
+	int id;
+
+	// Both release and close deinit the camera
+	int initialized;
+
+	// Pipeline stats, dumped by dumpsys media.camera
+	struct exynos_stats stats;
+
+	// Callback memory kept across preview and recording restarts
+	struct exynos_memory_pool memory_pool;
+
+	// Open to first preview frame latency, in ns
+	int64_t open_time;
+	int64_t open_latency;
+
 	struct exynos_param *params;
+	int params_count;
+	int params_size;
+	int *params_table;
+	int params_table_size;
+	unsigned int params_generation;
+	char *params_string;
+	unsigned int params_string_generation;
 
 	struct exynos_camera_callbacks callbacks;
 	int messages_enabled;
@@ -199,21 +481,62 @@ struct exynos_camera {
 	int picture_enabled;
 	camera_memory_t *picture_memory;
 	int picture_buffer_length;
+	unsigned int picture_buffer_offset;
+	int picture_camera_format;
+
+	// Hardware JPEG encoder session
+	struct exynos_jpeg jpeg;
+
+	// EXIF layout reused across shots
+	struct exynos_exif_template exif_template;
+	pthread_mutex_t exif_mutex;
+
+	// Burst frames waiting for EXIF and callbacks
+	pthread_t picture_burst_thread;
+	pthread_mutex_t picture_burst_mutex;
+	pthread_cond_t picture_burst_cond;
+	struct exynos_camera_picture_frame picture_burst_frames[EXYNOS_CAMERA_BURST_QUEUE_SIZE];
+	int picture_burst_head;
+	int picture_burst_count;
+	int picture_burst_done;
+
+	// Video snapshot, encoded from a preview frame while recording
+	pthread_t picture_snapshot_thread;
+	pthread_mutex_t picture_snapshot_mutex;
+	int picture_snapshot_pending;
+	int picture_snapshot_running;
+	int picture_snapshot_joinable;
+	int picture_snapshot_format;
+	int picture_snapshot_width;
+	int picture_snapshot_height;
+
+	// Shot latency, in ns
+	int64_t picture_shutter_time;
+	int64_t picture_last_shutter_time;
 
 	// Auto-focus
-	pthread_t auto_focus_thread;
 	pthread_mutex_t auto_focus_mutex;
-	int auto_focus_thread_running;
-
 	int auto_focus_enabled;
+	int focus_state;
+	int focus_moving;
+
+	// Auto-focus latency, in ns
+	int64_t auto_focus_time;
+	int64_t auto_focus_latency;
 
 	// Preview
 	pthread_t preview_thread;
+	struct exynos_v4l2_events preview_events;
 	pthread_mutex_t preview_mutex;
 	pthread_mutex_t preview_lock_mutex;
 	int preview_thread_running;
 	int preview_thread_started;
+	int preview_thread_joinable;
 	int preview_waiting_for_window;
+	int64_t preview_poll_time;
+	int64_t preview_frame_time;
+	int64_t preview_timestamp;
+	int64_t preview_timestamp_interval;
 
 	int preview_enabled;
 	struct preview_stream_ops *preview_window;
@@ -222,8 +545,39 @@ struct exynos_camera {
 	int preview_frame_size;
 	int preview_params_set;
 
+	// Preview buffers kept mapped across a capture (FIMC1 is shared)
+	int preview_paused;
+	int preview_armed;
+	int preview_armed_width;
+	int preview_armed_height;
+	int preview_armed_format;
+	int preview_armed_fps;
+	int preview_armed_buffers_count;
+	unsigned int preview_armed_offsets[EXYNOS_CAMERA_MAX_BUFFERS_COUNT];
+
+	// Preview callback frames, converted for the app
+	pthread_t preview_callback_thread;
+	pthread_mutex_t preview_callback_mutex;
+	pthread_cond_t preview_callback_cond;
+	int preview_callback_thread_running;
+	camera_memory_t *preview_callback_memory;
+	int preview_callback_format;
+	int preview_callback_frame_size;
+	int preview_callback_head;
+	int preview_callback_count;
+	int preview_callback_busy;
+
 	// Recording
+	int recording_node_opened;
+	pthread_t recording_thread;
+	struct exynos_v4l2_events recording_events;
 	pthread_mutex_t recording_mutex;
+	int recording_thread_running;
+	int recording_thread_joinable;
+	int64_t recording_poll_time;
+	int64_t recording_frame_time;
+	int64_t recording_timestamp;
+	int64_t recording_timestamp_interval;
 
 	int recording_enabled;
 	int recording_msg_start;
@@ -231,6 +585,18 @@ struct exynos_camera {
 	int recording_msg_stop;
 	camera_memory_t *recording_memory;
 	int recording_buffers_count;
+	int recording_buffers_queued;
+	struct exynos_camera_ring recording_release_ring;
+	int recording_release_dropped;
+	int recording_release_late;
+
+	// Controls set by params, deferred and flushed in order between frames
+	struct exynos_v4l2_deferred_ctrls params_deferred_ctrls;
+	pthread_mutex_t params_deferred_ctrls_mutex;
+
+	// Params changes applied by the preview thread between frames
+	struct exynos_camera_settings params_settings;
+	pthread_mutex_t params_mutex;
 
 	// Camera params
 	int camera_rotation;
@@ -255,6 +621,7 @@ struct exynos_camera {
 	int jpeg_thumbnail_height;
 	int jpeg_thumbnail_quality;
 	int jpeg_quality;
+	int burst_capture;
 	int recording_width;
 	int recording_height;
 	int recording_format;
@@ -295,19 +662,46 @@ struct exynos_v4l2_ext_control {
  * Camera
  */
 
+int exynos_camera_recording_node_init(struct exynos_camera *exynos_camera);
+
 int exynos_camera_params_init(struct exynos_camera *exynos_camera, int id);
 int exynos_camera_params_apply(struct exynos_camera *exynos_camera);
+int exynos_camera_params_settings_apply(struct exynos_camera *exynos_camera);
+int exynos_camera_params_deferred_ctrls_flush(struct exynos_camera *exynos_camera);
 
+void exynos_camera_focus_poll(struct exynos_camera *exynos_camera);
 int exynos_camera_auto_focus_start(struct exynos_camera *exynos_camera);
 void exynos_camera_auto_focus_stop(struct exynos_camera *exynos_camera);
 
+int exynos_camera_picture_capture(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame, int shutter);
+int exynos_camera_picture_reserve(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame, void *picture_addr, int picture_size);
+int exynos_camera_picture_assemble(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame);
+int exynos_camera_picture_deliver(struct exynos_camera *exynos_camera,
+	struct exynos_camera_picture_frame *frame);
+int exynos_camera_picture_burst(struct exynos_camera *exynos_camera, int count);
 int exynos_camera_picture(struct exynos_camera *exynos_camera);
 int exynos_camera_picture_start(struct exynos_camera *exynos_camera);
+int exynos_camera_picture_snapshot_start(struct exynos_camera *exynos_camera);
+void exynos_camera_picture_snapshot_stop(struct exynos_camera *exynos_camera);
+void exynos_camera_picture_snapshot_grab(struct exynos_camera *exynos_camera,
+	void *data, int format);
 
-int exynos_camera_preview(struct exynos_camera *exynos_camera);
+int exynos_camera_preview(struct exynos_camera *exynos_camera, int exynos_v4l2_id);
 int exynos_camera_preview_start(struct exynos_camera *exynos_camera);
 void exynos_camera_preview_stop(struct exynos_camera *exynos_camera);
+void exynos_camera_preview_pause(struct exynos_camera *exynos_camera);
+int exynos_camera_preview_rearm(struct exynos_camera *exynos_camera);
+int exynos_camera_preview_callback_start(struct exynos_camera *exynos_camera);
+void exynos_camera_preview_callback_stop(struct exynos_camera *exynos_camera);
+
+void exynos_camera_ring_reset(struct exynos_camera_ring *ring);
+int exynos_camera_ring_push(struct exynos_camera_ring *ring, int value);
+int exynos_camera_ring_pop(struct exynos_camera_ring *ring, int *value);
 
+int exynos_camera_recording(struct exynos_camera *exynos_camera, int exynos_v4l2_id);
 int exynos_camera_recording_start(struct exynos_camera *exynos_camera);
 void exynos_camera_recording_stop(struct exynos_camera *exynos_camera);
 
@@ -320,15 +714,73 @@ int exynos_exif_attributes_create_static(struct exynos_camera *exynos_camera,
 int exynos_exif_attributes_create_params(struct exynos_camera *exynos_camera,
 	exif_attribute_t *exif_attributes);
 
-int exynos_exif_create(struct exynos_camera *exynos_camera,
+int exynos_exif_size(struct exynos_camera *exynos_camera,
+	exif_attribute_t *exif_attributes,
+	camera_memory_t *jpeg_thumbnail_data_memory, int jpeg_thumbnail_size);
+int exynos_exif_write(struct exynos_camera *exynos_camera,
 	exif_attribute_t *exif_attributes,
 	camera_memory_t *jpeg_thumbnail_data_memory, int jpeg_thumbnail_size,
-	camera_memory_t **exif_data_memory_p, int *exif_size_p);
+	void *exif_data, int exif_size);
+void exynos_exif_template_release(struct exynos_camera *exynos_camera);
+
+/*
+ * JPEG
+ */
+
+int exynos_jpeg_start(struct exynos_camera *exynos_camera);
+void exynos_jpeg_stop(struct exynos_camera *exynos_camera);
+void *exynos_jpeg_in_buffer(struct exynos_camera *exynos_camera, int size);
+int exynos_jpeg_in_size(int format, int width, int height);
+int exynos_jpeg_encode(struct exynos_camera *exynos_camera, int format,
+	int width, int height, int quality, void **out_buffer, int *out_size);
+
+/*
+ * Scale
+ */
+
+int exynos_scale(int format, void *src, int width, int height,
+	void *dst, int dst_width, int dst_height);
+
+/*
+ * Convert
+ */
+
+int exynos_convert_frame_size(int format, int width, int height);
+int exynos_convert(int format, void *src, int width, int height,
+	int dst_format, void *dst);
+
+/*
+ * Memory
+ */
+
+void exynos_memory_pool_init(struct exynos_camera *exynos_camera);
+void exynos_memory_pool_deinit(struct exynos_camera *exynos_camera);
+camera_memory_t *exynos_memory_get(struct exynos_camera *exynos_camera,
+	int size, int count);
+void exynos_memory_put(struct exynos_camera *exynos_camera, camera_memory_t *memory);
+
+/*
+ * Stats
+ */
+
+void exynos_stats_reset(struct exynos_camera *exynos_camera);
+void exynos_stats_add(struct exynos_camera *exynos_camera, enum exynos_stats_key key,
+	int64_t duration);
+int64_t exynos_stats_add_since(struct exynos_camera *exynos_camera,
+	enum exynos_stats_key key, int64_t start);
+void exynos_stats_count(struct exynos_camera *exynos_camera, enum exynos_stats_counter counter);
+void exynos_stats_timestamp(struct exynos_camera *exynos_camera,
+	enum exynos_stats_key latency_key, enum exynos_stats_key jitter_key,
+	int64_t timestamp, int64_t *last_timestamp, int64_t *last_interval);
+int exynos_stats_dump(struct exynos_camera *exynos_camera, int fd);
 
 /*
  * Param
  */
 
+int exynos_params_init(struct exynos_camera *exynos_camera);
+void exynos_params_deinit(struct exynos_camera *exynos_camera);
+
 int exynos_param_int_get(struct exynos_camera *exynos_camera,
 	char *key);
 float exynos_param_float_get(struct exynos_camera *exynos_camera,
@@ -343,6 +795,25 @@ int exynos_param_float_set(struct exynos_camera *exynos_camera,
 int exynos_param_string_set(struct exynos_camera *exynos_camera,
 	char *key, char *string);
 
+int exynos_param_int_get_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id);
+float exynos_param_float_get_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id);
+char *exynos_param_string_get_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id);
+
+int exynos_param_int_set_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id, int integer);
+int exynos_param_float_set_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id, float floating);
+int exynos_param_string_set_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id, char *string);
+
+int exynos_param_dirty_get_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id);
+void exynos_param_dirty_clear_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id);
+
 char *exynos_params_string_get(struct exynos_camera *exynos_camera);
 int exynos_params_string_set(struct exynos_camera *exynos_camera, char *string);
 
@@ -358,8 +829,26 @@ int exynos_v4l2_find_fd(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
 int exynos_v4l2_open(struct exynos_camera *exynos_camera, int id);
 void exynos_v4l2_close(struct exynos_camera *exynos_camera, int id);
 int exynos_v4l2_ioctl(struct exynos_camera *exynos_camera, int id, int request, void *data);
+int exynos_v4l2_find_mmap_fd(struct exynos_camera *exynos_camera, int exynos_v4l2_id);
 int exynos_v4l2_poll(struct exynos_camera *exynos_camera, int exynos_v4l2_id);
 
+#ifdef EXYNOS_CAMERA_FAKE_V4L2
+extern struct exynos_v4l2_ops exynos_v4l2_fake_ops;
+#endif
+
+// Events
+int exynos_v4l2_events_init(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events);
+void exynos_v4l2_events_deinit(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events);
+int exynos_v4l2_events_register(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events, int exynos_v4l2_id,
+	int (*ready)(struct exynos_camera *exynos_camera, int exynos_v4l2_id));
+int exynos_v4l2_events_wakeup(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events);
+int exynos_v4l2_events_wait(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events, int timeout);
+
 // VIDIOC
 int exynos_v4l2_qbuf(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	int type, int memory, int index);
@@ -378,9 +867,9 @@ int exynos_v4l2_reqbufs_cap(struct exynos_camera *exynos_camera, int exynos_v4l2
 int exynos_v4l2_reqbufs_out(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	int count);
 int exynos_v4l2_querybuf(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
-	int type, int memory, int index);
+	int type, int memory, int index, unsigned int *offset);
 int exynos_v4l2_querybuf_cap(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
-	int index);
+	int index, unsigned int *offset);
 int exynos_v4l2_querybuf_out(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	int index);
 int exynos_v4l2_querycap(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
@@ -421,6 +910,8 @@ int exynos_v4l2_s_input(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	int id);
 int exynos_v4l2_g_ext_ctrls(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	struct v4l2_ext_control *control, int count);
+int exynos_v4l2_s_ext_ctrls(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
+	struct v4l2_ext_control *control, int count);
 int exynos_v4l2_g_ctrl(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	int id, int *value);
 int exynos_v4l2_s_ctrl(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
@@ -442,4 +933,15 @@ int exynos_v4l2_g_fbuf(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 int exynos_v4l2_s_fbuf(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	void *base, int width, int height, int fmt);
 
+// Buffers
+int exynos_v4l2_reqbufs_negotiate(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
+	int type, int memory, int width, int height, int fmt);
+int exynos_v4l2_querybuf_negotiate(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
+	int type, int memory, int width, int height, int fmt, int count);
+
+// Controls
+int exynos_v4l2_ctrls_defer(struct exynos_v4l2_deferred_ctrls *ctrls, int id, int value);
+int exynos_v4l2_ctrls_flush(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
+	struct exynos_v4l2_deferred_ctrls *ctrls);
+
 #endif
@@ -0,0 +1,859 @@
+/*
+ * Copyright (C) 2013 Paul Kocialkowski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <cutils/ashmem.h>
+#include <hardware/camera.h>
+#include <hardware/gralloc.h>
+
+/*
+ * Drives the camera HAL through its camera_device_ops the way the camera
+ * service would, and reports frame rates, CPU time per frame and latencies.
+ * The HAL has to be built with BOARD_CAMERA_FAKE_V4L2 so that frames come
+ * from the fake FIMC/M5MO backend (see exynos_v4l2_fake.c for its
+ * debug.camera.fake.* properties).
+ */
+
+#define EXYNOS_CAMERA_BENCH_BUFFERS_MAX		16
+#define EXYNOS_CAMERA_BENCH_TIMEOUT		5000
+#define EXYNOS_CAMERA_BENCH_FPS			30
+#define EXYNOS_CAMERA_BENCH_LATENCY_MAX		200000000LL
+
+struct exynos_camera_bench_memory {
+	camera_memory_t memory;
+	size_t buffer_size;
+	size_t size;
+	int fd;
+};
+
+struct exynos_camera_bench {
+	struct preview_stream_ops window;
+
+	camera_device_t *device;
+
+	// Preview window
+	gralloc_module_t *gralloc;
+	alloc_device_t *alloc;
+	buffer_handle_t buffers[EXYNOS_CAMERA_BENCH_BUFFERS_MAX];
+	int buffers_dequeued[EXYNOS_CAMERA_BENCH_BUFFERS_MAX];
+	int buffers_count;
+	int width;
+	int height;
+	int format;
+	int usage;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+
+	// Preview frame rate, to scale the wait deadlines
+	int fps;
+
+	// Counters and times, in ns
+	int preview_frames;
+	int64_t preview_frame_time;
+	int64_t preview_timestamp;
+	int64_t preview_latency_max;
+	int preview_callbacks;
+	int preview_luma;
+
+	int recording_frames;
+	int64_t recording_timestamp;
+	int64_t recording_interval_max;
+	int64_t recording_latency_max;
+	double recording_interval_sum;
+	double recording_interval_squares;
+
+	int pictures;
+	int64_t shutter_time;
+	int64_t picture_time;
+	int picture_size;
+
+	int errors;
+};
+
+static int64_t exynos_camera_bench_time(clockid_t clock)
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+
+	return (int64_t) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static double exynos_camera_bench_ms(int64_t time)
+{
+	return (double) time / 1000000.0;
+}
+
+/*
+ * Frame timestamps come from the V4L2 buffers, converted to systemTime: they
+ * have to be in the past, but not by more than a few frames.
+ */
+static void exynos_camera_bench_timestamp_check(struct exynos_camera_bench *bench,
+	int64_t timestamp, int64_t *latency_max)
+{
+	int64_t latency;
+
+	latency = exynos_camera_bench_time(CLOCK_MONOTONIC) - timestamp;
+	if (latency < 0 || latency > EXYNOS_CAMERA_BENCH_LATENCY_MAX) {
+		printf("Timestamp %lld is %.2f ms off the monotonic clock\n", (long long) timestamp,
+			exynos_camera_bench_ms(latency));
+		bench->errors++;
+	}
+
+	if (latency > *latency_max)
+		*latency_max = latency;
+}
+
+// Waits for a counter to reach the given value, with the mutex held
+static int exynos_camera_bench_wait(struct exynos_camera_bench *bench, int *counter, int value)
+{
+	struct timespec ts;
+	int timeout;
+	int rc = 0;
+
+	// The frames still expected come on top of a fixed margin
+	timeout = EXYNOS_CAMERA_BENCH_TIMEOUT;
+	if (value > *counter)
+		timeout += (value - *counter) * 1000 / bench->fps;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += timeout / 1000;
+	ts.tv_nsec += (timeout % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	while (*counter < value && rc == 0)
+		rc = pthread_cond_timedwait(&bench->cond, &bench->mutex, &ts);
+
+	if (*counter < value) {
+		printf("Timed out waiting for %d, got %d\n", value, *counter);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Preview window
+ */
+
+static struct exynos_camera_bench *exynos_camera_bench_window_get(struct preview_stream_ops *window)
+{
+	return (struct exynos_camera_bench *) window;
+}
+
+static void exynos_camera_bench_window_free(struct exynos_camera_bench *bench)
+{
+	int i;
+
+	for (i = 0; i < EXYNOS_CAMERA_BENCH_BUFFERS_MAX; i++) {
+		if (bench->buffers[i] != NULL)
+			bench->alloc->free(bench->alloc, bench->buffers[i]);
+
+		bench->buffers[i] = NULL;
+		bench->buffers_dequeued[i] = 0;
+	}
+}
+
+static int exynos_camera_bench_dequeue_buffer(struct preview_stream_ops *window,
+	buffer_handle_t **buffer, int *stride)
+{
+	struct exynos_camera_bench *bench = exynos_camera_bench_window_get(window);
+	int rc = -1;
+	int i;
+
+	pthread_mutex_lock(&bench->mutex);
+
+	for (i = 0; i < bench->buffers_count; i++) {
+		if (bench->buffers_dequeued[i])
+			continue;
+
+		if (bench->buffers[i] == NULL) {
+			rc = bench->alloc->alloc(bench->alloc, bench->width, bench->height,
+				bench->format, bench->usage, &bench->buffers[i], stride);
+			if (rc != 0) {
+				printf("Unable to allocate window buffer\n");
+				bench->buffers[i] = NULL;
+				break;
+			}
+		}
+
+		bench->buffers_dequeued[i] = 1;
+		*buffer = &bench->buffers[i];
+		*stride = bench->width;
+		rc = 0;
+		break;
+	}
+
+	pthread_mutex_unlock(&bench->mutex);
+
+	return rc;
+}
+
+static int exynos_camera_bench_enqueue_buffer(struct preview_stream_ops *window,
+	buffer_handle_t *buffer)
+{
+	struct exynos_camera_bench *bench = exynos_camera_bench_window_get(window);
+	void *addr = NULL;
+	int luma = -1;
+	int i;
+
+	// The fake sensor brightness changes with every frame
+	if (bench->gralloc->lock(bench->gralloc, *buffer, GRALLOC_USAGE_SW_READ_OFTEN,
+		0, 0, bench->width, bench->height, &addr) == 0 && addr != NULL) {
+		luma = *((unsigned char *) addr);
+		bench->gralloc->unlock(bench->gralloc, *buffer);
+	}
+
+	pthread_mutex_lock(&bench->mutex);
+
+	i = buffer - bench->buffers;
+	if (i >= 0 && i < EXYNOS_CAMERA_BENCH_BUFFERS_MAX)
+		bench->buffers_dequeued[i] = 0;
+
+	// A stale preview mapping shows the same frame over and over
+	if (luma >= 0 && luma == bench->preview_luma) {
+		printf("Preview frame %d repeats the previous one\n", bench->preview_frames);
+		bench->errors++;
+	}
+
+	bench->preview_luma = luma;
+	bench->preview_frames++;
+	bench->preview_frame_time = exynos_camera_bench_time(CLOCK_MONOTONIC);
+
+	pthread_cond_broadcast(&bench->cond);
+	pthread_mutex_unlock(&bench->mutex);
+
+	return 0;
+}
+
+static int exynos_camera_bench_cancel_buffer(struct preview_stream_ops *window,
+	buffer_handle_t *buffer)
+{
+	struct exynos_camera_bench *bench = exynos_camera_bench_window_get(window);
+	int i;
+
+	pthread_mutex_lock(&bench->mutex);
+
+	i = buffer - bench->buffers;
+	if (i >= 0 && i < EXYNOS_CAMERA_BENCH_BUFFERS_MAX)
+		bench->buffers_dequeued[i] = 0;
+
+	pthread_mutex_unlock(&bench->mutex);
+
+	return 0;
+}
+
+static int exynos_camera_bench_set_buffer_count(struct preview_stream_ops *window, int count)
+{
+	struct exynos_camera_bench *bench = exynos_camera_bench_window_get(window);
+
+	if (count <= 0 || count > EXYNOS_CAMERA_BENCH_BUFFERS_MAX)
+		return -EINVAL;
+
+	pthread_mutex_lock(&bench->mutex);
+	exynos_camera_bench_window_free(bench);
+	bench->buffers_count = count;
+	pthread_mutex_unlock(&bench->mutex);
+
+	return 0;
+}
+
+static int exynos_camera_bench_set_buffers_geometry(struct preview_stream_ops *window,
+	int width, int height, int format)
+{
+	struct exynos_camera_bench *bench = exynos_camera_bench_window_get(window);
+
+	pthread_mutex_lock(&bench->mutex);
+	exynos_camera_bench_window_free(bench);
+	bench->width = width;
+	bench->height = height;
+	bench->format = format;
+	pthread_mutex_unlock(&bench->mutex);
+
+	return 0;
+}
+
+static int exynos_camera_bench_set_crop(struct preview_stream_ops *window,
+	int left, int top, int right, int bottom)
+{
+	return 0;
+}
+
+static int exynos_camera_bench_set_usage(struct preview_stream_ops *window, int usage)
+{
+	struct exynos_camera_bench *bench = exynos_camera_bench_window_get(window);
+
+	pthread_mutex_lock(&bench->mutex);
+	exynos_camera_bench_window_free(bench);
+	bench->usage = usage;
+	pthread_mutex_unlock(&bench->mutex);
+
+	return 0;
+}
+
+static int exynos_camera_bench_set_swap_interval(struct preview_stream_ops *window, int interval)
+{
+	return 0;
+}
+
+static int exynos_camera_bench_get_min_undequeued_buffer_count(const struct preview_stream_ops *window,
+	int *count)
+{
+	*count = 1;
+
+	return 0;
+}
+
+static int exynos_camera_bench_lock_buffer(struct preview_stream_ops *window,
+	buffer_handle_t *buffer)
+{
+	return 0;
+}
+
+static int exynos_camera_bench_set_timestamp(struct preview_stream_ops *window, int64_t timestamp)
+{
+	struct exynos_camera_bench *bench = exynos_camera_bench_window_get(window);
+
+	pthread_mutex_lock(&bench->mutex);
+
+	if (timestamp <= bench->preview_timestamp) {
+		printf("Preview timestamp went back: %lld <= %lld\n", (long long) timestamp,
+			(long long) bench->preview_timestamp);
+		bench->errors++;
+	}
+
+	bench->preview_timestamp = timestamp;
+
+	exynos_camera_bench_timestamp_check(bench, timestamp, &bench->preview_latency_max);
+
+	pthread_mutex_unlock(&bench->mutex);
+
+	return 0;
+}
+
+/*
+ * Callbacks
+ */
+
+static void exynos_camera_bench_memory_release(camera_memory_t *memory)
+{
+	struct exynos_camera_bench_memory *bench_memory;
+
+	bench_memory = (struct exynos_camera_bench_memory *) memory;
+
+	munmap(memory->data, bench_memory->size);
+	if (bench_memory->fd >= 0)
+		close(bench_memory->fd);
+
+	free(bench_memory);
+}
+
+static camera_memory_t *exynos_camera_bench_request_memory(int fd, size_t buffer_size,
+	unsigned int count, void *user)
+{
+	struct exynos_camera_bench_memory *bench_memory;
+	void *data;
+	size_t size;
+
+	size = buffer_size * count;
+
+	bench_memory = calloc(1, sizeof(struct exynos_camera_bench_memory));
+	if (bench_memory == NULL)
+		return NULL;
+
+	// Like the camera service, memory without a fd is ashmem owned by the memory
+	bench_memory->fd = -1;
+	if (fd < 0) {
+		fd = ashmem_create_region("exynos_camera_bench", size);
+		if (fd < 0)
+			goto error;
+
+		bench_memory->fd = fd;
+	}
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED)
+		goto error;
+
+	bench_memory->memory.data = data;
+	bench_memory->memory.size = size;
+	bench_memory->memory.handle = bench_memory;
+	bench_memory->memory.release = exynos_camera_bench_memory_release;
+	bench_memory->buffer_size = buffer_size;
+	bench_memory->size = size;
+
+	return &bench_memory->memory;
+
+error:
+	if (bench_memory->fd >= 0)
+		close(bench_memory->fd);
+
+	free(bench_memory);
+
+	return NULL;
+}
+
+static void exynos_camera_bench_notify(int32_t message, int32_t ext1, int32_t ext2, void *user)
+{
+	struct exynos_camera_bench *bench = (struct exynos_camera_bench *) user;
+
+	pthread_mutex_lock(&bench->mutex);
+
+	if (message == CAMERA_MSG_SHUTTER)
+		bench->shutter_time = exynos_camera_bench_time(CLOCK_MONOTONIC);
+
+	pthread_cond_broadcast(&bench->cond);
+	pthread_mutex_unlock(&bench->mutex);
+}
+
+static void exynos_camera_bench_data(int32_t message, const camera_memory_t *memory,
+	unsigned int index, camera_frame_metadata_t *metadata, void *user)
+{
+	struct exynos_camera_bench *bench = (struct exynos_camera_bench *) user;
+	unsigned char *data;
+
+	pthread_mutex_lock(&bench->mutex);
+
+	switch (message) {
+		case CAMERA_MSG_PREVIEW_FRAME:
+			bench->preview_callbacks++;
+			break;
+		case CAMERA_MSG_COMPRESSED_IMAGE:
+			data = (unsigned char *) memory->data;
+			if (memory->size < 4 || data[0] != 0xff || data[1] != 0xd8) {
+				printf("Picture isn't a JPEG\n");
+				bench->errors++;
+			}
+
+			bench->picture_time = exynos_camera_bench_time(CLOCK_MONOTONIC);
+			bench->picture_size = memory->size;
+			bench->pictures++;
+			break;
+	}
+
+	pthread_cond_broadcast(&bench->cond);
+	pthread_mutex_unlock(&bench->mutex);
+}
+
+static void exynos_camera_bench_data_timestamp(int64_t timestamp, int32_t message,
+	const camera_memory_t *memory, unsigned int index, void *user)
+{
+	struct exynos_camera_bench *bench = (struct exynos_camera_bench *) user;
+	struct exynos_camera_bench_memory *bench_memory;
+	int64_t interval;
+	void *opaque;
+
+	if (message != CAMERA_MSG_VIDEO_FRAME)
+		return;
+
+	bench_memory = (struct exynos_camera_bench_memory *) memory->handle;
+	opaque = (void *) ((unsigned char *) memory->data + index * bench_memory->buffer_size);
+
+	pthread_mutex_lock(&bench->mutex);
+
+	if (bench->recording_timestamp > 0) {
+		interval = timestamp - bench->recording_timestamp;
+
+		if (interval <= 0) {
+			printf("Recording timestamp went back: %lld <= %lld\n", (long long) timestamp,
+				(long long) bench->recording_timestamp);
+			bench->errors++;
+		} else if (interval > bench->recording_interval_max) {
+			bench->recording_interval_max = interval;
+		}
+
+		bench->recording_interval_sum += interval;
+		bench->recording_interval_squares += (double) interval * interval;
+	}
+
+	bench->recording_timestamp = timestamp;
+
+	exynos_camera_bench_timestamp_check(bench, timestamp, &bench->recording_latency_max);
+	bench->recording_frames++;
+
+	pthread_cond_broadcast(&bench->cond);
+	pthread_mutex_unlock(&bench->mutex);
+
+	// The encoder gives frames back from its own thread
+	bench->device->ops->release_recording_frame(bench->device, opaque);
+}
+
+/*
+ * Bench
+ */
+
+static int exynos_camera_bench_preview(struct exynos_camera_bench *bench, int frames)
+{
+	camera_device_t *device = bench->device;
+	int64_t cpu_time, time;
+	int64_t first_frame_time;
+	int start;
+	int rc;
+
+	time = exynos_camera_bench_time(CLOCK_MONOTONIC);
+
+	rc = device->ops->start_preview(device);
+	if (rc < 0) {
+		printf("Unable to start preview\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&bench->mutex);
+
+	rc = exynos_camera_bench_wait(bench, &bench->preview_frames, bench->preview_frames + 1);
+	first_frame_time = bench->preview_frame_time - time;
+
+	start = bench->preview_frames;
+	cpu_time = exynos_camera_bench_time(CLOCK_PROCESS_CPUTIME_ID);
+	time = exynos_camera_bench_time(CLOCK_MONOTONIC);
+
+	if (rc >= 0)
+		rc = exynos_camera_bench_wait(bench, &bench->preview_frames, start + frames);
+
+	frames = bench->preview_frames - start;
+
+	pthread_mutex_unlock(&bench->mutex);
+
+	if (rc < 0)
+		return -1;
+
+	cpu_time = exynos_camera_bench_time(CLOCK_PROCESS_CPUTIME_ID) - cpu_time;
+	time = exynos_camera_bench_time(CLOCK_MONOTONIC) - time;
+
+	printf("preview: start to first frame %.2f ms, %d frames at %.2f fps, %.3f ms CPU per frame\n",
+		exynos_camera_bench_ms(first_frame_time), frames, frames * 1000.0 / exynos_camera_bench_ms(time),
+		exynos_camera_bench_ms(cpu_time) / frames);
+
+	return 0;
+}
+
+static int exynos_camera_bench_recording(struct exynos_camera_bench *bench, int frames)
+{
+	camera_device_t *device = bench->device;
+	int64_t cpu_time, time;
+	int64_t picture_time = 0;
+	double mean, jitter;
+	int start, pictures;
+	int rc;
+	int i;
+
+	device->ops->store_meta_data_in_buffers(device, 1);
+	device->ops->enable_msg_type(device, CAMERA_MSG_VIDEO_FRAME);
+
+	pthread_mutex_lock(&bench->mutex);
+	bench->recording_timestamp = 0;
+	bench->recording_interval_max = 0;
+	bench->recording_interval_sum = 0;
+	bench->recording_interval_squares = 0;
+	start = bench->recording_frames;
+	pthread_mutex_unlock(&bench->mutex);
+
+	cpu_time = exynos_camera_bench_time(CLOCK_PROCESS_CPUTIME_ID);
+	time = exynos_camera_bench_time(CLOCK_MONOTONIC);
+
+	rc = device->ops->start_recording(device);
+	if (rc < 0) {
+		printf("Unable to start recording\n");
+		return -1;
+	}
+
+	pthread_mutex_lock(&bench->mutex);
+	rc = exynos_camera_bench_wait(bench, &bench->recording_frames, start + frames / 2);
+	pictures = bench->pictures;
+	pthread_mutex_unlock(&bench->mutex);
+
+	// Video snapshot halfway through, the recorded stream must go on
+	if (rc >= 0) {
+		device->ops->enable_msg_type(device, CAMERA_MSG_SHUTTER | CAMERA_MSG_COMPRESSED_IMAGE);
+
+		picture_time = exynos_camera_bench_time(CLOCK_MONOTONIC);
+
+		rc = device->ops->take_picture(device);
+		if (rc < 0)
+			printf("Unable to take video snapshot\n");
+	}
+
+	pthread_mutex_lock(&bench->mutex);
+
+	if (rc >= 0)
+		rc = exynos_camera_bench_wait(bench, &bench->pictures, pictures + 1);
+
+	picture_time = bench->picture_time - picture_time;
+
+	if (rc >= 0)
+		rc = exynos_camera_bench_wait(bench, &bench->recording_frames, start + frames);
+
+	frames = bench->recording_frames - start;
+
+	pthread_mutex_unlock(&bench->mutex);
+
+	device->ops->stop_recording(device);
+	device->ops->disable_msg_type(device, CAMERA_MSG_VIDEO_FRAME);
+
+	if (rc < 0)
+		return -1;
+
+	// Recording is only stopped from the preview thread
+	for (i = 0; i < EXYNOS_CAMERA_BENCH_TIMEOUT; i++) {
+		if (!device->ops->recording_enabled(device))
+			break;
+
+		usleep(1000);
+	}
+
+	cpu_time = exynos_camera_bench_time(CLOCK_PROCESS_CPUTIME_ID) - cpu_time;
+	time = exynos_camera_bench_time(CLOCK_MONOTONIC) - time;
+
+	printf("recording: %d frames at %.2f fps, %.3f ms CPU per frame, %.2f ms max frame interval\n",
+		frames, frames * 1000.0 / exynos_camera_bench_ms(time),
+		exynos_camera_bench_ms(cpu_time) / frames,
+		exynos_camera_bench_ms(bench->recording_interval_max));
+	printf("recording: video snapshot JPEG in %.2f ms\n", exynos_camera_bench_ms(picture_time));
+
+	if (frames > 1) {
+		mean = bench->recording_interval_sum / (frames - 1);
+		jitter = sqrt(bench->recording_interval_squares / (frames - 1) - mean * mean);
+
+		printf("recording: timestamp interval %.2f ms, jitter %.3f ms, %.2f ms max latency\n",
+			mean / 1000000.0, jitter / 1000000.0,
+			exynos_camera_bench_ms(bench->recording_latency_max));
+	}
+
+	// A frame dropped for the snapshot shows up as a doubled interval
+	if (bench->recording_interval_max >= 2 * time / frames) {
+		printf("Recording has a gap of %.2f ms\n", exynos_camera_bench_ms(bench->recording_interval_max));
+		bench->errors++;
+	}
+
+	return 0;
+}
+
+/*
+ * Like the camera service, preview is started again once the JPEG is in,
+ * so a shot goes from take_picture to the first preview frame after it.
+ */
+static int exynos_camera_bench_pictures(struct exynos_camera_bench *bench, int count)
+{
+	camera_device_t *device = bench->device;
+	int64_t shutter_time = 0, picture_time = 0, preview_time = 0, shot_time = 0;
+	int64_t shot_time_max = 0;
+	int64_t time, shot;
+	int pictures, frames;
+	int rc = 0;
+	int i;
+
+	device->ops->enable_msg_type(device, CAMERA_MSG_SHUTTER | CAMERA_MSG_COMPRESSED_IMAGE);
+
+	for (i = 0; i < count; i++) {
+		pthread_mutex_lock(&bench->mutex);
+		pictures = bench->pictures;
+		pthread_mutex_unlock(&bench->mutex);
+
+		// The HAL joins its callback threads, which take the bench mutex
+		time = exynos_camera_bench_time(CLOCK_MONOTONIC);
+
+		rc = device->ops->take_picture(device);
+		if (rc < 0) {
+			printf("Unable to take picture\n");
+			break;
+		}
+
+		pthread_mutex_lock(&bench->mutex);
+
+		rc = exynos_camera_bench_wait(bench, &bench->pictures, pictures + 1);
+		if (rc < 0) {
+			pthread_mutex_unlock(&bench->mutex);
+			break;
+		}
+
+		shutter_time += bench->shutter_time - time;
+		picture_time += bench->picture_time - time;
+
+		pthread_mutex_unlock(&bench->mutex);
+
+		pthread_mutex_lock(&bench->mutex);
+		frames = bench->preview_frames;
+		pthread_mutex_unlock(&bench->mutex);
+
+		rc = device->ops->start_preview(device);
+		if (rc < 0) {
+			printf("Unable to restart preview\n");
+			break;
+		}
+
+		pthread_mutex_lock(&bench->mutex);
+		rc = exynos_camera_bench_wait(bench, &bench->preview_frames, frames + 1);
+		preview_time += bench->preview_frame_time - bench->picture_time;
+		shot = bench->preview_frame_time - time;
+		pthread_mutex_unlock(&bench->mutex);
+
+		if (rc < 0)
+			break;
+
+		shot_time += shot;
+		if (shot > shot_time_max)
+			shot_time_max = shot;
+	}
+
+	if (rc < 0)
+		return -1;
+
+	printf("pictures: %d of %d bytes, take to shutter %.2f ms, take to JPEG %.2f ms\n", count,
+		bench->picture_size, exynos_camera_bench_ms(shutter_time) / count,
+		exynos_camera_bench_ms(picture_time) / count);
+	printf("pictures: JPEG to preview frame %.2f ms, shot to shot %.2f ms (%.2f ms max)\n",
+		exynos_camera_bench_ms(preview_time) / count, exynos_camera_bench_ms(shot_time) / count,
+		exynos_camera_bench_ms(shot_time_max));
+
+	return 0;
+}
+
+static int exynos_camera_bench_fps(camera_device_t *device)
+{
+	char *parameters;
+	char *value;
+	int fps = 0;
+
+	parameters = device->ops->get_parameters(device);
+	if (parameters == NULL)
+		return EXYNOS_CAMERA_BENCH_FPS;
+
+	value = strstr(parameters, "preview-frame-rate=");
+	if (value != NULL)
+		fps = atoi(value + strlen("preview-frame-rate="));
+
+	device->ops->put_parameters(device, parameters);
+
+	return fps > 0 ? fps : EXYNOS_CAMERA_BENCH_FPS;
+}
+
+int main(int argc, char *argv[])
+{
+	struct exynos_camera_bench bench;
+	camera_module_t *module = NULL;
+	hw_device_t *device = NULL;
+	camera_device_t *camera_device;
+	int frames = 300;
+	int pictures = 10;
+	int rc;
+
+	if (argc > 1)
+		frames = atoi(argv[1]);
+
+	if (argc > 2)
+		pictures = atoi(argv[2]);
+
+	if (frames <= 0 || pictures <= 0) {
+		printf("Usage: %s [frames] [pictures]\n", argv[0]);
+		return 1;
+	}
+
+	memset(&bench, 0, sizeof(bench));
+	bench.preview_luma = -1;
+	pthread_mutex_init(&bench.mutex, NULL);
+	pthread_cond_init(&bench.cond, NULL);
+
+	bench.window.dequeue_buffer = exynos_camera_bench_dequeue_buffer;
+	bench.window.enqueue_buffer = exynos_camera_bench_enqueue_buffer;
+	bench.window.cancel_buffer = exynos_camera_bench_cancel_buffer;
+	bench.window.set_buffer_count = exynos_camera_bench_set_buffer_count;
+	bench.window.set_buffers_geometry = exynos_camera_bench_set_buffers_geometry;
+	bench.window.set_crop = exynos_camera_bench_set_crop;
+	bench.window.set_usage = exynos_camera_bench_set_usage;
+	bench.window.set_swap_interval = exynos_camera_bench_set_swap_interval;
+	bench.window.get_min_undequeued_buffer_count = exynos_camera_bench_get_min_undequeued_buffer_count;
+	bench.window.lock_buffer = exynos_camera_bench_lock_buffer;
+	bench.window.set_timestamp = exynos_camera_bench_set_timestamp;
+
+	rc = hw_get_module(GRALLOC_HARDWARE_MODULE_ID, (const hw_module_t **) &bench.gralloc);
+	if (rc != 0 || gralloc_open(&bench.gralloc->common, &bench.alloc) != 0) {
+		printf("Unable to open gralloc\n");
+		return 1;
+	}
+
+	rc = hw_get_module(CAMERA_HARDWARE_MODULE_ID, (const hw_module_t **) &module);
+	if (rc != 0 || module == NULL) {
+		printf("Unable to get camera module\n");
+		return 1;
+	}
+
+	rc = module->common.methods->open(&module->common, "0", &device);
+	if (rc != 0 || device == NULL) {
+		printf("Unable to open camera\n");
+		return 1;
+	}
+
+	camera_device = (camera_device_t *) device;
+	bench.device = camera_device;
+	bench.fps = exynos_camera_bench_fps(camera_device);
+
+	camera_device->ops->set_callbacks(camera_device, exynos_camera_bench_notify,
+		exynos_camera_bench_data, exynos_camera_bench_data_timestamp,
+		exynos_camera_bench_request_memory, &bench);
+	camera_device->ops->enable_msg_type(camera_device, CAMERA_MSG_PREVIEW_FRAME);
+	camera_device->ops->set_preview_window(camera_device, &bench.window);
+
+	rc = exynos_camera_bench_preview(&bench, frames);
+	if (rc < 0)
+		goto complete;
+
+	rc = exynos_camera_bench_recording(&bench, frames);
+	if (rc < 0)
+		goto complete;
+
+	rc = exynos_camera_bench_pictures(&bench, pictures);
+	if (rc < 0)
+		goto complete;
+
+	printf("preview callbacks: %d, %.2f ms max timestamp latency\n", bench.preview_callbacks,
+		exynos_camera_bench_ms(bench.preview_latency_max));
+
+	// HAL pipeline stats
+	camera_device->ops->dump(camera_device, STDOUT_FILENO);
+
+complete:
+	camera_device->ops->stop_preview(camera_device);
+	camera_device->ops->set_preview_window(camera_device, NULL);
+	camera_device->ops->release(camera_device);
+	device->close(device);
+
+	exynos_camera_bench_window_free(&bench);
+	gralloc_close(bench.alloc);
+
+	pthread_cond_destroy(&bench.cond);
+	pthread_mutex_destroy(&bench.mutex);
+
+	if (rc < 0 || bench.errors > 0) {
+		printf("FAILED (%d errors)\n", bench.errors);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,893 @@
+/*
+ * Copyright (C) 2013 Paul Kocialkowski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <cutils/ashmem.h>
+#include <utils/Timers.h>
+
+#include "exynos_camera.h"
+
+/*
+ * Checks for the HAL internals, linked with the HAL sources and the fake
+ * FIMC/M5MO backend. Timings are printed along, they are not checked.
+ */
+
+extern struct camera_module HAL_MODULE_INFO_SYM;
+
+static int exynos_camera_test_checks;
+static int exynos_camera_test_failures;
+
+static int exynos_camera_test_memory_requested;
+static int exynos_camera_test_memory_released;
+
+#define EXYNOS_CAMERA_TEST_CHECK(condition) \
+	exynos_camera_test_check(!!(condition), #condition, __func__, __LINE__)
+
+static void exynos_camera_test_check(int result, const char *condition,
+	const char *function, int line)
+{
+	exynos_camera_test_checks++;
+
+	if (result)
+		return;
+
+	printf("%s:%d: check failed: %s\n", function, line, condition);
+	exynos_camera_test_failures++;
+}
+
+static double exynos_camera_test_ns(nsecs_t time, int count)
+{
+	return (double) time / count;
+}
+
+/*
+ * Camera device
+ */
+
+static void exynos_camera_test_memory_release(camera_memory_t *memory)
+{
+	munmap(memory->data, memory->size);
+	close((int) (intptr_t) memory->handle);
+	free(memory);
+
+	exynos_camera_test_memory_released++;
+}
+
+static camera_memory_t *exynos_camera_test_request_memory(int fd, size_t buffer_size,
+	unsigned int count, void *user)
+{
+	camera_memory_t *memory;
+	size_t size;
+
+	size = buffer_size * count;
+
+	memory = calloc(1, sizeof(camera_memory_t));
+	if (memory == NULL)
+		return NULL;
+
+	fd = ashmem_create_region("exynos_camera_test", size);
+	if (fd < 0)
+		goto error;
+
+	memory->data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (memory->data == MAP_FAILED) {
+		close(fd);
+		goto error;
+	}
+
+	memory->size = size;
+	memory->handle = (void *) (intptr_t) fd;
+	memory->release = exynos_camera_test_memory_release;
+
+	exynos_camera_test_memory_requested++;
+
+	return memory;
+
+error:
+	free(memory);
+
+	return NULL;
+}
+
+static camera_device_t *exynos_camera_test_open(void)
+{
+	hw_device_t *device = NULL;
+	camera_device_t *camera_device;
+	int rc;
+
+	rc = HAL_MODULE_INFO_SYM.common.methods->open(&HAL_MODULE_INFO_SYM.common, "0", &device);
+	if (rc != 0 || device == NULL)
+		return NULL;
+
+	camera_device = (camera_device_t *) device;
+	camera_device->ops->set_callbacks(camera_device, NULL, NULL, NULL,
+		exynos_camera_test_request_memory, NULL);
+
+	return camera_device;
+}
+
+static void exynos_camera_test_close(camera_device_t *device)
+{
+	device->ops->release(device);
+	device->common.close(&device->common);
+}
+
+/*
+ * Params
+ */
+
+static void exynos_camera_test_params(void)
+{
+	struct exynos_camera *exynos_camera;
+	char key[32];
+	char *string;
+	char *copy;
+	int i;
+
+	exynos_camera = calloc(1, sizeof(struct exynos_camera));
+	if (exynos_camera == NULL)
+		return;
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_params_init(exynos_camera) == 0);
+
+	// Known keys are the same param by name and by id
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_int_set(exynos_camera, "zoom", 3) == 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM) == 3);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_string_set_id(exynos_camera, EXYNOS_PARAM_KEY_FOCUS_MODE, "macro") == 0);
+	string = exynos_param_string_get(exynos_camera, "focus-mode");
+	EXYNOS_CAMERA_TEST_CHECK(string != NULL && strcmp(string, "macro") == 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_float_set(exynos_camera, "focal-length", 3.43f) == 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_float_get_id(exynos_camera, EXYNOS_PARAM_KEY_FOCAL_LENGTH) == 3.43f);
+
+	// Getting with another type fails
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM) == NULL);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_string_get(exynos_camera, "unknown-key") == NULL);
+
+	// Only actual changes make a param dirty
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_dirty_get_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM));
+	exynos_param_dirty_clear_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM);
+	EXYNOS_CAMERA_TEST_CHECK(!exynos_param_dirty_get_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM));
+	exynos_param_int_set(exynos_camera, "zoom", 3);
+	EXYNOS_CAMERA_TEST_CHECK(!exynos_param_dirty_get_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM));
+	exynos_param_int_set(exynos_camera, "zoom", 4);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_dirty_get_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM));
+
+	// Separators can't make it to the params string
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_string_set(exynos_camera, "effect", "mono;zoom=1") < 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_int_set(exynos_camera, "zoom=1;effect", 1) < 0);
+
+	// Unknown keys grow the table, known ids still hold after that
+	for (i = 0; i < 200; i++) {
+		snprintf(key, sizeof(key), "test-key-%d", i);
+		EXYNOS_CAMERA_TEST_CHECK(exynos_param_int_set(exynos_camera, key, i) == 0);
+	}
+
+	for (i = 0; i < 200; i++) {
+		snprintf(key, sizeof(key), "test-key-%d", i);
+		EXYNOS_CAMERA_TEST_CHECK(exynos_param_int_get(exynos_camera, key) == i);
+	}
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_ZOOM) == 4);
+
+	exynos_params_deinit(exynos_camera);
+
+	// Known keys serialize in id order, then the others in insertion order
+	EXYNOS_CAMERA_TEST_CHECK(exynos_params_init(exynos_camera) == 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_params_string_set(exynos_camera,
+		"test-b=1;zoom=2;test-a=x;preview-size=640x480;focal-length=3.43") == 0);
+
+	string = exynos_params_string_get(exynos_camera);
+	EXYNOS_CAMERA_TEST_CHECK(string != NULL && strcmp(string,
+		"preview-size=640x480;zoom=2;focal-length=3.43;test-b=1;test-a=x") == 0);
+
+	// Cached until a param changes
+	copy = exynos_params_string_get(exynos_camera);
+	EXYNOS_CAMERA_TEST_CHECK(string != NULL && copy != NULL && strcmp(string, copy) == 0);
+	free(copy);
+
+	exynos_param_int_set(exynos_camera, "test-b", 2);
+	copy = exynos_params_string_get(exynos_camera);
+	EXYNOS_CAMERA_TEST_CHECK(copy != NULL && strstr(copy, "test-b=2") != NULL);
+	free(copy);
+
+	exynos_params_deinit(exynos_camera);
+
+	// What was serialized sets the same params again
+	EXYNOS_CAMERA_TEST_CHECK(exynos_params_init(exynos_camera) == 0);
+	if (string != NULL) {
+		EXYNOS_CAMERA_TEST_CHECK(exynos_params_string_set(exynos_camera, string) == 0);
+		copy = exynos_params_string_get(exynos_camera);
+		EXYNOS_CAMERA_TEST_CHECK(copy != NULL && strcmp(string, copy) == 0);
+		free(copy);
+		free(string);
+	}
+
+	exynos_params_deinit(exynos_camera);
+	free(exynos_camera);
+}
+
+static void exynos_camera_test_params_bench(void)
+{
+	struct exynos_camera *exynos_camera;
+	camera_device_t *device;
+	char *parameters;
+	char *string;
+	nsecs_t time;
+	int count;
+	int i;
+
+	device = exynos_camera_test_open();
+	EXYNOS_CAMERA_TEST_CHECK(device != NULL);
+	if (device == NULL)
+		return;
+
+	exynos_camera = (struct exynos_camera *) device->priv;
+
+	count = 100000;
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++)
+		exynos_param_int_get(exynos_camera, "exposure-compensation");
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("params: get by key %.1f ns\n", exynos_camera_test_ns(time, count));
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++)
+		exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION);
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("params: get by id %.1f ns\n", exynos_camera_test_ns(time, count));
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++)
+		exynos_param_int_set(exynos_camera, "exposure-compensation", i & 1);
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("params: set by key %.1f ns\n", exynos_camera_test_ns(time, count));
+
+	parameters = device->ops->get_parameters(device);
+	EXYNOS_CAMERA_TEST_CHECK(parameters != NULL);
+	if (parameters == NULL)
+		goto complete;
+
+	count = 10000;
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++)
+		exynos_params_string_set(exynos_camera, parameters);
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("params: string set %.1f us\n", exynos_camera_test_ns(time, count) / 1000);
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++) {
+		exynos_param_int_set(exynos_camera, "exposure-compensation", i & 1);
+		string = exynos_params_string_get(exynos_camera);
+		free(string);
+	}
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("params: string get %.1f us\n", exynos_camera_test_ns(time, count) / 1000);
+
+	device->ops->put_parameters(device, parameters);
+
+	// Whole set_parameters, with the ctrls going to the fake M5MO
+	count = 1000;
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++) {
+		exynos_param_int_set(exynos_camera, "exposure-compensation", i & 1);
+		parameters = device->ops->get_parameters(device);
+		EXYNOS_CAMERA_TEST_CHECK(device->ops->set_parameters(device, parameters) == 0);
+		device->ops->put_parameters(device, parameters);
+	}
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("params: get, set and apply %.1f us\n", exynos_camera_test_ns(time, count) / 1000);
+
+complete:
+	exynos_camera_test_close(device);
+}
+
+/*
+ * Ring
+ */
+
+#define EXYNOS_CAMERA_TEST_RING_VALUES		100000
+
+static void *exynos_camera_test_ring_consumer(void *data)
+{
+	struct exynos_camera_ring *ring = (struct exynos_camera_ring *) data;
+	int expected = 0;
+	int value;
+
+	while (expected < EXYNOS_CAMERA_TEST_RING_VALUES) {
+		if (exynos_camera_ring_pop(ring, &value) < 0) {
+			sched_yield();
+			continue;
+		}
+
+		if (value != expected)
+			break;
+
+		expected++;
+	}
+
+	return (void *) (intptr_t) expected;
+}
+
+static void exynos_camera_test_ring(void)
+{
+	struct exynos_camera_ring ring;
+	pthread_t thread;
+	void *result;
+	nsecs_t time;
+	int value;
+	int i;
+
+	exynos_camera_ring_reset(&ring);
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_ring_pop(&ring, &value) < 0);
+
+	// Full at EXYNOS_CAMERA_RING_SIZE, first in first out
+	for (i = 0; i < EXYNOS_CAMERA_RING_SIZE; i++)
+		EXYNOS_CAMERA_TEST_CHECK(exynos_camera_ring_push(&ring, i) == 0);
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_ring_push(&ring, i) < 0);
+
+	for (i = 0; i < EXYNOS_CAMERA_RING_SIZE; i++)
+		EXYNOS_CAMERA_TEST_CHECK(exynos_camera_ring_pop(&ring, &value) == 0 && value == i);
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_ring_pop(&ring, &value) < 0);
+
+	// The counters wrap around
+	ring.head = ring.tail = 0xfffffff8U;
+
+	for (i = 0; i < EXYNOS_CAMERA_RING_SIZE; i++)
+		EXYNOS_CAMERA_TEST_CHECK(exynos_camera_ring_push(&ring, i) == 0);
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_ring_push(&ring, i) < 0);
+
+	for (i = 0; i < EXYNOS_CAMERA_RING_SIZE; i++)
+		EXYNOS_CAMERA_TEST_CHECK(exynos_camera_ring_pop(&ring, &value) == 0 && value == i);
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_ring_pop(&ring, &value) < 0);
+
+	// One producer and one consumer thread, nothing lost or reordered
+	exynos_camera_ring_reset(&ring);
+
+	EXYNOS_CAMERA_TEST_CHECK(pthread_create(&thread, NULL, exynos_camera_test_ring_consumer, &ring) == 0);
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+
+	for (i = 0; i < EXYNOS_CAMERA_TEST_RING_VALUES; i++)
+		while (exynos_camera_ring_push(&ring, i) < 0)
+			sched_yield();
+
+	pthread_join(thread, &result);
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+
+	EXYNOS_CAMERA_TEST_CHECK((intptr_t) result == EXYNOS_CAMERA_TEST_RING_VALUES);
+	printf("ring: push to pop %.1f ns\n", exynos_camera_test_ns(time, EXYNOS_CAMERA_TEST_RING_VALUES));
+}
+
+/*
+ * Memory pool
+ */
+
+static void exynos_camera_test_memory(void)
+{
+	struct exynos_camera *exynos_camera;
+	struct exynos_memory_pool *pool;
+	camera_memory_t *memories[EXYNOS_MEMORY_POOL_SIZE + 1];
+	camera_memory_t *memory;
+	nsecs_t time;
+	int requested, released;
+	int size;
+	int count;
+	int i;
+
+	exynos_camera = calloc(1, sizeof(struct exynos_camera));
+	if (exynos_camera == NULL)
+		return;
+
+	exynos_camera->callbacks.request_memory = exynos_camera_test_request_memory;
+	pool = &exynos_camera->memory_pool;
+
+	exynos_memory_pool_init(exynos_camera);
+
+	requested = exynos_camera_test_memory_requested;
+	released = exynos_camera_test_memory_released;
+
+	// Released memory comes back for the same size and count only
+	memory = exynos_memory_get(exynos_camera, 4096, 2);
+	EXYNOS_CAMERA_TEST_CHECK(memory != NULL && pool->misses == 1);
+	exynos_memory_put(exynos_camera, memory);
+	EXYNOS_CAMERA_TEST_CHECK(pool->bytes_idle == 8192);
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_memory_get(exynos_camera, 4096, 2) == memory);
+	EXYNOS_CAMERA_TEST_CHECK(pool->hits == 1 && pool->bytes_idle == 0);
+
+	memories[0] = exynos_memory_get(exynos_camera, 4096, 2);
+	memories[1] = exynos_memory_get(exynos_camera, 8192, 1);
+	EXYNOS_CAMERA_TEST_CHECK(memories[0] != NULL && memories[0] != memory);
+	EXYNOS_CAMERA_TEST_CHECK(memories[1] != NULL && memories[1] != memory);
+	EXYNOS_CAMERA_TEST_CHECK(pool->misses == 3 && pool->bytes == 3 * 8192);
+
+	exynos_memory_put(exynos_camera, memory);
+	exynos_memory_put(exynos_camera, memories[0]);
+	exynos_memory_put(exynos_camera, memories[1]);
+
+	// Idle memory is bounded, the least recently released goes first
+	size = EXYNOS_MEMORY_POOL_IDLE_MAX / 3;
+
+	for (i = 0; i < 4; i++)
+		memories[i] = exynos_memory_get(exynos_camera, size + i, 1);
+
+	for (i = 0; i < 4; i++)
+		exynos_memory_put(exynos_camera, memories[i]);
+
+	EXYNOS_CAMERA_TEST_CHECK(pool->bytes_idle <= EXYNOS_MEMORY_POOL_IDLE_MAX);
+	EXYNOS_CAMERA_TEST_CHECK(pool->evictions > 0);
+
+	count = pool->hits;
+	memory = exynos_memory_get(exynos_camera, size + 3, 1);
+	EXYNOS_CAMERA_TEST_CHECK(memory == memories[3] && pool->hits == count + 1);
+	exynos_memory_put(exynos_camera, memory);
+
+	memory = exynos_memory_get(exynos_camera, size, 1);
+	EXYNOS_CAMERA_TEST_CHECK(memory != NULL && pool->hits == count + 1);
+	exynos_memory_put(exynos_camera, memory);
+
+	// Past the pool size, memory isn't tracked and goes away when put back
+	for (i = 0; i < EXYNOS_MEMORY_POOL_SIZE + 1; i++)
+		memories[i] = exynos_memory_get(exynos_camera, 1024, i + 1);
+
+	count = exynos_camera_test_memory_released;
+	exynos_memory_put(exynos_camera, memories[EXYNOS_MEMORY_POOL_SIZE]);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_test_memory_released == count + 1);
+
+	for (i = 0; i < EXYNOS_MEMORY_POOL_SIZE; i++)
+		exynos_memory_put(exynos_camera, memories[i]);
+
+	// The high-water mark counts what was in use at the same time
+	EXYNOS_CAMERA_TEST_CHECK(pool->bytes == pool->bytes_idle);
+	EXYNOS_CAMERA_TEST_CHECK(pool->bytes_max >= 4 * size);
+
+	// Taking from the pool against requesting new memory each time
+	count = 1000;
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++)
+		exynos_memory_put(exynos_camera, exynos_memory_get(exynos_camera, 1024, 1));
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("memory: pool get and put %.1f us\n", exynos_camera_test_ns(time, count) / 1000);
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++) {
+		memory = exynos_camera_test_request_memory(-1, 1024, 1, NULL);
+		if (memory != NULL)
+			memory->release(memory);
+	}
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("memory: request and release %.1f us\n", exynos_camera_test_ns(time, count) / 1000);
+
+	// Everything goes back with the pool
+	exynos_memory_pool_deinit(exynos_camera);
+
+	EXYNOS_CAMERA_TEST_CHECK(pool->bytes == 0 && pool->bytes_idle == 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_test_memory_requested - requested ==
+		exynos_camera_test_memory_released - released);
+
+	free(exynos_camera);
+}
+
+/*
+ * Scale
+ */
+
+struct exynos_camera_test_plane {
+	unsigned char *data;
+	int width;
+	int height;
+};
+
+/*
+ * The reference splits frames in separate planes of samples and halves each
+ * of them with a plain box filter, rounded like the scaler passes.
+ */
+static int exynos_camera_test_scale_planes(int format, int width, int height,
+	struct exynos_camera_test_plane *planes)
+{
+	int chroma_width, chroma_height;
+	int i;
+
+	switch (format) {
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+			chroma_width = width / 2;
+			chroma_height = height / 2;
+			break;
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+			chroma_width = width / 2;
+			chroma_height = height;
+			break;
+		default:
+			chroma_width = width;
+			chroma_height = height;
+			break;
+	}
+
+	for (i = 0; i < 3; i++) {
+		planes[i].width = i == 0 ? width : chroma_width;
+		planes[i].height = i == 0 ? height : chroma_height;
+		planes[i].data = malloc(planes[i].width * planes[i].height);
+		if (planes[i].data == NULL)
+			return -1;
+	}
+
+	return 0;
+}
+
+static void exynos_camera_test_scale_split(int format, void *frame, int width, int height,
+	struct exynos_camera_test_plane *planes)
+{
+	unsigned char *data = (unsigned char *) frame;
+	unsigned short *rgb = (unsigned short *) frame;
+	int y_offset, c_offset;
+	int i, c;
+
+	switch (format) {
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+			memcpy(planes[0].data, data, width * height);
+			for (i = 0; i < width * height / 4; i++)
+				for (c = 0; c < 2; c++)
+					planes[1 + c].data[i] = data[width * height + 2 * i + c];
+			break;
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+			y_offset = format == V4L2_PIX_FMT_UYVY ? 1 : 0;
+			c_offset = 1 - y_offset;
+			for (i = 0; i < width * height; i++)
+				planes[0].data[i] = data[2 * i + y_offset];
+			for (i = 0; i < width * height / 2; i++)
+				for (c = 0; c < 2; c++)
+					planes[1 + c].data[i] = data[4 * i + c_offset + 2 * c];
+			break;
+		case V4L2_PIX_FMT_RGB565:
+			for (i = 0; i < width * height; i++) {
+				planes[0].data[i] = rgb[i] >> 11;
+				planes[1].data[i] = (rgb[i] >> 5) & 0x3f;
+				planes[2].data[i] = rgb[i] & 0x1f;
+			}
+			break;
+	}
+}
+
+static void exynos_camera_test_scale_join(int format, struct exynos_camera_test_plane *planes,
+	int width, int height, void *frame)
+{
+	unsigned char *data = (unsigned char *) frame;
+	unsigned short *rgb = (unsigned short *) frame;
+	int y_offset, c_offset;
+	int i, c;
+
+	switch (format) {
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+			memcpy(data, planes[0].data, width * height);
+			for (i = 0; i < width * height / 4; i++)
+				for (c = 0; c < 2; c++)
+					data[width * height + 2 * i + c] = planes[1 + c].data[i];
+			break;
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+			y_offset = format == V4L2_PIX_FMT_UYVY ? 1 : 0;
+			c_offset = 1 - y_offset;
+			for (i = 0; i < width * height; i++)
+				data[2 * i + y_offset] = planes[0].data[i];
+			for (i = 0; i < width * height / 2; i++)
+				for (c = 0; c < 2; c++)
+					data[4 * i + c_offset + 2 * c] = planes[1 + c].data[i];
+			break;
+		case V4L2_PIX_FMT_RGB565:
+			for (i = 0; i < width * height; i++)
+				rgb[i] = (planes[0].data[i] << 11) | (planes[1].data[i] << 5) | planes[2].data[i];
+			break;
+	}
+}
+
+static void exynos_camera_test_scale_half(struct exynos_camera_test_plane *plane)
+{
+	unsigned char *a, *b;
+	int width, height;
+	int x, y;
+
+	width = plane->width / 2;
+	height = plane->height / 2;
+
+	// Each output sample only reads samples at or after its own offset
+	for (y = 0; y < height; y++) {
+		a = plane->data + 2 * y * plane->width;
+		b = a + plane->width;
+
+		for (x = 0; x < width; x++)
+			plane->data[y * width + x] = (a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1] + 2) >> 2;
+	}
+
+	plane->width = width;
+	plane->height = height;
+}
+
+static void exynos_camera_test_scale_reference(int format, void *src, int width, int height,
+	void *dst, int passes)
+{
+	struct exynos_camera_test_plane planes[3];
+	int i, j;
+
+	memset(planes, 0, sizeof(planes));
+
+	if (exynos_camera_test_scale_planes(format, width, height, planes) < 0)
+		goto complete;
+
+	exynos_camera_test_scale_split(format, src, width, height, planes);
+
+	for (i = 0; i < passes; i++)
+		for (j = 0; j < 3; j++)
+			exynos_camera_test_scale_half(&planes[j]);
+
+	exynos_camera_test_scale_join(format, planes, width >> passes, height >> passes, dst);
+
+complete:
+	for (i = 0; i < 3; i++)
+		if (planes[i].data != NULL)
+			free(planes[i].data);
+}
+
+static void exynos_camera_test_scale(void)
+{
+	int formats[] = { V4L2_PIX_FMT_NV12, V4L2_PIX_FMT_NV21, V4L2_PIX_FMT_YUYV,
+		V4L2_PIX_FMT_UYVY, V4L2_PIX_FMT_RGB565 };
+	// Widths that aren't a multiple of the NEON steps go through the C tail
+	int sizes[][3] = { { 640, 480, 1 }, { 640, 480, 3 }, { 648, 488, 1 }, { 1304, 984, 2 } };
+	unsigned char *src, *dst, *reference;
+	unsigned int seed = 1;
+	nsecs_t time;
+	int width, height, passes;
+	int format;
+	int count;
+	int i, j;
+
+	// Large enough for the full M5MO picture size
+	src = malloc(3264 * 2448 * 2);
+	dst = malloc(3264 * 2448 * 2);
+	reference = malloc(3264 * 2448 * 2);
+	if (src == NULL || dst == NULL || reference == NULL)
+		goto complete;
+
+	for (i = 0; i < 3264 * 2448 * 2; i++) {
+		seed = seed * 1103515245 + 12345;
+		src[i] = seed >> 16;
+	}
+
+	// Exact halvings match the reference bit for bit
+	for (i = 0; i < (int) (sizeof(formats) / sizeof(int)); i++) {
+		for (j = 0; j < (int) (sizeof(sizes) / sizeof(sizes[0])); j++) {
+			format = formats[i];
+			width = sizes[j][0];
+			height = sizes[j][1];
+			passes = sizes[j][2];
+
+			memset(dst, 0, 3264 * 2448 * 2);
+			memset(reference, 0xff, 3264 * 2448 * 2);
+
+			EXYNOS_CAMERA_TEST_CHECK(exynos_scale(format, src, width, height, dst,
+				width >> passes, height >> passes) == 0);
+			exynos_camera_test_scale_reference(format, src, width, height, reference, passes);
+
+			EXYNOS_CAMERA_TEST_CHECK(memcmp(dst, reference,
+				exynos_convert_frame_size(format, width >> passes, height >> passes)) == 0);
+		}
+	}
+
+	// Other sizes end with a nearest neighbour pass
+	EXYNOS_CAMERA_TEST_CHECK(exynos_scale(V4L2_PIX_FMT_NV21, src, 640, 480, dst, 320, 180) == 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_scale(V4L2_PIX_FMT_YUYV, src, 640, 480, dst, 176, 144) == 0);
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_scale(V4L2_PIX_FMT_NV21, src, 640, 480, dst, 161, 120) < 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_scale(V4L2_PIX_FMT_NV21, src, 640, 480, dst, 1280, 960) < 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_scale(V4L2_PIX_FMT_JPEG, src, 640, 480, dst, 320, 240) < 0);
+
+	// EXIF thumbnail from a full picture, against the reference passes
+	count = 10;
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++)
+		exynos_scale(V4L2_PIX_FMT_NV21, src, 3264, 2448, dst, 408, 306);
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("scale: 3264x2448 to 408x306 in %.2f ms\n", exynos_camera_test_ns(time, count) / 1000000);
+
+	time = systemTime(SYSTEM_TIME_MONOTONIC);
+	for (i = 0; i < count; i++)
+		exynos_camera_test_scale_reference(V4L2_PIX_FMT_NV21, src, 3264, 2448, reference, 3);
+	time = systemTime(SYSTEM_TIME_MONOTONIC) - time;
+	printf("scale: reference in %.2f ms\n", exynos_camera_test_ns(time, count) / 1000000);
+
+	EXYNOS_CAMERA_TEST_CHECK(memcmp(dst, reference,
+		exynos_convert_frame_size(V4L2_PIX_FMT_NV21, 408, 306)) == 0);
+
+complete:
+	if (src != NULL)
+		free(src);
+	if (dst != NULL)
+		free(dst);
+	if (reference != NULL)
+		free(reference);
+}
+
+/*
+ * Picture
+ */
+
+static void exynos_camera_test_picture(void)
+{
+	struct exynos_camera *exynos_camera;
+	struct exynos_camera_picture_frame frame;
+	camera_device_t *device;
+	camera_memory_t *thumbnail;
+	unsigned char picture[4096];
+	unsigned char *data;
+	int exif_size;
+	int i;
+
+	device = exynos_camera_test_open();
+	EXYNOS_CAMERA_TEST_CHECK(device != NULL);
+	if (device == NULL)
+		return;
+
+	exynos_camera = (struct exynos_camera *) device->priv;
+
+	for (i = 0; i < (int) sizeof(picture); i++)
+		picture[i] = i & 0xff;
+	picture[0] = 0xff;
+	picture[1] = 0xd8;
+
+	// The EXIF size is known before it is written, both shots share the layout
+	for (i = 0; i < 2; i++) {
+		thumbnail = exynos_camera_test_request_memory(-1, 512, 1, NULL);
+		EXYNOS_CAMERA_TEST_CHECK(thumbnail != NULL);
+		if (thumbnail == NULL)
+			break;
+
+		memset(thumbnail->data, 0x5a, 512);
+
+		memset(&frame, 0, sizeof(frame));
+		frame.jpeg_thumbnail_data_memory = thumbnail;
+		frame.jpeg_thumbnail_size = 512;
+		frame.width = 640;
+		frame.height = 480;
+
+		EXYNOS_CAMERA_TEST_CHECK(exynos_camera_picture_reserve(exynos_camera, &frame,
+			picture, sizeof(picture)) == 0);
+		if (frame.data_memory == NULL) {
+			thumbnail->release(thumbnail);
+			break;
+		}
+
+		exif_size = frame.exif_size;
+		data = (unsigned char *) frame.data_memory->data;
+
+		EXYNOS_CAMERA_TEST_CHECK(frame.data_memory->size == (size_t) (exif_size + sizeof(picture)));
+		EXYNOS_CAMERA_TEST_CHECK(memcmp(data + 2 + exif_size, picture + 2, sizeof(picture) - 2) == 0);
+
+		EXYNOS_CAMERA_TEST_CHECK(exynos_camera_picture_assemble(exynos_camera, &frame) == 0);
+
+		EXYNOS_CAMERA_TEST_CHECK(data[0] == 0xff && data[1] == 0xd8);
+		EXYNOS_CAMERA_TEST_CHECK(data[2] == 0xff && data[3] == 0xe1);
+		EXYNOS_CAMERA_TEST_CHECK(((data[4] << 8) | data[5]) == exif_size - 2);
+		EXYNOS_CAMERA_TEST_CHECK(memcmp(data + 6, "Exif", 4) == 0);
+		EXYNOS_CAMERA_TEST_CHECK(data[2 + exif_size - 1] == 0x5a);
+		EXYNOS_CAMERA_TEST_CHECK(memcmp(data + 2 + exif_size, picture + 2, sizeof(picture) - 2) == 0);
+
+		frame.data_memory->release(frame.data_memory);
+		thumbnail->release(thumbnail);
+	}
+
+	exynos_camera_test_close(device);
+}
+
+/*
+ * Settings
+ */
+
+static int exynos_camera_test_iso(struct exynos_camera *exynos_camera)
+{
+	int value = -1;
+
+	exynos_v4l2_g_ctrl(exynos_camera, 0, V4L2_CID_CAMERA_ISO, &value);
+
+	return value;
+}
+
+static void exynos_camera_test_settings(void)
+{
+	struct exynos_camera *exynos_camera;
+	camera_device_t *device;
+
+	device = exynos_camera_test_open();
+	EXYNOS_CAMERA_TEST_CHECK(device != NULL);
+	if (device == NULL)
+		return;
+
+	exynos_camera = (struct exynos_camera *) device->priv;
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_test_iso(exynos_camera) == ISO_AUTO);
+
+	// Without preview, changes are applied right away
+	EXYNOS_CAMERA_TEST_CHECK(device->ops->set_parameters(device, "iso=ISO100") == 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_test_iso(exynos_camera) == ISO_100);
+	EXYNOS_CAMERA_TEST_CHECK(!exynos_camera->params_settings.pending);
+
+	// With the preview thread running, they wait for the next frame boundary
+	exynos_camera->preview_thread_running = 1;
+
+	EXYNOS_CAMERA_TEST_CHECK(device->ops->set_parameters(device, "iso=ISO200") == 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_test_iso(exynos_camera) == ISO_100);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera->params_settings.pending);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera->params_settings.dirty[EXYNOS_PARAM_KEY_ISO]);
+
+	// Changes until then are merged, the last one wins
+	EXYNOS_CAMERA_TEST_CHECK(device->ops->set_parameters(device, "iso=ISO800;effect=mono") == 0);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_test_iso(exynos_camera) == ISO_100);
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera->params_settings.dirty[EXYNOS_PARAM_KEY_EFFECT]);
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_params_settings_apply(exynos_camera) == 0);
+	exynos_camera_params_deferred_ctrls_flush(exynos_camera);
+
+	EXYNOS_CAMERA_TEST_CHECK(exynos_camera_test_iso(exynos_camera) == ISO_800);
+	EXYNOS_CAMERA_TEST_CHECK(!exynos_camera->params_settings.pending);
+	EXYNOS_CAMERA_TEST_CHECK(!exynos_camera->params_settings.dirty[EXYNOS_PARAM_KEY_ISO]);
+
+	// Unchanged params don't queue anything
+	EXYNOS_CAMERA_TEST_CHECK(device->ops->set_parameters(device, "iso=ISO800") == 0);
+	EXYNOS_CAMERA_TEST_CHECK(!exynos_camera->params_settings.pending);
+
+	exynos_camera->preview_thread_running = 0;
+
+	exynos_camera_test_close(device);
+}
+
+int main(int argc, char *argv[])
+{
+	exynos_camera_test_params();
+	exynos_camera_test_params_bench();
+	exynos_camera_test_ring();
+	exynos_camera_test_memory();
+	exynos_camera_test_scale();
+	exynos_camera_test_picture();
+	exynos_camera_test_settings();
+
+	printf("%d checks, %d failed\n", exynos_camera_test_checks, exynos_camera_test_failures);
+
+	return exynos_camera_test_failures > 0 ? 1 : 0;
+}
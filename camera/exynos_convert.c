@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2013 Paul Kocialkowski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#define LOG_TAG "exynos_convert"
+#include <utils/Log.h>
+
+#include "exynos_camera.h"
+
+/*
+ * Conversions from what FIMC1 outputs to the layouts preview callbacks are
+ * expected in: NV21 for yuv420sp and YV12 (16-aligned strides) for yuv420p.
+ * The JPEG encoder takes NV12 for video snapshots.
+ */
+
+#define EXYNOS_CONVERT_ALIGN(value, align) \
+	(((value) + (align) - 1) & ~((align) - 1))
+
+// NV12T is made of 64x32 tiles, grouped by 2x2 in a Z pattern
+#define EXYNOS_CONVERT_TILE_WIDTH	64
+#define EXYNOS_CONVERT_TILE_HEIGHT	32
+
+int exynos_convert_frame_size(int format, int width, int height)
+{
+	int y_stride, c_stride;
+
+	switch (format) {
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+		case V4L2_PIX_FMT_YUV420:
+			return width * height * 3 / 2;
+		case V4L2_PIX_FMT_YVU420:
+			y_stride = EXYNOS_CONVERT_ALIGN(width, 16);
+			c_stride = EXYNOS_CONVERT_ALIGN(y_stride / 2, 16);
+			return y_stride * height + c_stride * height;
+		case V4L2_PIX_FMT_NV12T:
+			return EXYNOS_CONVERT_ALIGN(EXYNOS_CONVERT_ALIGN(width, 128) *
+				EXYNOS_CONVERT_ALIGN(height, 32), 8192) +
+				EXYNOS_CONVERT_ALIGN(EXYNOS_CONVERT_ALIGN(width, 128) *
+				EXYNOS_CONVERT_ALIGN(height / 2, 32), 8192);
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+		case V4L2_PIX_FMT_RGB565:
+			return width * height * 2;
+		case V4L2_PIX_FMT_RGB32:
+			return width * height * 4;
+		default:
+			return -1;
+	}
+}
+
+// Swaps the bytes of each chroma pair, NV12 to NV21 and back
+static void exynos_convert_swap_uv(unsigned char *src, unsigned char *dst, int size)
+{
+	unsigned char value;
+	int i = 0;
+
+#if defined(__ARM_NEON__)
+	for (; i + 16 <= size; i += 16)
+		vst1q_u8(dst + i, vrev16q_u8(vld1q_u8(src + i)));
+#endif
+
+	for (; i + 1 < size; i += 2) {
+		value = src[i];
+		dst[i] = src[i + 1];
+		dst[i + 1] = value;
+	}
+}
+
+// Splits chroma pairs into two planes
+static void exynos_convert_split_uv(unsigned char *src, int width, int height,
+	unsigned char *first, unsigned char *second, int stride, int swap)
+{
+	unsigned char *s, *a, *b;
+	int x, y;
+
+	for (y = 0; y < height; y++) {
+		s = src + y * width * 2;
+		a = (swap ? second : first) + y * stride;
+		b = (swap ? first : second) + y * stride;
+		x = 0;
+
+#if defined(__ARM_NEON__)
+		for (; x + 16 <= width; x += 16) {
+			uint8x16x2_t uv = vld2q_u8(s + 2 * x);
+			vst1q_u8(a + x, uv.val[0]);
+			vst1q_u8(b + x, uv.val[1]);
+		}
+#endif
+
+		for (; x < width; x++) {
+			a[x] = s[2 * x];
+			b[x] = s[2 * x + 1];
+		}
+	}
+}
+
+// Interleaves two planes into chroma pairs
+static void exynos_convert_merge_uv(unsigned char *first, unsigned char *second,
+	int size, unsigned char *dst)
+{
+	int i = 0;
+
+#if defined(__ARM_NEON__)
+	for (; i + 16 <= size; i += 16) {
+		uint8x16x2_t uv;
+		uv.val[0] = vld1q_u8(first + i);
+		uv.val[1] = vld1q_u8(second + i);
+		vst2q_u8(dst + 2 * i, uv);
+	}
+#endif
+
+	for (; i < size; i++) {
+		dst[2 * i] = first[i];
+		dst[2 * i + 1] = second[i];
+	}
+}
+
+static void exynos_convert_yuyv_nv21(unsigned char *src, int width, int height,
+	unsigned char *dst, int y_offset)
+{
+	unsigned char *s, *d, *c;
+	int c_offset = 1 - y_offset;
+	int x, y;
+
+	c = dst + width * height;
+
+	for (y = 0; y < height; y++) {
+		s = src + y * width * 2;
+		d = dst + y * width;
+		x = 0;
+
+#if defined(__ARM_NEON__)
+		for (; x + 16 <= width; x += 16) {
+			uint8x8x4_t p = vld4_u8(s + 2 * x);
+			uint8x8x2_t luma;
+			uint8x8x2_t vu;
+
+			luma.val[0] = p.val[y_offset];
+			luma.val[1] = p.val[y_offset + 2];
+			vst2_u8(d + x, luma);
+
+			// Chroma is only taken from the even lines
+			if ((y & 1) == 0) {
+				vu.val[0] = p.val[c_offset + 2];
+				vu.val[1] = p.val[c_offset];
+				vst2_u8(c + (y / 2) * width + x, vu);
+			}
+		}
+#endif
+
+		for (; x + 1 < width; x += 2) {
+			d[x] = s[2 * x + y_offset];
+			d[x + 1] = s[2 * x + y_offset + 2];
+
+			if ((y & 1) == 0) {
+				c[(y / 2) * width + x] = s[2 * x + c_offset + 2];
+				c[(y / 2) * width + x + 1] = s[2 * x + c_offset];
+			}
+		}
+	}
+}
+
+// Offset of the 64 bytes line of a tile holding the pixel, from the FIMC docs
+static int exynos_convert_tile_offset(int width, int height, int x, int y)
+{
+	int tiles_pairs;
+	int linear, block, bank;
+	int x_addr;
+
+	tiles_pairs = ((width - 1) >> 7) + 1;
+	x_addr = x >> 2;
+
+	linear = ((y & 0x1f) << 4) | (x_addr & 0xf);
+
+	// The last tiles row is not paired when the count is odd
+	if (y + 32 >= height && y < height && (((height - 1) >> 5) & 1) == 0 &&
+		((y >> 5) & 1) == 0)
+		block = ((y >> 6) & 0xff) * tiles_pairs + ((x_addr >> 6) & 0x3f);
+	else
+		block = ((y >> 6) & 0xff) * tiles_pairs + ((x_addr >> 5) & 0x7f);
+
+	if (((x_addr >> 5) & 1) == ((y >> 5) & 1))
+		bank = (x_addr >> 4) & 1;
+	else
+		bank = 0x2 | ((x_addr >> 4) & 1);
+
+	return (block << 13) | (bank << 11) | (linear << 2);
+}
+
+static void exynos_convert_detile(unsigned char *src, int width, int height,
+	unsigned char *dst)
+{
+	int x, y;
+	int size;
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x += EXYNOS_CONVERT_TILE_WIDTH) {
+			size = width - x < EXYNOS_CONVERT_TILE_WIDTH ? width - x : EXYNOS_CONVERT_TILE_WIDTH;
+			memcpy(dst + y * width + x, src + exynos_convert_tile_offset(width, height, x, y), size);
+		}
+	}
+}
+
+static void exynos_convert_nv12t(unsigned char *src, int width, int height,
+	unsigned char *dst, int swap)
+{
+	unsigned char *c;
+	int y_size;
+
+	y_size = EXYNOS_CONVERT_ALIGN(EXYNOS_CONVERT_ALIGN(width, 128) *
+		EXYNOS_CONVERT_ALIGN(height, 32), 8192);
+
+	exynos_convert_detile(src, width, height, dst);
+
+	c = dst + width * height;
+	exynos_convert_detile(src + y_size, width, height / 2, c);
+
+	if (swap)
+		exynos_convert_swap_uv(c, c, width * height / 2);
+}
+
+static void exynos_convert_yv12(int format, unsigned char *src, int width, int height,
+	unsigned char *dst)
+{
+	unsigned char *v, *u;
+	int y_stride, c_stride;
+	int y;
+
+	y_stride = EXYNOS_CONVERT_ALIGN(width, 16);
+	c_stride = EXYNOS_CONVERT_ALIGN(y_stride / 2, 16);
+
+	v = dst + y_stride * height;
+	u = v + c_stride * height / 2;
+
+	for (y = 0; y < height; y++)
+		memcpy(dst + y * y_stride, src + y * width, width);
+
+	src += width * height;
+
+	switch (format) {
+		case V4L2_PIX_FMT_YUV420:
+			for (y = 0; y < height / 2; y++) {
+				memcpy(u + y * c_stride, src + y * width / 2, width / 2);
+				memcpy(v + y * c_stride, src + width * height / 4 + y * width / 2, width / 2);
+			}
+			break;
+		case V4L2_PIX_FMT_NV12:
+			exynos_convert_split_uv(src, width / 2, height / 2, u, v, c_stride, 0);
+			break;
+		case V4L2_PIX_FMT_NV21:
+			exynos_convert_split_uv(src, width / 2, height / 2, u, v, c_stride, 1);
+			break;
+	}
+}
+
+int exynos_convert(int format, void *src, int width, int height,
+	int dst_format, void *dst)
+{
+	unsigned char *s, *d;
+	int size;
+
+	if (src == NULL || dst == NULL || width <= 0 || height <= 0)
+		return -EINVAL;
+
+	s = (unsigned char *) src;
+	d = (unsigned char *) dst;
+
+	if (format == dst_format) {
+		size = exynos_convert_frame_size(format, width, height);
+		if (size < 0)
+			return -1;
+
+		memcpy(d, s, size);
+		return 0;
+	}
+
+	if (dst_format == V4L2_PIX_FMT_NV21) {
+		switch (format) {
+			case V4L2_PIX_FMT_NV12:
+				memcpy(d, s, width * height);
+				exynos_convert_swap_uv(s + width * height, d + width * height, width * height / 2);
+				return 0;
+			case V4L2_PIX_FMT_NV12T:
+				exynos_convert_nv12t(s, width, height, d, 1);
+				return 0;
+			case V4L2_PIX_FMT_YUYV:
+				exynos_convert_yuyv_nv21(s, width, height, d, 0);
+				return 0;
+			case V4L2_PIX_FMT_UYVY:
+				exynos_convert_yuyv_nv21(s, width, height, d, 1);
+				return 0;
+		}
+	} else if (dst_format == V4L2_PIX_FMT_NV12) {
+		switch (format) {
+			case V4L2_PIX_FMT_NV21:
+				memcpy(d, s, width * height);
+				exynos_convert_swap_uv(s + width * height, d + width * height, width * height / 2);
+				return 0;
+			case V4L2_PIX_FMT_NV12T:
+				exynos_convert_nv12t(s, width, height, d, 0);
+				return 0;
+			case V4L2_PIX_FMT_YUV420:
+				memcpy(d, s, width * height);
+				exynos_convert_merge_uv(s + width * height, s + width * height * 5 / 4,
+					width * height / 4, d + width * height);
+				return 0;
+		}
+	} else if (dst_format == V4L2_PIX_FMT_YVU420) {
+		switch (format) {
+			case V4L2_PIX_FMT_YUV420:
+			case V4L2_PIX_FMT_NV12:
+			case V4L2_PIX_FMT_NV21:
+				exynos_convert_yv12(format, s, width, height, d);
+				return 0;
+		}
+	}
+
+	ALOGE("%s: Unsupported conversion: 0x%x to 0x%x", __func__, format, dst_format);
+
+	return -1;
+}
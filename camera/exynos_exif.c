@@ -22,6 +22,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <errno.h>
 #include <malloc.h>
@@ -53,6 +54,13 @@ int exynos_exif_attributes_create_static(struct exynos_camera *exynos_camera,
 	if (exynos_camera == NULL || exif_attributes == NULL)
 		return -EINVAL;
 
+	// Static attributes only depend on the device, build them once
+	if (exynos_camera->exif_template.static_attributes_created) {
+		memcpy(exif_attributes, &exynos_camera->exif_template.static_attributes,
+			sizeof(exif_attribute_t));
+		return 0;
+	}
+
 	// Device
 	property_get("ro.product.brand", property, EXIF_DEF_MAKER);
 	strncpy((char *) exif_attributes->maker, property,
@@ -100,6 +108,10 @@ int exynos_exif_attributes_create_static(struct exynos_camera *exynos_camera,
 	exif_attributes->y_resolution.den = EXIF_DEF_RESOLUTION_DEN;
 	exif_attributes->resolution_unit = EXIF_DEF_RESOLUTION_UNIT;
 
+	memcpy(&exynos_camera->exif_template.static_attributes, exif_attributes,
+		sizeof(exif_attribute_t));
+	exynos_camera->exif_template.static_attributes_created = 1;
+
 	return 0;
 }
 
@@ -118,13 +130,13 @@ int exynos_exif_attributes_create_gps(struct exynos_camera *exynos_camera,
 	if (exynos_camera == NULL || exif_attributes == NULL)
 		return -EINVAL;
 
-	gps_latitude_float = exynos_param_float_get(exynos_camera, "gps-latitude");
-	gps_longitude_float = exynos_param_float_get(exynos_camera, "gps-longitude");
-	gps_altitude_float = exynos_param_float_get(exynos_camera, "gps-altitude");
+	gps_latitude_float = exynos_param_float_get_id(exynos_camera, EXYNOS_PARAM_KEY_GPS_LATITUDE);
+	gps_longitude_float = exynos_param_float_get_id(exynos_camera, EXYNOS_PARAM_KEY_GPS_LONGITUDE);
+	gps_altitude_float = exynos_param_float_get_id(exynos_camera, EXYNOS_PARAM_KEY_GPS_ALTITUDE);
 	if (gps_altitude_float == -1)
-		gps_altitude_float = (float) exynos_param_int_get(exynos_camera, "gps-altitude");
-	gps_timestamp_int = exynos_param_int_get(exynos_camera, "gps-timestamp");
-	gps_processing_method_string = exynos_param_string_get(exynos_camera, "gps-processing-method");
+		gps_altitude_float = (float) exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_GPS_ALTITUDE);
+	gps_timestamp_int = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_GPS_TIMESTAMP);
+	gps_processing_method_string = exynos_param_string_get_id(exynos_camera, EXYNOS_PARAM_KEY_GPS_PROCESSING_METHOD);
 
 	if (gps_latitude_float == -1 || gps_longitude_float == -1 ||
 		gps_altitude_float == -1 || gps_timestamp_int <= 0 ||
@@ -224,7 +236,7 @@ int exynos_exif_attributes_create_params(struct exynos_camera *exynos_camera,
 	exif_attributes->enableThumb = true;
 
 	// Orientation
-	rotation = exynos_param_int_get(exynos_camera, "rotation");
+	rotation = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_ROTATION);
 	switch (rotation) {
 		case 90:
 			exif_attributes->orientation = EXIF_ORIENTATION_90;
@@ -302,7 +314,7 @@ int exynos_exif_attributes_create_params(struct exynos_camera *exynos_camera,
 	goto bv_ioctl;
 
 bv_static:
-	exposure = exynos_param_int_get(exynos_camera, "exposure-compensation");
+	exposure = exynos_param_int_get_id(exynos_camera, EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION);
 	if (exposure < 0)
 		exposure = EV_DEFAULT;
 
@@ -407,10 +419,10 @@ int exynos_exif_write_data(void *exif_data, unsigned short tag,
 	return size;
 }
 
-int exynos_exif_create(struct exynos_camera *exynos_camera,
+static int exynos_exif_build(struct exynos_camera *exynos_camera,
 	exif_attribute_t *exif_attributes,
 	camera_memory_t *jpeg_thumbnail_data_memory, int jpeg_thumbnail_size,
-	camera_memory_t **exif_data_memory_p, int *exif_size_p)
+	void **exif_data_p, int *exif_size_p)
 {
 	// Markers
 	unsigned char exif_app1_marker[] = { 0xff, 0xe1 };
@@ -421,8 +433,7 @@ int exynos_exif_create(struct exynos_camera *exynos_camera,
 	unsigned char user_comment_code[] = { 0x41, 0x53, 0x43, 0x49, 0x49, 0x0, 0x0, 0x0 };
 	unsigned char exif_ascii_prefix[] = { 0x41, 0x53, 0x43, 0x49, 0x49, 0x0, 0x0, 0x0 };
 
-	camera_memory_t *exif_data_memory = NULL;
-	void *exif_data;
+	void *exif_data = NULL;
 	int exif_data_size;
 	int exif_size;
 
@@ -440,26 +451,18 @@ int exynos_exif_create(struct exynos_camera *exynos_camera,
 
 	if (exynos_camera == NULL || exif_attributes == NULL ||
 		jpeg_thumbnail_data_memory == NULL || jpeg_thumbnail_size <= 0 ||
-		exif_data_memory_p == NULL || exif_size_p == NULL)
+		exif_data_p == NULL || exif_size_p == NULL)
 		return -EINVAL;
 
 	exif_data_size = EXIF_FILE_SIZE + jpeg_thumbnail_size;
 
-	if (exynos_camera->callbacks.request_memory != NULL) {
-		exif_data_memory = exynos_camera->callbacks.request_memory(-1,
-			exif_data_size, 1, 0);
-		if (exif_data_memory == NULL) {
-			ALOGE("%s: exif memory request failed!", __func__);
-			goto error;
-		}
-	} else {
-		ALOGE("%s: No memory request function!", __func__);
+	// Only laid out once per template, pictures get the EXIF written in place
+	exif_data = calloc(1, exif_data_size);
+	if (exif_data == NULL) {
+		ALOGE("%s: exif memory allocation failed!", __func__);
 		goto error;
 	}
 
-	exif_data = exif_data_memory->data;
-	memset(exif_data, 0, exif_data_size);
-
 	pointer = (unsigned char *) exif_data;
 	exif_ifd_data_start = (void *) pointer;
 
@@ -788,17 +791,420 @@ int exynos_exif_create(struct exynos_camera *exynos_camera,
 
 	memcpy(pointer, exif_app1_size, sizeof(exif_app1_size));
 
-	*exif_data_memory_p = exif_data_memory;
+	*exif_data_p = exif_data;
 	*exif_size_p = exif_size;
 
 	return 0;
 
 error:
-	if (exif_data_memory != NULL && exif_data_memory->release != NULL)
-		exif_data_memory->release(exif_data_memory);
+	if (exif_data != NULL)
+		free(exif_data);
 
-	*exif_data_memory_p = NULL;
+	*exif_data_p = NULL;
 	*exif_size_p = 0;
 
 	return -1;
 }
+
+/*
+ * Template
+ *
+ * The first EXIF built for a given layout is kept along with the offsets of
+ * every value that changes from shot to shot. Following shots copy it and
+ * only patch these values, instead of laying down all the IFDs again.
+ */
+
+#define EXYNOS_EXIF_IFD_0	0
+#define EXYNOS_EXIF_IFD_EXIF	1
+#define EXYNOS_EXIF_IFD_GPS	2
+#define EXYNOS_EXIF_IFD_1	3
+
+#define EXYNOS_EXIF_TAG(ifd, tag, field) \
+	{ ifd, tag, offsetof(exif_attribute_t, field), \
+	sizeof(((exif_attribute_t *) 0)->field) }
+
+struct exynos_exif_tag {
+	int ifd;
+	unsigned short tag;
+	int offset;
+	int length;
+};
+
+static const struct exynos_exif_tag exynos_exif_tags[] = {
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_0, EXIF_TAG_IMAGE_WIDTH, width),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_0, EXIF_TAG_IMAGE_HEIGHT, height),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_0, EXIF_TAG_ORIENTATION, orientation),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_0, EXIF_TAG_DATE_TIME, date_time),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_EXPOSURE_TIME, exposure_time),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_ISO_SPEED_RATING, iso_speed_rating),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORG, date_time),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_DIGITIZE, date_time),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_SHUTTER_SPEED, shutter_speed),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_BRIGHTNESS, brightness),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_EXPOSURE_BIAS, exposure_bias),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_METERING_MODE, metering_mode),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_FLASH, flash),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_FOCAL_LENGTH, focal_length),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_PIXEL_X_DIMENSION, width),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_PIXEL_Y_DIMENSION, height),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_WHITE_BALANCE, white_balance),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_EXIF, EXIF_TAG_SCENCE_CAPTURE_TYPE, scene_capture_type),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_GPS, EXIF_TAG_GPS_LATITUDE_REF, gps_latitude_ref),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_GPS, EXIF_TAG_GPS_LATITUDE, gps_latitude),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_GPS, EXIF_TAG_GPS_LONGITUDE_REF, gps_longitude_ref),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_GPS, EXIF_TAG_GPS_LONGITUDE, gps_longitude),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_GPS, EXIF_TAG_GPS_ALTITUDE_REF, gps_altitude_ref),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_GPS, EXIF_TAG_GPS_ALTITUDE, gps_altitude),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_GPS, EXIF_TAG_GPS_TIMESTAMP, gps_timestamp),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_GPS, EXIF_TAG_GPS_DATESTAMP, gps_datestamp),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_1, EXIF_TAG_IMAGE_WIDTH, widthThumb),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_1, EXIF_TAG_IMAGE_HEIGHT, heightThumb),
+	EXYNOS_EXIF_TAG(EXYNOS_EXIF_IFD_1, EXIF_TAG_ORIENTATION, orientation),
+};
+
+static int exynos_exif_gps_processing_method_length(exif_attribute_t *exif_attributes)
+{
+	int length;
+
+	if (exif_attributes == NULL || !exif_attributes->enableGps)
+		return 0;
+
+	length = strlen((char *) exif_attributes->gps_processing_method);
+
+	return length > 100 ? 100 : length;
+}
+
+static int exynos_exif_type_size(unsigned short type)
+{
+	switch (type) {
+		case EXIF_TYPE_SHORT:
+			return 2;
+		case EXIF_TYPE_LONG:
+		case EXIF_TYPE_SLONG:
+			return 4;
+		case EXIF_TYPE_RATIONAL:
+		case EXIF_TYPE_SRATIONAL:
+			return 8;
+		case EXIF_TYPE_BYTE:
+		case EXIF_TYPE_ASCII:
+		case EXIF_TYPE_UNDEFINED:
+		default:
+			return 1;
+	}
+}
+
+// Records the value offsets of one IFD and returns the next IFD offset
+static int exynos_exif_template_ifd(struct exynos_exif_template *template,
+	unsigned char *tiff, int tiff_size, int ifd_offset, int ifd,
+	unsigned int *exif_ifd, unsigned int *gps_ifd, unsigned int *thumb_offset)
+{
+	unsigned char *entry;
+	unsigned short entries_count;
+	unsigned short tag;
+	unsigned short type;
+	unsigned int count;
+	unsigned int next;
+	unsigned int value;
+	int position;
+	int i, j;
+
+	if (ifd_offset <= 0 || ifd_offset + NUM_SIZE > tiff_size)
+		return -1;
+
+	memcpy(&entries_count, tiff + ifd_offset, NUM_SIZE);
+	if (ifd_offset + NUM_SIZE + entries_count * IFD_SIZE + OFFSET_SIZE > tiff_size)
+		return -1;
+
+	for (i = 0; i < entries_count; i++) {
+		entry = tiff + ifd_offset + NUM_SIZE + i * IFD_SIZE;
+
+		memcpy(&tag, entry, sizeof(tag));
+		memcpy(&type, entry + 2, sizeof(type));
+		memcpy(&count, entry + 4, sizeof(count));
+		memcpy(&value, entry + 8, sizeof(value));
+
+		if (count * exynos_exif_type_size(type) <= 4)
+			position = entry + 8 - tiff;
+		else
+			position = value;
+
+		if (position < 0 || position + count * exynos_exif_type_size(type) > (unsigned int) tiff_size)
+			return -1;
+
+		// Offsets are kept relative to the APP1 marker
+		position += 10;
+
+		if (ifd == EXYNOS_EXIF_IFD_0 && tag == EXIF_TAG_EXIF_IFD_POINTER)
+			*exif_ifd = value;
+		else if (ifd == EXYNOS_EXIF_IFD_0 && tag == EXIF_TAG_GPS_IFD_POINTER)
+			*gps_ifd = value;
+		else if (ifd == EXYNOS_EXIF_IFD_1 && tag == EXIF_TAG_JPEG_INTERCHANGE_FORMAT)
+			*thumb_offset = value;
+		else if (ifd == EXYNOS_EXIF_IFD_1 && tag == EXIF_TAG_JPEG_INTERCHANGE_FORMAT_LEN)
+			template->thumb_size_position = position;
+		else if (ifd == EXYNOS_EXIF_IFD_GPS && tag == EXIF_TAG_GPS_PROCESSING_METHOD)
+			template->gps_processing_method_position = position;
+
+		for (j = 0; j < (int) (sizeof(exynos_exif_tags) / sizeof(exynos_exif_tags[0])); j++) {
+			if (exynos_exif_tags[j].ifd == ifd && exynos_exif_tags[j].tag == tag) {
+				template->positions[j] = position;
+				break;
+			}
+		}
+	}
+
+	memcpy(&next, tiff + ifd_offset + NUM_SIZE + entries_count * IFD_SIZE, OFFSET_SIZE);
+
+	return (int) next;
+}
+
+static int exynos_exif_template_create(struct exynos_camera *exynos_camera,
+	exif_attribute_t *exif_attributes, int thumb, void *exif_data, int exif_size)
+{
+	struct exynos_exif_template *template;
+	unsigned char *tiff;
+	int tiff_size;
+	unsigned int exif_ifd = 0;
+	unsigned int gps_ifd = 0;
+	unsigned int thumb_offset = 0;
+	int ifd1;
+	int size;
+	int i;
+
+	if (exynos_camera == NULL || exif_attributes == NULL || exif_data == NULL || exif_size <= 10)
+		return -EINVAL;
+
+	template = &exynos_camera->exif_template;
+
+	for (i = 0; i < EXYNOS_EXIF_TEMPLATE_POSITIONS_MAX; i++)
+		template->positions[i] = -1;
+	template->gps_processing_method_position = -1;
+	template->thumb_size_position = -1;
+
+	tiff = (unsigned char *) exif_data + 10;
+	tiff_size = exif_size - 10;
+
+	ifd1 = exynos_exif_template_ifd(template, tiff, tiff_size, 8, EXYNOS_EXIF_IFD_0,
+		&exif_ifd, &gps_ifd, &thumb_offset);
+	if (ifd1 < 0)
+		return -1;
+
+	if (exynos_exif_template_ifd(template, tiff, tiff_size, exif_ifd, EXYNOS_EXIF_IFD_EXIF,
+		&exif_ifd, &gps_ifd, &thumb_offset) < 0)
+		return -1;
+
+	if (exif_attributes->enableGps && exynos_exif_template_ifd(template, tiff, tiff_size,
+		gps_ifd, EXYNOS_EXIF_IFD_GPS, &exif_ifd, &gps_ifd, &thumb_offset) < 0)
+		return -1;
+
+	if (thumb) {
+		if (exynos_exif_template_ifd(template, tiff, tiff_size, ifd1, EXYNOS_EXIF_IFD_1,
+			&exif_ifd, &gps_ifd, &thumb_offset) < 0)
+			return -1;
+
+		if (thumb_offset == 0 || (int) thumb_offset > tiff_size || template->thumb_size_position < 0)
+			return -1;
+
+		size = thumb_offset + 10;
+	} else {
+		size = exif_size;
+	}
+
+	if (exynos_exif_gps_processing_method_length(exif_attributes) > 0 &&
+		template->gps_processing_method_position < 0)
+		return -1;
+
+	template->data = malloc(size);
+	if (template->data == NULL)
+		return -1;
+
+	memcpy(template->data, exif_data, size);
+	template->size = size;
+
+	template->gps = exif_attributes->enableGps;
+	template->gps_processing_method_length = exynos_exif_gps_processing_method_length(exif_attributes);
+	template->thumb = thumb;
+
+	return 0;
+}
+
+static int exynos_exif_template_apply(struct exynos_camera *exynos_camera,
+	exif_attribute_t *exif_attributes,
+	camera_memory_t *jpeg_thumbnail_data_memory, int jpeg_thumbnail_size,
+	void *data, int size)
+{
+	unsigned char exif_ascii_prefix[] = { 0x41, 0x53, 0x43, 0x49, 0x49, 0x0, 0x0, 0x0 };
+
+	struct exynos_exif_template *template;
+	unsigned char *exif_data;
+	unsigned int exif_thumb_size;
+	int exif_size;
+	int position;
+	int i;
+
+	if (exynos_camera == NULL || exif_attributes == NULL || data == NULL)
+		return -EINVAL;
+
+	template = &exynos_camera->exif_template;
+
+	exif_size = template->size;
+	if (template->thumb)
+		exif_size += jpeg_thumbnail_size;
+
+	if (exif_size != size) {
+		ALOGE("%s: EXIF size mismatch: %d/%d", __func__, exif_size, size);
+		return -1;
+	}
+
+	exif_data = (unsigned char *) data;
+
+	memcpy(exif_data, template->data, template->size);
+
+	for (i = 0; i < (int) (sizeof(exynos_exif_tags) / sizeof(exynos_exif_tags[0])); i++) {
+		position = template->positions[i];
+		if (position < 0)
+			continue;
+
+		memcpy(exif_data + position, (unsigned char *) exif_attributes + exynos_exif_tags[i].offset,
+			exynos_exif_tags[i].length);
+	}
+
+	if (template->gps_processing_method_length > 0) {
+		position = template->gps_processing_method_position;
+
+		memcpy(exif_data + position, exif_ascii_prefix, sizeof(exif_ascii_prefix));
+		memcpy(exif_data + position + sizeof(exif_ascii_prefix),
+			exif_attributes->gps_processing_method, template->gps_processing_method_length);
+	}
+
+	if (template->thumb) {
+		exif_thumb_size = (unsigned int) jpeg_thumbnail_size;
+		memcpy(exif_data + template->thumb_size_position, &exif_thumb_size, sizeof(exif_thumb_size));
+
+		memcpy(exif_data + template->size, jpeg_thumbnail_data_memory->data, jpeg_thumbnail_size);
+	}
+
+	exif_data[2] = ((exif_size - 2) >> 8) & 0xff;
+	exif_data[3] = (exif_size - 2) & 0xff;
+
+	return 0;
+}
+
+// Builds the template once for the layout of these attributes
+static int exynos_exif_template_prepare(struct exynos_camera *exynos_camera,
+	exif_attribute_t *exif_attributes,
+	camera_memory_t *jpeg_thumbnail_data_memory, int jpeg_thumbnail_size)
+{
+	struct exynos_exif_template *template;
+	void *exif_data = NULL;
+	int exif_size = 0;
+	int thumb;
+	int rc;
+
+	template = &exynos_camera->exif_template;
+	thumb = exif_attributes->enableThumb ? 1 : 0;
+
+	if (template->data != NULL && template->thumb == thumb &&
+		template->gps == exif_attributes->enableGps &&
+		template->gps_processing_method_length == exynos_exif_gps_processing_method_length(exif_attributes))
+		return 0;
+
+	rc = exynos_exif_build(exynos_camera, exif_attributes,
+		jpeg_thumbnail_data_memory, jpeg_thumbnail_size, &exif_data, &exif_size);
+	if (rc < 0)
+		return -1;
+
+	exynos_exif_template_release(exynos_camera);
+
+	rc = exynos_exif_template_create(exynos_camera, exif_attributes, thumb,
+		exif_data, exif_size);
+
+	free(exif_data);
+
+	if (rc < 0) {
+		ALOGE("%s: Failed to create EXIF template", __func__);
+		exynos_exif_template_release(exynos_camera);
+		return -1;
+	}
+
+	return 0;
+}
+
+void exynos_exif_template_release(struct exynos_camera *exynos_camera)
+{
+	struct exynos_exif_template *template;
+
+	if (exynos_camera == NULL)
+		return;
+
+	template = &exynos_camera->exif_template;
+
+	if (template->data != NULL)
+		free(template->data);
+
+	template->data = NULL;
+	template->size = 0;
+}
+
+/*
+ * The EXIF layout only depends on the enabled sections, so the size is known
+ * from the template before the picture is encoded. The EXIF is then written
+ * in place, right after the SOI marker of the final picture buffer.
+ */
+
+int exynos_exif_size(struct exynos_camera *exynos_camera,
+	exif_attribute_t *exif_attributes,
+	camera_memory_t *jpeg_thumbnail_data_memory, int jpeg_thumbnail_size)
+{
+	struct exynos_exif_template *template;
+	int exif_size;
+	int rc;
+
+	if (exynos_camera == NULL || exif_attributes == NULL ||
+		jpeg_thumbnail_data_memory == NULL || jpeg_thumbnail_size <= 0)
+		return -EINVAL;
+
+	template = &exynos_camera->exif_template;
+
+	pthread_mutex_lock(&exynos_camera->exif_mutex);
+
+	rc = exynos_exif_template_prepare(exynos_camera, exif_attributes,
+		jpeg_thumbnail_data_memory, jpeg_thumbnail_size);
+
+	exif_size = template->size;
+	if (template->thumb)
+		exif_size += jpeg_thumbnail_size;
+
+	pthread_mutex_unlock(&exynos_camera->exif_mutex);
+
+	if (rc < 0)
+		return -1;
+
+	return exif_size;
+}
+
+int exynos_exif_write(struct exynos_camera *exynos_camera,
+	exif_attribute_t *exif_attributes,
+	camera_memory_t *jpeg_thumbnail_data_memory, int jpeg_thumbnail_size,
+	void *exif_data, int exif_size)
+{
+	int rc;
+
+	if (exynos_camera == NULL || exif_attributes == NULL ||
+		jpeg_thumbnail_data_memory == NULL || jpeg_thumbnail_size <= 0 ||
+		exif_data == NULL || exif_size <= 0)
+		return -EINVAL;
+
+	pthread_mutex_lock(&exynos_camera->exif_mutex);
+
+	// Burst frames are sized at capture, the layout may have changed since
+	rc = exynos_exif_template_prepare(exynos_camera, exif_attributes,
+		jpeg_thumbnail_data_memory, jpeg_thumbnail_size);
+	if (rc >= 0)
+		rc = exynos_exif_template_apply(exynos_camera, exif_attributes,
+			jpeg_thumbnail_data_memory, jpeg_thumbnail_size, exif_data, exif_size);
+
+	pthread_mutex_unlock(&exynos_camera->exif_mutex);
+
+	return rc;
+}
@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2013 Paul Kocialkowski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <jpeg_api.h>
+
+#define LOG_TAG "exynos_jpeg"
+#include <utils/Log.h>
+
+#include "exynos_camera.h"
+
+/*
+ * The libs5pjpeg session (device and mapped buffers) is kept open and reused
+ * for every encode instead of being set up twice per shot.
+ */
+
+int exynos_jpeg_start(struct exynos_camera *exynos_camera)
+{
+	struct exynos_jpeg *jpeg;
+
+	if (exynos_camera == NULL)
+		return -EINVAL;
+
+	jpeg = &exynos_camera->jpeg;
+
+	if (jpeg->fd > 0)
+		return 0;
+
+	memset(jpeg, 0, sizeof(struct exynos_jpeg));
+
+	jpeg->fd = api_jpeg_encode_init();
+	if (jpeg->fd < 0) {
+		ALOGE("%s: Failed to init JPEG", __func__);
+		goto error;
+	}
+
+	jpeg->out_buffer = api_jpeg_get_encode_out_buf(jpeg->fd);
+	if (jpeg->out_buffer == NULL) {
+		ALOGE("%s: Failed to get JPEG out buffer", __func__);
+		goto error;
+	}
+
+	return 0;
+
+error:
+	exynos_jpeg_stop(exynos_camera);
+
+	return -1;
+}
+
+void exynos_jpeg_stop(struct exynos_camera *exynos_camera)
+{
+	struct exynos_jpeg *jpeg;
+
+	if (exynos_camera == NULL)
+		return;
+
+	jpeg = &exynos_camera->jpeg;
+
+	if (jpeg->fd > 0)
+		api_jpeg_encode_deinit(jpeg->fd);
+
+	memset(jpeg, 0, sizeof(struct exynos_jpeg));
+	jpeg->fd = -1;
+}
+
+void *exynos_jpeg_in_buffer(struct exynos_camera *exynos_camera, int size)
+{
+	struct exynos_jpeg *jpeg;
+	int rc;
+
+	if (exynos_camera == NULL || size <= 0)
+		return NULL;
+
+	jpeg = &exynos_camera->jpeg;
+
+	if (jpeg->fd <= 0) {
+		rc = exynos_jpeg_start(exynos_camera);
+		if (rc < 0)
+			return NULL;
+	}
+
+	// Only ask for a new mapping when it has to grow
+	if (jpeg->in_buffer == NULL || size > jpeg->in_size) {
+		jpeg->in_buffer = api_jpeg_get_encode_in_buf(jpeg->fd, size);
+		if (jpeg->in_buffer == NULL) {
+			ALOGE("%s: Failed to get JPEG in buffer", __func__);
+			jpeg->in_size = 0;
+			return NULL;
+		}
+
+		jpeg->in_size = size;
+	}
+
+	return jpeg->in_buffer;
+}
+
+static int exynos_jpeg_format(int format, int width, int height,
+	enum jpeg_frame_format *in_format, enum jpeg_stream_format *out_format)
+{
+	if (in_format == NULL || out_format == NULL)
+		return -EINVAL;
+
+	switch (format) {
+		case V4L2_PIX_FMT_RGB565:
+			*in_format = RGB_565;
+			*out_format = JPEG_420;
+			return width * height * 2;
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+		case V4L2_PIX_FMT_NV12T:
+		case V4L2_PIX_FMT_YUV420:
+			*in_format = YUV_420;
+			*out_format = JPEG_420;
+			return (int) (width * height * 1.5);
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+		case V4L2_PIX_FMT_YUV422P:
+		default:
+			*in_format = YUV_422;
+			*out_format = JPEG_422;
+			return width * height * 2;
+	}
+}
+
+int exynos_jpeg_in_size(int format, int width, int height)
+{
+	enum jpeg_frame_format jpeg_in_format;
+	enum jpeg_stream_format jpeg_out_format;
+
+	return exynos_jpeg_format(format, width, height, &jpeg_in_format, &jpeg_out_format);
+}
+
+int exynos_jpeg_encode(struct exynos_camera *exynos_camera, int format,
+	int width, int height, int quality, void **out_buffer, int *out_size)
+{
+	struct exynos_jpeg *jpeg;
+	struct jpeg_enc_param jpeg_enc_params;
+	enum jpeg_frame_format jpeg_in_format;
+	enum jpeg_stream_format jpeg_out_format;
+	enum jpeg_ret_type jpeg_result;
+
+	if (exynos_camera == NULL || out_buffer == NULL || out_size == NULL)
+		return -EINVAL;
+
+	jpeg = &exynos_camera->jpeg;
+
+	if (jpeg->fd <= 0 || jpeg->in_buffer == NULL || jpeg->out_buffer == NULL)
+		return -1;
+
+	exynos_jpeg_format(format, width, height, &jpeg_in_format, &jpeg_out_format);
+
+	memset(&jpeg_enc_params, 0, sizeof(jpeg_enc_params));
+
+	jpeg_enc_params.width = width;
+	jpeg_enc_params.height = height;
+	jpeg_enc_params.in_fmt = jpeg_in_format;
+	jpeg_enc_params.out_fmt = jpeg_out_format;
+
+	if (quality >= 90)
+		jpeg_enc_params.quality = QUALITY_LEVEL_1;
+	else if (quality >= 80)
+		jpeg_enc_params.quality = QUALITY_LEVEL_2;
+	else if (quality >= 70)
+		jpeg_enc_params.quality = QUALITY_LEVEL_3;
+	else
+		jpeg_enc_params.quality = QUALITY_LEVEL_4;
+
+	api_jpeg_set_encode_param(&jpeg_enc_params);
+
+	jpeg_result = api_jpeg_encode_exe(jpeg->fd, &jpeg_enc_params);
+	if (jpeg_result != JPEG_ENCODE_OK) {
+		ALOGE("%s: Failed to encode JPEG", __func__);
+		return -1;
+	}
+
+	if ((int) jpeg_enc_params.size <= 0) {
+		ALOGE("%s: Failed to get JPEG out size", __func__);
+		return -1;
+	}
+
+	*out_buffer = jpeg->out_buffer;
+	*out_size = (int) jpeg_enc_params.size;
+
+	return 0;
+}
@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2013 Paul Kocialkowski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#define LOG_TAG "exynos_memory"
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include "exynos_camera.h"
+
+/*
+ * Callbacks take the size of the memory as the size of the data, so the
+ * released memory is only given back for the exact same buffers size and
+ * count. Idle memory is bounded, the least recently released goes first.
+ */
+
+void exynos_memory_pool_init(struct exynos_camera *exynos_camera)
+{
+	struct exynos_memory_pool *pool;
+
+	if (exynos_camera == NULL)
+		return;
+
+	pool = &exynos_camera->memory_pool;
+
+	memset(pool, 0, sizeof(struct exynos_memory_pool));
+	pthread_mutex_init(&pool->mutex, NULL);
+}
+
+static void exynos_memory_evict(struct exynos_memory_pool *pool,
+	struct exynos_memory_entry *entry)
+{
+	pool->bytes -= entry->memory->size;
+	pool->bytes_idle -= entry->memory->size;
+	pool->evictions++;
+
+	if (entry->memory->release != NULL)
+		entry->memory->release(entry->memory);
+
+	memset(entry, 0, sizeof(struct exynos_memory_entry));
+}
+
+// Least recently released idle entry, NULL when all are in use
+static struct exynos_memory_entry *exynos_memory_idle_oldest(struct exynos_memory_pool *pool)
+{
+	struct exynos_memory_entry *oldest = NULL;
+	struct exynos_memory_entry *entry;
+	int i;
+
+	for (i = 0; i < EXYNOS_MEMORY_POOL_SIZE; i++) {
+		entry = &pool->entries[i];
+		if (entry->memory == NULL || entry->used)
+			continue;
+
+		if (oldest == NULL || entry->release_time < oldest->release_time)
+			oldest = entry;
+	}
+
+	return oldest;
+}
+
+void exynos_memory_pool_deinit(struct exynos_camera *exynos_camera)
+{
+	struct exynos_memory_pool *pool;
+	struct exynos_memory_entry *entry;
+	int i;
+
+	if (exynos_camera == NULL)
+		return;
+
+	pool = &exynos_camera->memory_pool;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	for (i = 0; i < EXYNOS_MEMORY_POOL_SIZE; i++) {
+		entry = &pool->entries[i];
+		if (entry->memory == NULL)
+			continue;
+
+		if (entry->used)
+			ALOGE("%s: Memory %p is still in use", __func__, entry->memory);
+		else
+			exynos_memory_evict(pool, entry);
+	}
+
+	ALOGD("%s: %d hits, %d misses, %d evictions, %d bytes at most", __func__,
+		pool->hits, pool->misses, pool->evictions, pool->bytes_max);
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	pthread_mutex_destroy(&pool->mutex);
+}
+
+camera_memory_t *exynos_memory_get(struct exynos_camera *exynos_camera,
+	int size, int count)
+{
+	struct exynos_memory_pool *pool;
+	struct exynos_memory_entry *entry;
+	camera_memory_t *memory;
+	int i;
+
+	if (exynos_camera == NULL || size <= 0 || count <= 0)
+		return NULL;
+
+	if (exynos_camera->callbacks.request_memory == NULL) {
+		ALOGE("%s: No memory request function!", __func__);
+		return NULL;
+	}
+
+	pool = &exynos_camera->memory_pool;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	for (i = 0; i < EXYNOS_MEMORY_POOL_SIZE; i++) {
+		entry = &pool->entries[i];
+		if (entry->memory == NULL || entry->used || entry->size != size || entry->count != count)
+			continue;
+
+		entry->used = 1;
+		pool->bytes_idle -= entry->memory->size;
+		pool->hits++;
+
+		pthread_mutex_unlock(&pool->mutex);
+
+		return entry->memory;
+	}
+
+	pool->misses++;
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	memory = exynos_camera->callbacks.request_memory(-1, size, count, 0);
+	if (memory == NULL) {
+		ALOGE("%s: memory request failed!", __func__);
+		return NULL;
+	}
+
+	pthread_mutex_lock(&pool->mutex);
+
+	entry = NULL;
+	for (i = 0; i < EXYNOS_MEMORY_POOL_SIZE; i++) {
+		if (pool->entries[i].memory == NULL) {
+			entry = &pool->entries[i];
+			break;
+		}
+	}
+
+	if (entry == NULL) {
+		entry = exynos_memory_idle_oldest(pool);
+		if (entry != NULL)
+			exynos_memory_evict(pool, entry);
+	}
+
+	// Untracked memory is released when it is put back
+	if (entry != NULL) {
+		entry->memory = memory;
+		entry->size = size;
+		entry->count = count;
+		entry->used = 1;
+	}
+
+	pool->bytes += memory->size;
+	if (pool->bytes > pool->bytes_max)
+		pool->bytes_max = pool->bytes;
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	return memory;
+}
+
+void exynos_memory_put(struct exynos_camera *exynos_camera, camera_memory_t *memory)
+{
+	struct exynos_memory_pool *pool;
+	struct exynos_memory_entry *entry;
+	int i;
+
+	if (exynos_camera == NULL || memory == NULL)
+		return;
+
+	pool = &exynos_camera->memory_pool;
+
+	pthread_mutex_lock(&pool->mutex);
+
+	for (i = 0; i < EXYNOS_MEMORY_POOL_SIZE; i++) {
+		entry = &pool->entries[i];
+		if (entry->memory != memory)
+			continue;
+
+		entry->used = 0;
+		entry->release_time = systemTime(SYSTEM_TIME_MONOTONIC);
+		pool->bytes_idle += memory->size;
+
+		while (pool->bytes_idle > EXYNOS_MEMORY_POOL_IDLE_MAX) {
+			entry = exynos_memory_idle_oldest(pool);
+			if (entry == NULL)
+				break;
+
+			exynos_memory_evict(pool, entry);
+		}
+
+		pthread_mutex_unlock(&pool->mutex);
+
+		return;
+	}
+
+	pool->bytes -= memory->size;
+
+	pthread_mutex_unlock(&pool->mutex);
+
+	if (memory->release != NULL)
+		memory->release(memory);
+}
@@ -27,169 +27,333 @@
 
 #include "exynos_camera.h"
 
-int list_head_insert(struct list_head *list, struct list_head *prev,
-	struct list_head *next)
+/*
+ * Keys known at init time are registered first, in this order, so that their
+ * index in the params array is their enum exynos_param_key value.
+ */
+
+static const char *exynos_param_keys[EXYNOS_PARAM_KEYS_COUNT] = {
+	[EXYNOS_PARAM_KEY_PREFERRED_PREVIEW_SIZE_FOR_VIDEO] = "preferred-preview-size-for-video",
+	[EXYNOS_PARAM_KEY_PREVIEW_SIZE_VALUES] = "preview-size-values",
+	[EXYNOS_PARAM_KEY_PREVIEW_SIZE] = "preview-size",
+	[EXYNOS_PARAM_KEY_PREVIEW_FORMAT_VALUES] = "preview-format-values",
+	[EXYNOS_PARAM_KEY_PREVIEW_FORMAT] = "preview-format",
+	[EXYNOS_PARAM_KEY_PREVIEW_FRAME_RATE_VALUES] = "preview-frame-rate-values",
+	[EXYNOS_PARAM_KEY_PREVIEW_FRAME_RATE] = "preview-frame-rate",
+	[EXYNOS_PARAM_KEY_PREVIEW_FPS_RANGE_VALUES] = "preview-fps-range-values",
+	[EXYNOS_PARAM_KEY_PREVIEW_FPS_RANGE] = "preview-fps-range",
+	[EXYNOS_PARAM_KEY_PICTURE_SIZE_VALUES] = "picture-size-values",
+	[EXYNOS_PARAM_KEY_PICTURE_SIZE] = "picture-size",
+	[EXYNOS_PARAM_KEY_PICTURE_FORMAT_VALUES] = "picture-format-values",
+	[EXYNOS_PARAM_KEY_PICTURE_FORMAT] = "picture-format",
+	[EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_SIZE_VALUES] = "jpeg-thumbnail-size-values",
+	[EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_WIDTH] = "jpeg-thumbnail-width",
+	[EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_HEIGHT] = "jpeg-thumbnail-height",
+	[EXYNOS_PARAM_KEY_JPEG_THUMBNAIL_QUALITY] = "jpeg-thumbnail-quality",
+	[EXYNOS_PARAM_KEY_JPEG_QUALITY] = "jpeg-quality",
+	[EXYNOS_PARAM_KEY_NUM_SNAPS_PER_SHUTTER] = "num-snaps-per-shutter",
+	[EXYNOS_PARAM_KEY_VIDEO_SNAPSHOT_SUPPORTED] = "video-snapshot-supported",
+	[EXYNOS_PARAM_KEY_FULL_VIDEO_SNAP_SUPPORTED] = "full-video-snap-supported",
+	[EXYNOS_PARAM_KEY_VIDEO_SIZE] = "video-size",
+	[EXYNOS_PARAM_KEY_VIDEO_SIZE_VALUES] = "video-size-values",
+	[EXYNOS_PARAM_KEY_VIDEO_FRAME_FORMAT] = "video-frame-format",
+	[EXYNOS_PARAM_KEY_FOCUS_MODE] = "focus-mode",
+	[EXYNOS_PARAM_KEY_FOCUS_MODE_VALUES] = "focus-mode-values",
+	[EXYNOS_PARAM_KEY_FOCUS_DISTANCES] = "focus-distances",
+	[EXYNOS_PARAM_KEY_FOCUS_AREAS] = "focus-areas",
+	[EXYNOS_PARAM_KEY_MAX_NUM_FOCUS_AREAS] = "max-num-focus-areas",
+	[EXYNOS_PARAM_KEY_TOUCH_AF_AEC] = "touch-af-aec",
+	[EXYNOS_PARAM_KEY_ZOOM_SUPPORTED] = "zoom-supported",
+	[EXYNOS_PARAM_KEY_SMOOTH_ZOOM_SUPPORTED] = "smooth-zoom-supported",
+	[EXYNOS_PARAM_KEY_ZOOM_RATIOS] = "zoom-ratios",
+	[EXYNOS_PARAM_KEY_ZOOM] = "zoom",
+	[EXYNOS_PARAM_KEY_MAX_ZOOM] = "max-zoom",
+	[EXYNOS_PARAM_KEY_FLASH_MODE] = "flash-mode",
+	[EXYNOS_PARAM_KEY_FLASH_MODE_VALUES] = "flash-mode-values",
+	[EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION] = "exposure-compensation",
+	[EXYNOS_PARAM_KEY_EXPOSURE_COMPENSATION_STEP] = "exposure-compensation-step",
+	[EXYNOS_PARAM_KEY_MIN_EXPOSURE_COMPENSATION] = "min-exposure-compensation",
+	[EXYNOS_PARAM_KEY_MAX_EXPOSURE_COMPENSATION] = "max-exposure-compensation",
+	[EXYNOS_PARAM_KEY_WHITEBALANCE] = "whitebalance",
+	[EXYNOS_PARAM_KEY_WHITEBALANCE_VALUES] = "whitebalance-values",
+	[EXYNOS_PARAM_KEY_SCENE_MODE] = "scene-mode",
+	[EXYNOS_PARAM_KEY_SCENE_MODE_VALUES] = "scene-mode-values",
+	[EXYNOS_PARAM_KEY_EFFECT] = "effect",
+	[EXYNOS_PARAM_KEY_EFFECT_VALUES] = "effect-values",
+	[EXYNOS_PARAM_KEY_ISO] = "iso",
+	[EXYNOS_PARAM_KEY_ISO_VALUES] = "iso-values",
+	[EXYNOS_PARAM_KEY_FOCAL_LENGTH] = "focal-length",
+	[EXYNOS_PARAM_KEY_HORIZONTAL_VIEW_ANGLE] = "horizontal-view-angle",
+	[EXYNOS_PARAM_KEY_VERTICAL_VIEW_ANGLE] = "vertical-view-angle",
+	[EXYNOS_PARAM_KEY_RECORDING_HINT] = "recording-hint",
+	[EXYNOS_PARAM_KEY_ROTATION] = "rotation",
+	[EXYNOS_PARAM_KEY_GPS_LATITUDE] = "gps-latitude",
+	[EXYNOS_PARAM_KEY_GPS_LONGITUDE] = "gps-longitude",
+	[EXYNOS_PARAM_KEY_GPS_ALTITUDE] = "gps-altitude",
+	[EXYNOS_PARAM_KEY_GPS_TIMESTAMP] = "gps-timestamp",
+	[EXYNOS_PARAM_KEY_GPS_PROCESSING_METHOD] = "gps-processing-method",
+};
+
+unsigned int exynos_param_hash(char *key)
 {
-	if (list == NULL)
-		return -EINVAL;
+	unsigned int hash = 2166136261U;
 
-	list->prev = prev;
-	list->next = next;
+	// FNV-1a
+	while (*key != '\0') {
+		hash ^= (unsigned char) *key++;
+		hash *= 16777619U;
+	}
 
-	if(prev != NULL)
-		prev->next = list;
-	if(next != NULL)
-		next->prev = list;
+	return hash;
+}
 
-	return 0;
+void exynos_param_table_insert(struct exynos_camera *exynos_camera, int index)
+{
+	unsigned int mask;
+	unsigned int i;
+
+	mask = exynos_camera->params_table_size - 1;
+	i = exynos_camera->params[index].hash & mask;
+
+	while (exynos_camera->params_table[i] != 0)
+		i = (i + 1) & mask;
+
+	// Slots hold index + 1, 0 is an empty slot
+	exynos_camera->params_table[i] = index + 1;
 }
 
-void list_head_remove(struct list_head *list)
+int exynos_param_table_resize(struct exynos_camera *exynos_camera, int size)
 {
-	if(list == NULL)
-		return;
+	int *table;
+	int i;
+
+	table = (int *) calloc(size, sizeof(int));
+	if (table == NULL)
+		return -ENOMEM;
+
+	if (exynos_camera->params_table != NULL)
+		free(exynos_camera->params_table);
+
+	exynos_camera->params_table = table;
+	exynos_camera->params_table_size = size;
 
-	if(list->next != NULL)
-		list->next->prev = list->prev;
-	if(list->prev != NULL)
-		list->prev->next = list->next;
+	for (i = 0; i < exynos_camera->params_count; i++)
+		exynos_param_table_insert(exynos_camera, i);
+
+	return 0;
 }
 
-int exynos_param_register(struct exynos_camera *exynos_camera, char *key,
-	union exynos_param_data data, enum exynos_param_type type)
+int exynos_param_register(struct exynos_camera *exynos_camera, char *key)
 {
-	struct list_head *list_end;
-	struct list_head *list;
+	struct exynos_param *params;
 	struct exynos_param *param;
+	int index;
+	int size;
+	int rc;
 
 	if (exynos_camera == NULL || key == NULL)
 		return -EINVAL;
 
-	param = (struct exynos_param *) calloc(1, sizeof(struct exynos_param));
-	if (param == NULL)
-		return -ENOMEM;
+	if (exynos_camera->params_count == exynos_camera->params_size) {
+		size = exynos_camera->params_size * 2;
 
-	param->key = strdup(key);
-	switch (type) {
-		case EXYNOS_PARAM_INT:
-			param->data.integer = data.integer;
-			break;
-		case EXYNOS_PARAM_FLOAT:
-			param->data.floating = data.floating;
-			break;
-		case EXYNOS_PARAM_STRING:
-			param->data.string = strdup(data.string);
-			break;
-		default:
-			ALOGE("%s: Invalid type", __func__);
-			goto error;
+		params = (struct exynos_param *) realloc(exynos_camera->params,
+			size * sizeof(struct exynos_param));
+		if (params == NULL)
+			return -ENOMEM;
+
+		memset(&params[exynos_camera->params_size], 0,
+			(size - exynos_camera->params_size) * sizeof(struct exynos_param));
+
+		exynos_camera->params = params;
+		exynos_camera->params_size = size;
 	}
-	param->type = type;
 
-	list_end = (struct list_head *) exynos_camera->params;
-	while (list_end != NULL && list_end->next != NULL)
-		list_end = list_end->next;
+	// Keep the table at most half full
+	if (exynos_camera->params_count * 2 >= exynos_camera->params_table_size) {
+		rc = exynos_param_table_resize(exynos_camera, exynos_camera->params_table_size * 2);
+		if (rc < 0)
+			return rc;
+	}
 
-	list = (struct list_head *) param;
-	list_head_insert(list, list_end, NULL);
+	index = exynos_camera->params_count;
+	param = &exynos_camera->params[index];
 
-	if (exynos_camera->params == NULL)
-		exynos_camera->params = param;
+	param->key = strdup(key);
+	if (param->key == NULL)
+		return -ENOMEM;
 
-	return 0;
+	param->hash = exynos_param_hash(key);
+	param->flags = 0;
 
-error:
-	if (param != NULL) {
-		if (param->key != NULL)
-			free(param->key);
+	exynos_camera->params_count++;
+	exynos_param_table_insert(exynos_camera, index);
+
+	return index;
+}
+
+int exynos_param_find_key(struct exynos_camera *exynos_camera,
+	char *key)
+{
+	struct exynos_param *param;
+	unsigned int hash;
+	unsigned int mask;
+	unsigned int i;
+	int index;
 
-		free(param);
+	if (exynos_camera == NULL || key == NULL || exynos_camera->params_table == NULL)
+		return -EINVAL;
+
+	hash = exynos_param_hash(key);
+	mask = exynos_camera->params_table_size - 1;
+	i = hash & mask;
+
+	while (exynos_camera->params_table[i] != 0) {
+		index = exynos_camera->params_table[i] - 1;
+		param = &exynos_camera->params[index];
+
+		if (param->hash == hash && strcmp(param->key, key) == 0)
+			return index;
+
+		i = (i + 1) & mask;
 	}
 
 	return -1;
 }
 
-void exynos_param_unregister(struct exynos_camera *exynos_camera,
-	struct exynos_param *param)
+int exynos_params_init(struct exynos_camera *exynos_camera)
 {
-	struct list_head *list;
+	int size;
+	int rc;
+	int i;
 
-	if (exynos_camera == NULL || param == NULL)
-		return;
+	if (exynos_camera == NULL)
+		return -EINVAL;
 
-	list = (struct list_head *) exynos_camera->params;
-	while (list != NULL) {
-		if ((void *) list == (void *) param) {
-			list_head_remove(list);
+	if (exynos_camera->params != NULL)
+		return 0;
 
-			if ((void *) list == (void *) exynos_camera->params)
-				exynos_camera->params = (struct exynos_param *) list->next;
+	size = 32;
+	while (size < EXYNOS_PARAM_KEYS_COUNT)
+		size *= 2;
 
-			if (param->type == EXYNOS_PARAM_STRING && param->data.string != NULL)
-				free(param->data.string);
+	exynos_camera->params = (struct exynos_param *) calloc(size, sizeof(struct exynos_param));
+	if (exynos_camera->params == NULL)
+		return -ENOMEM;
 
-			memset(param, 0, sizeof(struct exynos_param));
-			free(param);
+	exynos_camera->params_count = 0;
+	exynos_camera->params_size = size;
 
-			break;
-		}
+	rc = exynos_param_table_resize(exynos_camera, size * 2);
+	if (rc < 0)
+		goto error;
 
-list_continue:
-		list = list->next;
+	for (i = 0; i < EXYNOS_PARAM_KEYS_COUNT; i++) {
+		rc = exynos_param_register(exynos_camera, (char *) exynos_param_keys[i]);
+		if (rc != i) {
+			ALOGE("%s: Unable to register key %s", __func__, exynos_param_keys[i]);
+			goto error;
+		}
 	}
+
+	return 0;
+
+error:
+	exynos_params_deinit(exynos_camera);
+
+	return -1;
 }
 
-struct exynos_param *exynos_param_find_key(struct exynos_camera *exynos_camera,
-	char *key)
+void exynos_params_deinit(struct exynos_camera *exynos_camera)
 {
 	struct exynos_param *param;
-	struct list_head *list;
+	int i;
 
-	if (exynos_camera == NULL || key == NULL)
-		return NULL;
+	if (exynos_camera == NULL)
+		return;
+
+	if (exynos_camera->params != NULL) {
+		for (i = 0; i < exynos_camera->params_count; i++) {
+			param = &exynos_camera->params[i];
 
-	list = (struct list_head *) exynos_camera->params;
-	while (list != NULL) {
-		param = (struct exynos_param *) list;
-		if (param->key == NULL)
-			goto list_continue;
+			if (param->type == EXYNOS_PARAM_STRING && (param->flags & EXYNOS_PARAM_SET) && param->data.string != NULL)
+				free(param->data.string);
 
-		if (strcmp(param->key, key) == 0)
-			return param;
+			if (param->key != NULL)
+				free(param->key);
+		}
 
-list_continue:
-		list = list->next;
+		free(exynos_camera->params);
+		exynos_camera->params = NULL;
 	}
 
-	return NULL;
+	if (exynos_camera->params_table != NULL) {
+		free(exynos_camera->params_table);
+		exynos_camera->params_table = NULL;
+	}
+
+	if (exynos_camera->params_string != NULL) {
+		free(exynos_camera->params_string);
+		exynos_camera->params_string = NULL;
+	}
+
+	exynos_camera->params_count = 0;
+	exynos_camera->params_size = 0;
+	exynos_camera->params_table_size = 0;
 }
 
-int exynos_param_data_set(struct exynos_camera *exynos_camera, char *key,
+int exynos_param_data_set_index(struct exynos_camera *exynos_camera, int index,
 	union exynos_param_data data, enum exynos_param_type type)
 {
 	struct exynos_param *param;
+	char *string = NULL;
+	int changed = 0;
 
-	if (exynos_camera == NULL || key == NULL)
-		return -EINVAL;
-
-	if (strchr(key, '=') || strchr(key, ';'))
+	if (exynos_camera == NULL || index < 0 || index >= exynos_camera->params_count)
 		return -EINVAL;
 
 	if (type == EXYNOS_PARAM_STRING && data.string != NULL &&
 		(strchr(data.string, '=') || strchr(data.string, ';')))
 		return -EINVAL;
 
-	param = exynos_param_find_key(exynos_camera, key);
-	if (param == NULL) {
-		// The key isn't in the list yet
-		exynos_param_register(exynos_camera, key, data, type);
-		return 0;
+	param = &exynos_camera->params[index];
+
+	if ((param->flags & EXYNOS_PARAM_SET) && param->type != type)
+		ALOGE("%s: Mismatching types for key %s", __func__, param->key);
+
+	switch (type) {
+		case EXYNOS_PARAM_INT:
+		case EXYNOS_PARAM_FLOAT:
+			break;
+		case EXYNOS_PARAM_STRING:
+			if (data.string == NULL)
+				return -EINVAL;
+
+			string = strdup(data.string);
+			if (string == NULL)
+				return -ENOMEM;
+			break;
+		default:
+			ALOGE("%s: Invalid type", __func__);
+			return -1;
 	}
 
-	if (param->type != type)
-		ALOGE("%s: Mismatching types for key %s", __func__, key);
+	// Only mark the param dirty when its value actually changes
+	if (!(param->flags & EXYNOS_PARAM_SET) || param->type != type)
+		changed = 1;
+	else if (type == EXYNOS_PARAM_INT && param->data.integer != data.integer)
+		changed = 1;
+	else if (type == EXYNOS_PARAM_FLOAT && param->data.floating != data.floating)
+		changed = 1;
+	else if (type == EXYNOS_PARAM_STRING && strcmp(param->data.string, string) != 0)
+		changed = 1;
+
+	if (changed) {
+		param->flags |= EXYNOS_PARAM_DIRTY;
+		exynos_camera->params_generation++;
+	}
 
-	if (param->type == EXYNOS_PARAM_STRING && param->data.string != NULL)
+	if ((param->flags & EXYNOS_PARAM_SET) && param->type == EXYNOS_PARAM_STRING && param->data.string != NULL)
 		free(param->data.string);
 
 	switch (type) {
@@ -200,27 +364,25 @@ int exynos_param_data_set(struct exynos_camera *exynos_camera, char *key,
 			param->data.floating = data.floating;
 			break;
 		case EXYNOS_PARAM_STRING:
-			param->data.string = strdup(data.string);
+			param->data.string = string;
 			break;
-		default:
-			ALOGE("%s: Invalid type", __func__);
-			return -1;
 	}
 	param->type = type;
+	param->flags |= EXYNOS_PARAM_SET;
 
 	return 0;
 }
 
-int exynos_param_data_get(struct exynos_camera *exynos_camera, char *key,
+int exynos_param_data_get_index(struct exynos_camera *exynos_camera, int index,
 	union exynos_param_data *data, enum exynos_param_type type)
 {
 	struct exynos_param *param;
 
-	if (exynos_camera == NULL || key == NULL || data == NULL)
+	if (exynos_camera == NULL || data == NULL || index < 0 || index >= exynos_camera->params_count)
 		return -EINVAL;
 
-	param = exynos_param_find_key(exynos_camera, key);
-	if (param == NULL || param->type != type)
+	param = &exynos_camera->params[index];
+	if (!(param->flags & EXYNOS_PARAM_SET) || param->type != type)
 		return -1;
 
 	memcpy(data, &param->data, sizeof(param->data));
@@ -228,6 +390,61 @@ int exynos_param_data_get(struct exynos_camera *exynos_camera, char *key,
 	return 0;
 }
 
+int exynos_param_dirty_get_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id)
+{
+	if (exynos_camera == NULL || exynos_camera->params == NULL || id >= EXYNOS_PARAM_KEYS_COUNT)
+		return 0;
+
+	return !!(exynos_camera->params[id].flags & EXYNOS_PARAM_DIRTY);
+}
+
+void exynos_param_dirty_clear_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id)
+{
+	if (exynos_camera == NULL || exynos_camera->params == NULL || id >= EXYNOS_PARAM_KEYS_COUNT)
+		return;
+
+	exynos_camera->params[id].flags &= ~EXYNOS_PARAM_DIRTY;
+}
+
+int exynos_param_data_set(struct exynos_camera *exynos_camera, char *key,
+	union exynos_param_data data, enum exynos_param_type type)
+{
+	int index;
+
+	if (exynos_camera == NULL || key == NULL)
+		return -EINVAL;
+
+	if (strchr(key, '=') || strchr(key, ';'))
+		return -EINVAL;
+
+	index = exynos_param_find_key(exynos_camera, key);
+	if (index < 0) {
+		// The key isn't in the table yet
+		index = exynos_param_register(exynos_camera, key);
+		if (index < 0)
+			return -1;
+	}
+
+	return exynos_param_data_set_index(exynos_camera, index, data, type);
+}
+
+int exynos_param_data_get(struct exynos_camera *exynos_camera, char *key,
+	union exynos_param_data *data, enum exynos_param_type type)
+{
+	int index;
+
+	if (exynos_camera == NULL || key == NULL || data == NULL)
+		return -EINVAL;
+
+	index = exynos_param_find_key(exynos_camera, key);
+	if (index < 0)
+		return -1;
+
+	return exynos_param_data_get_index(exynos_camera, index, data, type);
+}
+
 int exynos_param_int_get(struct exynos_camera *exynos_camera,
 	char *key)
 {
@@ -342,23 +559,136 @@ int exynos_param_string_set(struct exynos_camera *exynos_camera,
 	return 0;
 }
 
-char *exynos_params_string_get(struct exynos_camera *exynos_camera)
+int exynos_param_int_get_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id)
+{
+	union exynos_param_data data;
+	int rc;
+
+	if (exynos_camera == NULL || id >= EXYNOS_PARAM_KEYS_COUNT)
+		return -EINVAL;
+
+	rc = exynos_param_data_get_index(exynos_camera, id, &data, EXYNOS_PARAM_INT);
+	if (rc < 0) {
+		ALOGE("%s: Unable to get data for key %s", __func__, exynos_param_keys[id]);
+		return -1;
+	}
+
+	return data.integer;
+}
+
+float exynos_param_float_get_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id)
+{
+	union exynos_param_data data;
+	int rc;
+
+	if (exynos_camera == NULL || id >= EXYNOS_PARAM_KEYS_COUNT)
+		return -EINVAL;
+
+	rc = exynos_param_data_get_index(exynos_camera, id, &data, EXYNOS_PARAM_FLOAT);
+	if (rc < 0) {
+		ALOGE("%s: Unable to get data for key %s", __func__, exynos_param_keys[id]);
+		return -1;
+	}
+
+	return data.floating;
+}
+
+char *exynos_param_string_get_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id)
+{
+	union exynos_param_data data;
+	int rc;
+
+	if (exynos_camera == NULL || id >= EXYNOS_PARAM_KEYS_COUNT)
+		return NULL;
+
+	rc = exynos_param_data_get_index(exynos_camera, id, &data, EXYNOS_PARAM_STRING);
+	if (rc < 0) {
+		ALOGE("%s: Unable to get data for key %s", __func__, exynos_param_keys[id]);
+		return NULL;
+	}
+
+	return data.string;
+}
+
+int exynos_param_int_set_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id, int integer)
+{
+	union exynos_param_data data;
+	int rc;
+
+	if (exynos_camera == NULL || id >= EXYNOS_PARAM_KEYS_COUNT)
+		return -EINVAL;
+
+	data.integer = integer;
+
+	rc = exynos_param_data_set_index(exynos_camera, id, data, EXYNOS_PARAM_INT);
+	if (rc < 0) {
+		ALOGE("%s: Unable to set data for key %s", __func__, exynos_param_keys[id]);
+		return -1;
+	}
+
+	return 0;
+}
+
+int exynos_param_float_set_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id, float floating)
+{
+	union exynos_param_data data;
+	int rc;
+
+	if (exynos_camera == NULL || id >= EXYNOS_PARAM_KEYS_COUNT)
+		return -EINVAL;
+
+	data.floating = floating;
+
+	rc = exynos_param_data_set_index(exynos_camera, id, data, EXYNOS_PARAM_FLOAT);
+	if (rc < 0) {
+		ALOGE("%s: Unable to set data for key %s", __func__, exynos_param_keys[id]);
+		return -1;
+	}
+
+	return 0;
+}
+
+int exynos_param_string_set_id(struct exynos_camera *exynos_camera,
+	enum exynos_param_key id, char *string)
+{
+	union exynos_param_data data;
+	int rc;
+
+	if (exynos_camera == NULL || id >= EXYNOS_PARAM_KEYS_COUNT || string == NULL)
+		return -EINVAL;
+
+	data.string = string;
+
+	rc = exynos_param_data_set_index(exynos_camera, id, data, EXYNOS_PARAM_STRING);
+	if (rc < 0) {
+		ALOGE("%s: Unable to set data for key %s", __func__, exynos_param_keys[id]);
+		return -1;
+	}
+
+	return 0;
+}
+
+char *exynos_params_string_build(struct exynos_camera *exynos_camera)
 {
 	struct exynos_param *param;
-	struct list_head *list;
 	char *string = NULL;
 	char *s = NULL;
 	int length = 0;
 	int l = 0;
+	int i;
 
-	if (exynos_camera == NULL)
+	if (exynos_camera == NULL || exynos_camera->params == NULL)
 		return NULL;
 
-	list = (struct list_head *) exynos_camera->params;
-	while (list != NULL) {
-		param = (struct exynos_param *) list;
-		if (param->key == NULL)
-			goto list_continue_length;
+	for (i = 0; i < exynos_camera->params_count; i++) {
+		param = &exynos_camera->params[i];
+		if (param->key == NULL || !(param->flags & EXYNOS_PARAM_SET))
+			continue;
 
 		length += strlen(param->key);
 		length++;
@@ -377,22 +707,27 @@ char *exynos_params_string_get(struct exynos_camera *exynos_camera)
 		}
 
 		length++;
-
-list_continue_length:
-		list = list->next;
 	}
 
 	if (length == 0)
 		return NULL;
 
 	string = calloc(1, length);
+	if (string == NULL)
+		return NULL;
+
 	s = string;
 
-	list = (struct list_head *) exynos_camera->params;
-	while (list != NULL) {
-		param = (struct exynos_param *) list;
-		if (param->key == NULL)
-			goto list_continue;
+	// Params are serialized in insertion order
+	for (i = 0; i < exynos_camera->params_count; i++) {
+		param = &exynos_camera->params[i];
+		if (param->key == NULL || !(param->flags & EXYNOS_PARAM_SET))
+			continue;
+
+		if (s != string) {
+			*s = ';';
+			s++;
+		}
 
 		l = sprintf(s, "%s=", param->key);
 		s += l;
@@ -410,24 +745,37 @@ list_continue_length:
 				l = sprintf(s, "%s", param->data.string);
 				s += l;
 				break;
-			default:
-				ALOGE("%s: Invalid type", __func__);
-				return NULL;
 		}
+	}
 
-		if (list->next != NULL) {
-			*s = ';';
-			s++;
-		} else {
-			*s = '\0';
-			break;
-		}
+	*s = '\0';
+
+	return string;
+}
+
+char *exynos_params_string_get(struct exynos_camera *exynos_camera)
+{
+	char *string;
+
+	if (exynos_camera == NULL)
+		return NULL;
+
+	// The serialization is only built again when a param changed
+	if (exynos_camera->params_string == NULL ||
+		exynos_camera->params_string_generation != exynos_camera->params_generation) {
+		string = exynos_params_string_build(exynos_camera);
+		if (string == NULL)
+			return NULL;
 
-list_continue:
-		list = list->next;
+		if (exynos_camera->params_string != NULL)
+			free(exynos_camera->params_string);
+
+		exynos_camera->params_string = string;
+		exynos_camera->params_string_generation = exynos_camera->params_generation;
 	}
 
-	return string;
+	// The caller owns the returned string and releases it with free
+	return strdup(exynos_camera->params_string);
 }
 
 int exynos_params_string_set(struct exynos_camera *exynos_camera, char *string)
@@ -0,0 +1,405 @@
+/*
+ * Copyright (C) 2013 Paul Kocialkowski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#define LOG_TAG "exynos_scale"
+#include <utils/Log.h>
+
+#include "exynos_camera.h"
+
+/*
+ * Downscaling is done with 2:1 box filter passes (vectorized with NEON when
+ * available) until the picture is less than twice the requested size, then
+ * a nearest neighbour pass gives the exact size.
+ */
+
+static int exynos_scale_frame_size(int format, int width, int height)
+{
+	switch (format) {
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+			return width * height * 3 / 2;
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+		case V4L2_PIX_FMT_RGB565:
+			return width * height * 2;
+		default:
+			return -1;
+	}
+}
+
+static int exynos_scale_half_aligned(int format, int width, int height)
+{
+	switch (format) {
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+			return (width % 4) == 0 && (height % 4) == 0;
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+			return (width % 4) == 0 && (height % 2) == 0;
+		case V4L2_PIX_FMT_RGB565:
+			return (width % 2) == 0 && (height % 2) == 0;
+		default:
+			return 0;
+	}
+}
+
+static void exynos_scale_half_nv(unsigned char *src, int width, int height,
+	unsigned char *dst)
+{
+	unsigned char *a, *b, *d;
+	int dst_width = width / 2;
+	int dst_height = height / 2;
+	int x, y;
+	int c;
+
+	// Y
+	for (y = 0; y < dst_height; y++) {
+		a = src + 2 * y * width;
+		b = a + width;
+		d = dst + y * dst_width;
+		x = 0;
+
+#if defined(__ARM_NEON__)
+		for (; x + 8 <= dst_width; x += 8) {
+			uint16x8_t sum = vaddq_u16(vpaddlq_u8(vld1q_u8(a + 2 * x)),
+				vpaddlq_u8(vld1q_u8(b + 2 * x)));
+			vst1_u8(d + x, vrshrn_n_u16(sum, 2));
+		}
+#endif
+
+		for (; x < dst_width; x++)
+			d[x] = (a[2 * x] + a[2 * x + 1] + b[2 * x] + b[2 * x + 1] + 2) >> 2;
+	}
+
+	// CbCr pairs
+	src += width * height;
+	dst += dst_width * dst_height;
+
+	for (y = 0; y < dst_height / 2; y++) {
+		a = src + 2 * y * width;
+		b = a + width;
+		d = dst + y * dst_width;
+		x = 0;
+
+#if defined(__ARM_NEON__)
+		for (; x + 8 <= dst_width / 2; x += 8) {
+			uint8x16x2_t ra = vld2q_u8(a + 4 * x);
+			uint8x16x2_t rb = vld2q_u8(b + 4 * x);
+			uint8x8x2_t o;
+
+			o.val[0] = vrshrn_n_u16(vaddq_u16(vpaddlq_u8(ra.val[0]), vpaddlq_u8(rb.val[0])), 2);
+			o.val[1] = vrshrn_n_u16(vaddq_u16(vpaddlq_u8(ra.val[1]), vpaddlq_u8(rb.val[1])), 2);
+			vst2_u8(d + 2 * x, o);
+		}
+#endif
+
+		for (; x < dst_width / 2; x++)
+			for (c = 0; c < 2; c++)
+				d[2 * x + c] = (a[4 * x + c] + a[4 * x + 2 + c] +
+					b[4 * x + c] + b[4 * x + 2 + c] + 2) >> 2;
+	}
+}
+
+static void exynos_scale_half_yuyv(unsigned char *src, int width, int height,
+	unsigned char *dst, int y_offset)
+{
+	unsigned char *a, *b, *d;
+	int dst_width = width / 2;
+	int dst_height = height / 2;
+	int c_offset = 1 - y_offset;
+	int x, y, k;
+	int p;
+
+	for (y = 0; y < dst_height; y++) {
+		a = src + 2 * y * width * 2;
+		b = a + width * 2;
+		d = dst + y * dst_width * 2;
+		// Output macropixel
+		x = 0;
+
+#if defined(__ARM_NEON__)
+		for (; x + 8 <= dst_width / 2; x += 8) {
+			uint8x16x4_t ra = vld4q_u8(a + 8 * x);
+			uint8x16x4_t rb = vld4q_u8(b + 8 * x);
+			uint16x8_t sum_low, sum_high;
+			uint8x8x2_t luma;
+			uint8x8x4_t o;
+
+			// Each input macropixel becomes one output pixel
+			sum_low = vaddq_u16(vaddl_u8(vget_low_u8(ra.val[y_offset]), vget_low_u8(ra.val[y_offset + 2])),
+				vaddl_u8(vget_low_u8(rb.val[y_offset]), vget_low_u8(rb.val[y_offset + 2])));
+			sum_high = vaddq_u16(vaddl_u8(vget_high_u8(ra.val[y_offset]), vget_high_u8(ra.val[y_offset + 2])),
+				vaddl_u8(vget_high_u8(rb.val[y_offset]), vget_high_u8(rb.val[y_offset + 2])));
+			luma = vuzp_u8(vrshrn_n_u16(sum_low, 2), vrshrn_n_u16(sum_high, 2));
+
+			o.val[y_offset] = luma.val[0];
+			o.val[y_offset + 2] = luma.val[1];
+			o.val[c_offset] = vrshrn_n_u16(vaddq_u16(vpaddlq_u8(ra.val[c_offset]),
+				vpaddlq_u8(rb.val[c_offset])), 2);
+			o.val[c_offset + 2] = vrshrn_n_u16(vaddq_u16(vpaddlq_u8(ra.val[c_offset + 2]),
+				vpaddlq_u8(rb.val[c_offset + 2])), 2);
+
+			vst4_u8(d + 4 * x, o);
+		}
+#endif
+
+		for (; x < dst_width / 2; x++) {
+			for (k = 0; k < 2; k++) {
+				p = 4 * (2 * x + k);
+				d[4 * x + y_offset + 2 * k] = (a[p + y_offset] + a[p + y_offset + 2] +
+					b[p + y_offset] + b[p + y_offset + 2] + 2) >> 2;
+			}
+
+			for (k = c_offset; k < 4; k += 2)
+				d[4 * x + k] = (a[8 * x + k] + a[8 * x + 4 + k] +
+					b[8 * x + k] + b[8 * x + 4 + k] + 2) >> 2;
+		}
+	}
+}
+
+#if defined(__ARM_NEON__)
+static inline uint16x8_t exynos_scale_pairs_u16(uint16x8_t low, uint16x8_t high)
+{
+	return vcombine_u16(vpadd_u16(vget_low_u16(low), vget_high_u16(low)),
+		vpadd_u16(vget_low_u16(high), vget_high_u16(high)));
+}
+#endif
+
+static void exynos_scale_half_rgb565(unsigned short *src, int width, int height,
+	unsigned short *dst)
+{
+	unsigned short *a, *b, *d;
+	int dst_width = width / 2;
+	int dst_height = height / 2;
+	int r, g, bl;
+	int x, y, k;
+	unsigned short p;
+
+	for (y = 0; y < dst_height; y++) {
+		a = src + 2 * y * width;
+		b = a + width;
+		d = dst + y * dst_width;
+		x = 0;
+
+#if defined(__ARM_NEON__)
+		for (; x + 8 <= dst_width; x += 8) {
+			uint16x8_t a0 = vld1q_u16(a + 2 * x);
+			uint16x8_t a1 = vld1q_u16(a + 2 * x + 8);
+			uint16x8_t b0 = vld1q_u16(b + 2 * x);
+			uint16x8_t b1 = vld1q_u16(b + 2 * x + 8);
+			uint16x8_t mask5 = vdupq_n_u16(0x1f);
+			uint16x8_t mask6 = vdupq_n_u16(0x3f);
+			uint16x8_t vr, vg, vb;
+
+			vr = vaddq_u16(exynos_scale_pairs_u16(vshrq_n_u16(a0, 11), vshrq_n_u16(a1, 11)),
+				exynos_scale_pairs_u16(vshrq_n_u16(b0, 11), vshrq_n_u16(b1, 11)));
+			vg = vaddq_u16(exynos_scale_pairs_u16(vandq_u16(vshrq_n_u16(a0, 5), mask6), vandq_u16(vshrq_n_u16(a1, 5), mask6)),
+				exynos_scale_pairs_u16(vandq_u16(vshrq_n_u16(b0, 5), mask6), vandq_u16(vshrq_n_u16(b1, 5), mask6)));
+			vb = vaddq_u16(exynos_scale_pairs_u16(vandq_u16(a0, mask5), vandq_u16(a1, mask5)),
+				exynos_scale_pairs_u16(vandq_u16(b0, mask5), vandq_u16(b1, mask5)));
+
+			vr = vshlq_n_u16(vrshrq_n_u16(vr, 2), 11);
+			vg = vshlq_n_u16(vrshrq_n_u16(vg, 2), 5);
+			vb = vrshrq_n_u16(vb, 2);
+
+			vst1q_u16(d + x, vorrq_u16(vorrq_u16(vr, vg), vb));
+		}
+#endif
+
+		for (; x < dst_width; x++) {
+			r = g = bl = 0;
+
+			for (k = 0; k < 4; k++) {
+				p = k < 2 ? a[2 * x + k] : b[2 * x + k - 2];
+				r += p >> 11;
+				g += (p >> 5) & 0x3f;
+				bl += p & 0x1f;
+			}
+
+			d[x] = (((r + 2) >> 2) << 11) | (((g + 2) >> 2) << 5) | ((bl + 2) >> 2);
+		}
+	}
+}
+
+static void exynos_scale_half(int format, void *src, int width, int height, void *dst)
+{
+	switch (format) {
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+			exynos_scale_half_nv((unsigned char *) src, width, height, (unsigned char *) dst);
+			break;
+		case V4L2_PIX_FMT_YUYV:
+			exynos_scale_half_yuyv((unsigned char *) src, width, height, (unsigned char *) dst, 0);
+			break;
+		case V4L2_PIX_FMT_UYVY:
+			exynos_scale_half_yuyv((unsigned char *) src, width, height, (unsigned char *) dst, 1);
+			break;
+		case V4L2_PIX_FMT_RGB565:
+			exynos_scale_half_rgb565((unsigned short *) src, width, height, (unsigned short *) dst);
+			break;
+	}
+}
+
+static void exynos_scale_nearest(int format, void *src, int width, int height,
+	void *dst, int dst_width, int dst_height)
+{
+	unsigned char *s, *d;
+	unsigned short *s16, *d16;
+	int y_offset;
+	int x, y, k;
+	int sx, sy;
+
+	switch (format) {
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV21:
+			s = (unsigned char *) src;
+			d = (unsigned char *) dst;
+
+			for (y = 0; y < dst_height; y++) {
+				sy = y * height / dst_height;
+				for (x = 0; x < dst_width; x++)
+					d[y * dst_width + x] = s[sy * width + x * width / dst_width];
+			}
+
+			s += width * height;
+			d += dst_width * dst_height;
+
+			for (y = 0; y < dst_height / 2; y++) {
+				sy = y * (height / 2) / (dst_height / 2);
+				for (x = 0; x < dst_width / 2; x++) {
+					sx = x * (width / 2) / (dst_width / 2);
+					d[y * dst_width + 2 * x] = s[sy * width + 2 * sx];
+					d[y * dst_width + 2 * x + 1] = s[sy * width + 2 * sx + 1];
+				}
+			}
+			break;
+		case V4L2_PIX_FMT_YUYV:
+		case V4L2_PIX_FMT_UYVY:
+			s = (unsigned char *) src;
+			d = (unsigned char *) dst;
+			y_offset = format == V4L2_PIX_FMT_UYVY ? 1 : 0;
+
+			for (y = 0; y < dst_height; y++) {
+				sy = y * height / dst_height;
+				for (x = 0; x < dst_width / 2; x++) {
+					sx = x * (width / 2) / (dst_width / 2);
+
+					// Luma from the matching pixels, chroma from the matching macropixel
+					for (k = 0; k < 2; k++) {
+						int px = (2 * x + k) * width / dst_width;
+						d[(y * dst_width + 2 * x) * 2 + y_offset + 2 * k] =
+							s[(sy * width + (px & ~1)) * 2 + y_offset + 2 * (px & 1)];
+					}
+
+					d[(y * dst_width + 2 * x) * 2 + 1 - y_offset] = s[(sy * width + 2 * sx) * 2 + 1 - y_offset];
+					d[(y * dst_width + 2 * x) * 2 + 3 - y_offset] = s[(sy * width + 2 * sx) * 2 + 3 - y_offset];
+				}
+			}
+			break;
+		case V4L2_PIX_FMT_RGB565:
+			s16 = (unsigned short *) src;
+			d16 = (unsigned short *) dst;
+
+			for (y = 0; y < dst_height; y++) {
+				sy = y * height / dst_height;
+				for (x = 0; x < dst_width; x++)
+					d16[y * dst_width + x] = s16[sy * width + x * width / dst_width];
+			}
+			break;
+	}
+}
+
+int exynos_scale(int format, void *src, int width, int height,
+	void *dst, int dst_width, int dst_height)
+{
+	void *buffers[2] = { NULL, NULL };
+	void *data;
+	void *out;
+	int size;
+	int i;
+
+	if (src == NULL || dst == NULL || width <= 0 || height <= 0 ||
+		dst_width <= 0 || dst_height <= 0 || dst_width > width || dst_height > height)
+		return -EINVAL;
+
+	size = exynos_scale_frame_size(format, width, height);
+	if (size < 0) {
+		ALOGE("%s: Unsupported format: 0x%x", __func__, format);
+		return -1;
+	}
+
+	// Chroma is subsampled horizontally (and vertically for NV)
+	if (format != V4L2_PIX_FMT_RGB565 && ((dst_width % 2) != 0 ||
+		((format == V4L2_PIX_FMT_NV12 || format == V4L2_PIX_FMT_NV21) && (dst_height % 2) != 0)))
+		return -EINVAL;
+
+	data = src;
+	i = 0;
+
+	while (width / 2 >= dst_width && height / 2 >= dst_height &&
+		exynos_scale_half_aligned(format, width, height)) {
+		if (width / 2 == dst_width && height / 2 == dst_height) {
+			out = dst;
+		} else {
+			// Ping-pong between two buffers, each pass is smaller than the last
+			if (buffers[i] == NULL) {
+				buffers[i] = malloc(exynos_scale_frame_size(format, width / 2, height / 2));
+				if (buffers[i] == NULL) {
+					ALOGE("%s: Unable to allocate scale buffer", __func__);
+					goto error;
+				}
+			}
+
+			out = buffers[i];
+			i = 1 - i;
+		}
+
+		exynos_scale_half(format, data, width, height, out);
+
+		data = out;
+		width /= 2;
+		height /= 2;
+	}
+
+	if (data != dst) {
+		if (width == dst_width && height == dst_height)
+			memcpy(dst, data, exynos_scale_frame_size(format, width, height));
+		else
+			exynos_scale_nearest(format, data, width, height, dst, dst_width, dst_height);
+	}
+
+	for (i = 0; i < 2; i++)
+		if (buffers[i] != NULL)
+			free(buffers[i]);
+
+	return 0;
+
+error:
+	for (i = 0; i < 2; i++)
+		if (buffers[i] != NULL)
+			free(buffers[i]);
+
+	return -1;
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2013 Paul Kocialkowski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define LOG_TAG "exynos_stats"
+#include <utils/Log.h>
+#include <utils/Timers.h>
+
+#include "exynos_camera.h"
+
+/*
+ * Each value is only written by the thread that measures it, the dump may
+ * read it while it changes, which is fine for statistics.
+ */
+
+static const char *exynos_stats_keys[EXYNOS_STATS_KEYS_COUNT] = {
+	[EXYNOS_STATS_PREVIEW_POLL] = "preview-poll",
+	[EXYNOS_STATS_PREVIEW_DQBUF] = "preview-dqbuf",
+	[EXYNOS_STATS_PREVIEW_WINDOW_DEQUEUE] = "preview-window-dequeue",
+	[EXYNOS_STATS_PREVIEW_WINDOW_LOCK] = "preview-window-lock",
+	[EXYNOS_STATS_PREVIEW_COPY] = "preview-copy",
+	[EXYNOS_STATS_PREVIEW_WINDOW_ENQUEUE] = "preview-window-enqueue",
+	[EXYNOS_STATS_PREVIEW_CONVERT] = "preview-convert",
+	[EXYNOS_STATS_PREVIEW_CALLBACK] = "preview-callback",
+	[EXYNOS_STATS_PREVIEW_SETTINGS] = "preview-settings",
+	[EXYNOS_STATS_PREVIEW_INTERVAL] = "preview-interval",
+	[EXYNOS_STATS_PREVIEW_LATENCY] = "preview-latency",
+	[EXYNOS_STATS_PREVIEW_JITTER] = "preview-jitter",
+	[EXYNOS_STATS_RECORDING_POLL] = "recording-poll",
+	[EXYNOS_STATS_RECORDING_DQBUF] = "recording-dqbuf",
+	[EXYNOS_STATS_RECORDING_CALLBACK] = "recording-callback",
+	[EXYNOS_STATS_RECORDING_INTERVAL] = "recording-interval",
+	[EXYNOS_STATS_RECORDING_LATENCY] = "recording-latency",
+	[EXYNOS_STATS_RECORDING_JITTER] = "recording-jitter",
+	[EXYNOS_STATS_AUTO_FOCUS] = "auto-focus",
+	[EXYNOS_STATS_SHUTTER_TO_JPEG] = "shutter-to-jpeg",
+	[EXYNOS_STATS_OPEN_TO_PREVIEW] = "open-to-preview",
+};
+
+static const char *exynos_stats_counters[EXYNOS_STATS_COUNTERS_COUNT] = {
+	[EXYNOS_STATS_PREVIEW_FRAMES] = "preview-frames",
+	[EXYNOS_STATS_PREVIEW_DROPPED] = "preview-dropped",
+	[EXYNOS_STATS_PREVIEW_TIMEOUTS] = "preview-timeouts",
+	[EXYNOS_STATS_PREVIEW_CALLBACK_SKIPPED] = "preview-callback-skipped",
+	[EXYNOS_STATS_RECORDING_FRAMES] = "recording-frames",
+	[EXYNOS_STATS_RECORDING_DROPPED] = "recording-dropped",
+	[EXYNOS_STATS_RECORDING_TIMEOUTS] = "recording-timeouts",
+	[EXYNOS_STATS_PICTURES] = "pictures",
+};
+
+// Upper bounds of the histogram buckets, in us, the last one has none
+static const int exynos_stats_buckets[EXYNOS_STATS_BUCKETS_COUNT - 1] = {
+	500, 1000, 2000, 4000, 8000, 16000, 33000, 66000, 133000,
+};
+
+void exynos_stats_reset(struct exynos_camera *exynos_camera)
+{
+	if (exynos_camera == NULL)
+		return;
+
+	memset(&exynos_camera->stats, 0, sizeof(struct exynos_stats));
+	exynos_camera->stats.start_time = systemTime(SYSTEM_TIME_MONOTONIC);
+}
+
+void exynos_stats_add(struct exynos_camera *exynos_camera, enum exynos_stats_key key,
+	int64_t duration)
+{
+	struct exynos_stats_histogram *histogram;
+	int64_t us;
+	int i;
+
+	if (exynos_camera == NULL || key >= EXYNOS_STATS_KEYS_COUNT || duration < 0)
+		return;
+
+	histogram = &exynos_camera->stats.histograms[key];
+
+	if (histogram->count == 0 || duration < histogram->min)
+		histogram->min = duration;
+	if (duration > histogram->max)
+		histogram->max = duration;
+
+	histogram->total += duration;
+	histogram->count++;
+
+	us = duration / 1000;
+	for (i = 0; i < EXYNOS_STATS_BUCKETS_COUNT - 1; i++)
+		if (us < exynos_stats_buckets[i])
+			break;
+
+	histogram->buckets[i]++;
+}
+
+// Adds the time elapsed since start and returns the current time
+int64_t exynos_stats_add_since(struct exynos_camera *exynos_camera,
+	enum exynos_stats_key key, int64_t start)
+{
+	int64_t now;
+
+	now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+	if (start > 0)
+		exynos_stats_add(exynos_camera, key, now - start);
+
+	return now;
+}
+
+void exynos_stats_count(struct exynos_camera *exynos_camera, enum exynos_stats_counter counter)
+{
+	if (exynos_camera == NULL || counter >= EXYNOS_STATS_COUNTERS_COUNT)
+		return;
+
+	exynos_camera->stats.counters[counter]++;
+}
+
+/*
+ * Adds the capture to dequeue latency of a frame and how much its capture
+ * interval differs from the previous one.
+ */
+void exynos_stats_timestamp(struct exynos_camera *exynos_camera,
+	enum exynos_stats_key latency_key, enum exynos_stats_key jitter_key,
+	int64_t timestamp, int64_t *last_timestamp, int64_t *last_interval)
+{
+	int64_t interval;
+	int64_t jitter;
+
+	if (exynos_camera == NULL || last_timestamp == NULL || last_interval == NULL || timestamp <= 0)
+		return;
+
+	exynos_stats_add_since(exynos_camera, latency_key, timestamp);
+
+	if (*last_timestamp > 0 && timestamp > *last_timestamp) {
+		interval = timestamp - *last_timestamp;
+
+		if (*last_interval > 0) {
+			jitter = interval - *last_interval;
+			exynos_stats_add(exynos_camera, jitter_key, jitter < 0 ? -jitter : jitter);
+		}
+
+		*last_interval = interval;
+	}
+
+	*last_timestamp = timestamp;
+}
+
+static void exynos_stats_write(int fd, const char *format, ...)
+{
+	char buffer[256];
+	va_list ap;
+	int length;
+
+	va_start(ap, format);
+	length = vsnprintf(buffer, sizeof(buffer), format, ap);
+	va_end(ap);
+
+	if (length <= 0)
+		return;
+
+	if (length >= (int) sizeof(buffer))
+		length = sizeof(buffer) - 1;
+
+	write(fd, buffer, length);
+}
+
+int exynos_stats_dump(struct exynos_camera *exynos_camera, int fd)
+{
+	struct exynos_stats_histogram *histogram;
+	int64_t elapsed;
+	int i, j;
+
+	if (exynos_camera == NULL || fd < 0)
+		return -EINVAL;
+
+	elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - exynos_camera->stats.start_time;
+
+	exynos_stats_write(fd, "Exynos camera %d stats over %lld ms\n", exynos_camera->id,
+		(long long) ns2ms(elapsed));
+
+	for (i = 0; i < EXYNOS_STATS_COUNTERS_COUNT; i++)
+		exynos_stats_write(fd, "  %s: %lld\n", exynos_stats_counters[i],
+			(long long) exynos_camera->stats.counters[i]);
+
+	exynos_stats_write(fd, "  recording-release-dropped: %d\n",
+		exynos_camera->recording_release_dropped);
+	exynos_stats_write(fd, "  recording-release-late: %d\n",
+		exynos_camera->recording_release_late);
+
+	exynos_stats_write(fd, "  memory-pool: %d bytes (%d idle, %d at most), %d hits, %d misses, %d evictions\n",
+		exynos_camera->memory_pool.bytes, exynos_camera->memory_pool.bytes_idle,
+		exynos_camera->memory_pool.bytes_max, exynos_camera->memory_pool.hits,
+		exynos_camera->memory_pool.misses, exynos_camera->memory_pool.evictions);
+
+	exynos_stats_write(fd, "  Latencies in us (count, avg, min, max), buckets up to");
+	for (i = 0; i < EXYNOS_STATS_BUCKETS_COUNT - 1; i++)
+		exynos_stats_write(fd, " %d", exynos_stats_buckets[i]);
+	exynos_stats_write(fd, " and above\n");
+
+	for (i = 0; i < EXYNOS_STATS_KEYS_COUNT; i++) {
+		histogram = &exynos_camera->stats.histograms[i];
+		if (histogram->count == 0)
+			continue;
+
+		exynos_stats_write(fd, "  %s: %lld, %lld, %lld, %lld |", exynos_stats_keys[i],
+			(long long) histogram->count,
+			(long long) (histogram->total / histogram->count / 1000),
+			(long long) (histogram->min / 1000), (long long) (histogram->max / 1000));
+
+		for (j = 0; j < EXYNOS_STATS_BUCKETS_COUNT; j++)
+			exynos_stats_write(fd, " %lld", (long long) histogram->buckets[j]);
+
+		exynos_stats_write(fd, "\n");
+	}
+
+	return 0;
+}
@@ -24,6 +24,8 @@
 #include <errno.h>
 #include <malloc.h>
 #include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
@@ -34,6 +36,7 @@
 
 #define LOG_TAG "exynos_v4l2"
 #include <utils/Log.h>
+#include <utils/Timers.h>
 
 #include "exynos_camera.h"
 
@@ -82,8 +85,63 @@ int exynos_v4l2_find_fd(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
  * File ops
  */
 
+#ifndef EXYNOS_CAMERA_FAKE_V4L2
+static int exynos_v4l2_device_open(int exynos_v4l2_id, const char *node)
+{
+	return open(node, O_RDWR);
+}
+
+static void exynos_v4l2_device_close(int fd)
+{
+	close(fd);
+}
+
+static int exynos_v4l2_device_ioctl(int fd, int request, void *data)
+{
+	return ioctl(fd, request, data);
+}
+
+static struct exynos_v4l2_ops exynos_v4l2_device_ops = {
+	.open = exynos_v4l2_device_open,
+	.close = exynos_v4l2_device_close,
+	.ioctl = exynos_v4l2_device_ioctl,
+	.mmap_fd = NULL,
+};
+#endif
+
+static struct exynos_v4l2_ops *exynos_v4l2_ops_get(struct exynos_camera *exynos_camera)
+{
+	if (exynos_camera->v4l2_ops != NULL)
+		return exynos_camera->v4l2_ops;
+
+#ifdef EXYNOS_CAMERA_FAKE_V4L2
+	exynos_camera->v4l2_ops = &exynos_v4l2_fake_ops;
+#else
+	exynos_camera->v4l2_ops = &exynos_v4l2_device_ops;
+#endif
+
+	return exynos_camera->v4l2_ops;
+}
+
+int exynos_v4l2_find_mmap_fd(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
+{
+	struct exynos_v4l2_ops *ops;
+	int fd;
+
+	fd = exynos_v4l2_find_fd(exynos_camera, exynos_v4l2_id);
+	if (fd < 0)
+		return -1;
+
+	ops = exynos_v4l2_ops_get(exynos_camera);
+	if (ops->mmap_fd != NULL)
+		return ops->mmap_fd(fd);
+
+	return fd;
+}
+
 int exynos_v4l2_open(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
 {
+	struct exynos_v4l2_ops *ops;
 	char *node;
 	int index;
 	int fd;
@@ -98,8 +156,10 @@ int exynos_v4l2_open(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
 		return -1;
 	}
 
+	ops = exynos_v4l2_ops_get(exynos_camera);
+
 	node = exynos_camera->config->v4l2_nodes[index].node;
-	fd = open(node, O_RDWR);
+	fd = ops->open(exynos_v4l2_id, node);
 	if (fd < 0) {
 		ALOGE("%s: Unable to open v4l2 node #%d", __func__, exynos_v4l2_id);
 		return -1;
@@ -125,7 +185,7 @@ void exynos_v4l2_close(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
 	}
 
 	if (exynos_camera->v4l2_fds[index] > 0)
-		close(exynos_camera->v4l2_fds[index]);
+		exynos_v4l2_ops_get(exynos_camera)->close(exynos_camera->v4l2_fds[index]);
 
 	exynos_camera->v4l2_fds[index] = -1;
 }
@@ -144,7 +204,7 @@ int exynos_v4l2_ioctl(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 		return -1;
 	}
 
-	return ioctl(fd, request, data);
+	return exynos_v4l2_ops_get(exynos_camera)->ioctl(fd, request, data);
 }
 
 int exynos_v4l2_poll(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
@@ -175,6 +235,179 @@ int exynos_v4l2_poll(struct exynos_camera *exynos_camera, int exynos_v4l2_id)
 	return rc;
 }
 
+/*
+ * Events
+ */
+
+int exynos_v4l2_events_init(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events)
+{
+	struct epoll_event event;
+	int rc;
+
+	if (exynos_camera == NULL || events == NULL)
+		return -EINVAL;
+
+	memset(events, 0, sizeof(struct exynos_v4l2_events));
+	events->epoll_fd = -1;
+	events->wakeup_fd = -1;
+
+	events->epoll_fd = epoll_create(EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT + 1);
+	if (events->epoll_fd < 0) {
+		ALOGE("%s: Unable to create epoll fd", __func__);
+		goto error;
+	}
+
+	events->wakeup_fd = eventfd(0, 0);
+	if (events->wakeup_fd < 0) {
+		ALOGE("%s: Unable to create wakeup fd", __func__);
+		goto error;
+	}
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = EXYNOS_V4L2_EVENTS_WAKEUP;
+
+	rc = epoll_ctl(events->epoll_fd, EPOLL_CTL_ADD, events->wakeup_fd, &event);
+	if (rc < 0) {
+		ALOGE("%s: Unable to add wakeup fd", __func__);
+		goto error;
+	}
+
+	return 0;
+
+error:
+	exynos_v4l2_events_deinit(exynos_camera, events);
+
+	return -1;
+}
+
+void exynos_v4l2_events_deinit(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events)
+{
+	if (exynos_camera == NULL || events == NULL)
+		return;
+
+	if (events->wakeup_fd > 0)
+		close(events->wakeup_fd);
+
+	if (events->epoll_fd > 0)
+		close(events->epoll_fd);
+
+	events->wakeup_fd = -1;
+	events->epoll_fd = -1;
+	events->nodes_count = 0;
+}
+
+int exynos_v4l2_events_register(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events, int exynos_v4l2_id,
+	int (*ready)(struct exynos_camera *exynos_camera, int exynos_v4l2_id))
+{
+	struct epoll_event event;
+	int index;
+	int fd;
+	int rc;
+
+	if (exynos_camera == NULL || events == NULL || ready == NULL)
+		return -EINVAL;
+
+	if (events->nodes_count >= EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT)
+		return -1;
+
+	fd = exynos_v4l2_find_fd(exynos_camera, exynos_v4l2_id);
+	if (fd < 0) {
+		ALOGE("%s: Unable to find v4l2 fd #%d", __func__, exynos_v4l2_id);
+		return -1;
+	}
+
+	index = events->nodes_count;
+
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLERR;
+	event.data.u32 = index;
+
+	rc = epoll_ctl(events->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+	if (rc < 0) {
+		ALOGE("%s: Unable to add v4l2 fd #%d", __func__, exynos_v4l2_id);
+		return -1;
+	}
+
+	events->nodes[index].id = exynos_v4l2_id;
+	events->nodes[index].fd = fd;
+	events->nodes[index].ready = ready;
+	events->nodes_count++;
+
+	return 0;
+}
+
+int exynos_v4l2_events_wakeup(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events)
+{
+	uint64_t value = 1;
+	int rc;
+
+	if (exynos_camera == NULL || events == NULL || events->wakeup_fd <= 0)
+		return -EINVAL;
+
+	rc = write(events->wakeup_fd, &value, sizeof(value));
+	if (rc < (int) sizeof(value)) {
+		ALOGE("%s: Unable to write wakeup fd", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+int exynos_v4l2_events_wait(struct exynos_camera *exynos_camera,
+	struct exynos_v4l2_events *events, int timeout)
+{
+	struct epoll_event ready_events[EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT + 1];
+	struct exynos_v4l2_events_node *node;
+	uint64_t value;
+	unsigned int index;
+	int count;
+	int rc;
+	int i;
+
+	if (exynos_camera == NULL || events == NULL || events->epoll_fd <= 0)
+		return -EINVAL;
+
+	do {
+		count = epoll_wait(events->epoll_fd, ready_events,
+			EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT + 1, timeout);
+	} while (count < 0 && errno == EINTR);
+
+	if (count < 0) {
+		ALOGE("%s: epoll wait failed", __func__);
+		return -1;
+	}
+
+	for (i = 0; i < count; i++) {
+		index = ready_events[i].data.u32;
+
+		if (index == EXYNOS_V4L2_EVENTS_WAKEUP) {
+			read(events->wakeup_fd, &value, sizeof(value));
+			continue;
+		}
+
+		if (index >= (unsigned int) events->nodes_count)
+			continue;
+
+		node = &events->nodes[index];
+
+		if (ready_events[i].events & EPOLLERR) {
+			ALOGE("%s: poll failed on v4l2 node #%d", __func__, node->id);
+			return -1;
+		}
+
+		rc = node->ready(exynos_camera, node->id);
+		if (rc < 0)
+			return -1;
+	}
+
+	return count;
+}
+
 /*
  * VIDIOC
  */
@@ -215,6 +448,41 @@ int exynos_v4l2_qbuf_out(struct exynos_camera *exynos_camera, int exynos_v4l2_id
 		V4L2_MEMORY_USERPTR, index);
 }
 
+/*
+ * FIMC stamps buffers with gettimeofday when the frame is done, that time is
+ * moved to the systemTime clock. Returns 0 when it can't be trusted.
+ */
+static int64_t exynos_v4l2_timestamp(struct v4l2_buffer *buffer)
+{
+	struct timeval now_tv;
+	int64_t timestamp;
+	int64_t now;
+
+	if (buffer == NULL || (buffer->timestamp.tv_sec == 0 && buffer->timestamp.tv_usec == 0))
+		return 0;
+
+	timestamp = (int64_t) buffer->timestamp.tv_sec * 1000000000LL +
+		(int64_t) buffer->timestamp.tv_usec * 1000LL;
+
+	now = systemTime(SYSTEM_TIME_MONOTONIC);
+
+#ifdef V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
+	if ((buffer->flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) != V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+#endif
+		gettimeofday(&now_tv, NULL);
+		timestamp -= (int64_t) now_tv.tv_sec * 1000000000LL +
+			(int64_t) now_tv.tv_usec * 1000LL - now;
+#ifdef V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC
+	}
+#endif
+
+	// The wall clock may have been set in between
+	if (timestamp > now || now - timestamp > 1000000000LL)
+		return 0;
+
+	return timestamp;
+}
+
 int exynos_v4l2_dqbuf(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	int type, int memory)
 {
@@ -234,6 +502,9 @@ int exynos_v4l2_dqbuf(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 		return -1;
 	}
 
+	if (exynos_v4l2_id >= 0 && exynos_v4l2_id < EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT)
+		exynos_camera->v4l2_timestamps[exynos_v4l2_id] = exynos_v4l2_timestamp(&buffer);
+
 	return buffer.index;
 }
 
@@ -286,7 +557,7 @@ int exynos_v4l2_reqbufs_out(struct exynos_camera *exynos_camera, int exynos_v4l2
 }
 
 int exynos_v4l2_querybuf(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
-	int type, int memory, int index)
+	int type, int memory, int index, unsigned int *offset)
 {
 	struct v4l2_buffer buffer;
 	int rc;
@@ -305,21 +576,24 @@ int exynos_v4l2_querybuf(struct exynos_camera *exynos_camera, int exynos_v4l2_id
 		return -1;
 	}
 
+	if (offset != NULL)
+		*offset = buffer.m.offset;
+
 	return buffer.length;
 }
 
 int exynos_v4l2_querybuf_cap(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
-	int index)
+	int index, unsigned int *offset)
 {
 	return exynos_v4l2_querybuf(exynos_camera, exynos_v4l2_id, V4L2_BUF_TYPE_VIDEO_CAPTURE,
-		V4L2_MEMORY_MMAP, index);
+		V4L2_MEMORY_MMAP, index, offset);
 }
 
 int exynos_v4l2_querybuf_out(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	int index)
 {
 	return exynos_v4l2_querybuf(exynos_camera, exynos_v4l2_id, V4L2_BUF_TYPE_VIDEO_OUTPUT,
-		V4L2_MEMORY_USERPTR, index);
+		V4L2_MEMORY_USERPTR, index, NULL);
 }
 
 int exynos_v4l2_querycap(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
@@ -629,6 +903,31 @@ int exynos_v4l2_g_ext_ctrls(struct exynos_camera *exynos_camera, int exynos_v4l2
 	return 0;
 }
 
+int exynos_v4l2_s_ext_ctrls(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
+	struct v4l2_ext_control *control, int count)
+{
+	struct v4l2_ext_controls controls;
+	int rc;
+
+	if (exynos_camera == NULL || control == NULL)
+		return -EINVAL;
+
+	// All the controls must belong to that class
+	memset(&controls, 0, sizeof(controls));
+	controls.ctrl_class = V4L2_CTRL_ID2CLASS(control[0].id);
+	controls.count = count;
+	controls.controls = control;
+
+	rc = exynos_v4l2_ioctl(exynos_camera, exynos_v4l2_id, VIDIOC_S_EXT_CTRLS, &controls);
+	if (rc < 0) {
+		rc = errno > 0 ? -errno : -1;
+		ALOGE("%s: ioctl failed", __func__);
+		return rc;
+	}
+
+	return 0;
+}
+
 int exynos_v4l2_g_ctrl(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 	int id, int *value)
 {
@@ -794,3 +1093,201 @@ int exynos_v4l2_s_fbuf(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
 
 	return 0;
 }
+
+/*
+ * Buffers
+ */
+
+static struct exynos_v4l2_buffers *exynos_v4l2_buffers_find(struct exynos_camera *exynos_camera,
+	int exynos_v4l2_id, int type, int memory, int width, int height, int fmt)
+{
+	struct exynos_v4l2_buffers *buffers;
+	int i;
+
+	for (i = 0; i < EXYNOS_V4L2_BUFFERS_CACHE_SIZE; i++) {
+		buffers = &exynos_camera->v4l2_buffers[i];
+
+		if (buffers->count > 0 && buffers->exynos_v4l2_id == exynos_v4l2_id &&
+			buffers->type == type && buffers->memory == memory &&
+			buffers->width == width && buffers->height == height &&
+			buffers->fmt == fmt)
+			return buffers;
+	}
+
+	return NULL;
+}
+
+/*
+ * The buffers count accepted by the driver is looked for from the maximum
+ * down, then kept for that node and format so that it is only asked once.
+ */
+
+int exynos_v4l2_reqbufs_negotiate(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
+	int type, int memory, int width, int height, int fmt)
+{
+	struct exynos_v4l2_buffers *buffers;
+	int rc;
+	int i;
+
+	if (exynos_camera == NULL)
+		return -EINVAL;
+
+	buffers = exynos_v4l2_buffers_find(exynos_camera, exynos_v4l2_id, type, memory,
+		width, height, fmt);
+	if (buffers != NULL) {
+		rc = exynos_v4l2_reqbufs(exynos_camera, exynos_v4l2_id, type, memory, buffers->count);
+		if (rc >= EXYNOS_CAMERA_MIN_BUFFERS_COUNT)
+			return rc;
+
+		memset(buffers, 0, sizeof(struct exynos_v4l2_buffers));
+	}
+
+	rc = -1;
+	for (i = EXYNOS_CAMERA_MAX_BUFFERS_COUNT; i >= EXYNOS_CAMERA_MIN_BUFFERS_COUNT; i--) {
+		rc = exynos_v4l2_reqbufs(exynos_camera, exynos_v4l2_id, type, memory, i);
+		if (rc >= 0)
+			break;
+	}
+
+	if (rc < EXYNOS_CAMERA_MIN_BUFFERS_COUNT)
+		return rc < 0 ? rc : -1;
+
+	buffers = &exynos_camera->v4l2_buffers[exynos_camera->v4l2_buffers_next];
+	exynos_camera->v4l2_buffers_next = (exynos_camera->v4l2_buffers_next + 1) % EXYNOS_V4L2_BUFFERS_CACHE_SIZE;
+
+	memset(buffers, 0, sizeof(struct exynos_v4l2_buffers));
+	buffers->exynos_v4l2_id = exynos_v4l2_id;
+	buffers->type = type;
+	buffers->memory = memory;
+	buffers->width = width;
+	buffers->height = height;
+	buffers->fmt = fmt;
+	buffers->count = rc;
+
+	return rc;
+}
+
+// Returns the smallest buffer length, only queried once per negotiated format
+int exynos_v4l2_querybuf_negotiate(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
+	int type, int memory, int width, int height, int fmt, int count)
+{
+	struct exynos_v4l2_buffers *buffers;
+	int length = -1;
+	int rc;
+	int i;
+
+	if (exynos_camera == NULL || count <= 0)
+		return -EINVAL;
+
+	buffers = exynos_v4l2_buffers_find(exynos_camera, exynos_v4l2_id, type, memory,
+		width, height, fmt);
+	if (buffers != NULL && buffers->count == count && buffers->length > 0)
+		return buffers->length;
+
+	for (i = 0; i < count; i++) {
+		rc = exynos_v4l2_querybuf(exynos_camera, exynos_v4l2_id, type, memory, i, NULL);
+		if (rc < 0)
+			return -1;
+
+		if (length < 0 || rc < length)
+			length = rc;
+	}
+
+	if (buffers != NULL && buffers->count == count)
+		buffers->length = length;
+
+	return length;
+}
+
+/*
+ * Deferred controls
+ */
+
+int exynos_v4l2_ctrls_defer(struct exynos_v4l2_deferred_ctrls *ctrls, int id, int value)
+{
+	struct v4l2_ext_control *control;
+
+	if (ctrls == NULL)
+		return -EINVAL;
+
+	if (ctrls->count >= EXYNOS_V4L2_DEFERRED_CTRLS_MAX)
+		return -1;
+
+	control = &ctrls->controls[ctrls->count];
+
+	memset(control, 0, sizeof(struct v4l2_ext_control));
+	control->id = id;
+	control->value = value;
+
+	ctrls->count++;
+
+	return 0;
+}
+
+/*
+ * Deferred controls are flushed in the order they were queued. Runs of
+ * consecutive controls of the same class share an S_EXT_CTRLS, but the
+ * kernel rejects private controls (V4L2_CID_PRIVATE_BASE) there, and every
+ * Samsung V4L2_CID_CAMERA_* control as well as V4L2_CID_ROTATION is private:
+ * only HFLIP and VFLIP end up sharing an ioctl, the rest is sent with S_CTRL.
+ */
+
+int exynos_v4l2_ctrls_flush(struct exynos_camera *exynos_camera, int exynos_v4l2_id,
+	struct exynos_v4l2_deferred_ctrls *ctrls)
+{
+	unsigned int class;
+	int failed = 0;
+	int count;
+	int index;
+	int rc;
+	int i, j;
+
+	if (exynos_camera == NULL || ctrls == NULL)
+		return -EINVAL;
+
+	if (ctrls->count == 0)
+		return 0;
+
+	index = exynos_v4l2_find_index(exynos_camera, exynos_v4l2_id);
+	if (index < 0) {
+		ALOGE("%s: Unable to find v4l2 node #%d", __func__, exynos_v4l2_id);
+		ctrls->count = 0;
+		return -1;
+	}
+
+	for (i = 0; i < ctrls->count; i += count) {
+		class = V4L2_CTRL_ID2CLASS(ctrls->controls[i].id);
+
+		count = 1;
+		while (i + count < ctrls->count &&
+			V4L2_CTRL_ID2CLASS(ctrls->controls[i + count].id) == class)
+			count++;
+
+		if (count > 1 && class != V4L2_CTRL_ID2CLASS(V4L2_CID_PRIVATE_BASE) &&
+			!exynos_camera->v4l2_ext_ctrls_unsupported[index]) {
+			rc = exynos_v4l2_s_ext_ctrls(exynos_camera, exynos_v4l2_id,
+				&ctrls->controls[i], count);
+			if (rc >= 0)
+				continue;
+
+			if (rc == -ENOTTY) {
+				ALOGD("%s: Using single controls for v4l2 node #%d", __func__, exynos_v4l2_id);
+				exynos_camera->v4l2_ext_ctrls_unsupported[index] = 1;
+			}
+		}
+
+		// Controls already applied by a partial S_EXT_CTRLS are harmless to set again
+		for (j = i; j < i + count; j++) {
+			rc = exynos_v4l2_s_ctrl(exynos_camera, exynos_v4l2_id,
+				ctrls->controls[j].id, ctrls->controls[j].value);
+			if (rc < 0) {
+				ALOGE("%s: s ctrl failed for 0x%x", __func__, ctrls->controls[j].id);
+				failed = 1;
+			}
+		}
+	}
+
+	ctrls->count = 0;
+
+	return failed ? -1 : 0;
+}
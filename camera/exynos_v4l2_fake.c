@@ -0,0 +1,734 @@
+/*
+ * Copyright (C) 2013 Paul Kocialkowski
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#include <asm/types.h>
+
+#define LOG_TAG "exynos_v4l2_fake"
+#include <utils/Log.h>
+#include <cutils/ashmem.h>
+#include <cutils/properties.h>
+
+#include "exynos_camera.h"
+
+/*
+ * In-process stand-in for the FIMC nodes and the M5MO ISP, so that the HAL
+ * can run without the hardware. Each node is an eventfd that becomes
+ * readable when a frame is done, buffers are backed by ashmem.
+ *
+ * Tunables:
+ * debug.camera.fake.fps: frame rate when the HAL does not set one (30)
+ * debug.camera.fake.af: auto-focus results returned after each trigger,
+ *   the last one sticks (1,1,1,2: in progress three times, then success)
+ * debug.camera.fake.jpeg: main JPEG size in bytes (main size / 8)
+ */
+
+#define EXYNOS_V4L2_FAKE_BUFFERS_MAX	8
+#define EXYNOS_V4L2_FAKE_AF_MAX		16
+#define EXYNOS_V4L2_FAKE_CTRLS_MAX	64
+#define EXYNOS_V4L2_FAKE_PADDR_BASE	0x40000000
+
+struct exynos_v4l2_fake_ctrl {
+	int id;
+	int value;
+};
+
+struct exynos_v4l2_fake_node {
+	int exynos_v4l2_id;
+	int fd;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	int streaming;
+
+	int width;
+	int height;
+	int fmt;
+	int fps;
+
+	int memory;
+	int count;
+	int length;
+	int mmap_fd;
+	void *mmap_data;
+	int mmap_size;
+	unsigned int mmap_offset;
+	void *userptrs[EXYNOS_V4L2_FAKE_BUFFERS_MAX];
+
+	int queued[EXYNOS_V4L2_FAKE_BUFFERS_MAX];
+	int queued_count;
+	int done[EXYNOS_V4L2_FAKE_BUFFERS_MAX];
+	int done_count;
+	struct timeval timestamps[EXYNOS_V4L2_FAKE_BUFFERS_MAX];
+	unsigned int sequence;
+
+	int jpeg_main_size;
+	int jpeg_main_offset;
+	int jpeg_thumb_size;
+	int jpeg_thumb_offset;
+
+	int af_results[EXYNOS_V4L2_FAKE_AF_MAX];
+	int af_results_count;
+	int af_index;
+
+	struct exynos_v4l2_fake_ctrl ctrls[EXYNOS_V4L2_FAKE_CTRLS_MAX];
+	int ctrls_count;
+};
+
+static struct exynos_v4l2_fake_node exynos_v4l2_fake_nodes[EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT];
+static pthread_mutex_t exynos_v4l2_fake_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int exynos_v4l2_fake_formats[] = {
+	V4L2_PIX_FMT_NV21,
+	V4L2_PIX_FMT_NV12,
+	V4L2_PIX_FMT_NV12T,
+	V4L2_PIX_FMT_YUV420,
+	V4L2_PIX_FMT_YUYV,
+	V4L2_PIX_FMT_UYVY,
+	V4L2_PIX_FMT_YUV422P,
+	V4L2_PIX_FMT_RGB565,
+	V4L2_PIX_FMT_JPEG,
+};
+
+/*
+ * Utils
+ */
+
+static struct exynos_v4l2_fake_node *exynos_v4l2_fake_node_find(int fd)
+{
+	int i;
+
+	for (i = 0; i < EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT; i++)
+		if (exynos_v4l2_fake_nodes[i].fd == fd && fd > 0)
+			return &exynos_v4l2_fake_nodes[i];
+
+	return NULL;
+}
+
+static int exynos_v4l2_fake_length(int fmt, int width, int height)
+{
+	switch (fmt) {
+		case V4L2_PIX_FMT_NV21:
+		case V4L2_PIX_FMT_NV12:
+		case V4L2_PIX_FMT_NV12T:
+		case V4L2_PIX_FMT_YUV420:
+			return (width * height * 3) / 2;
+		default:
+			return width * height * 2;
+	}
+}
+
+static int exynos_v4l2_fake_ctrl_get(struct exynos_v4l2_fake_node *node, int id)
+{
+	int i;
+
+	for (i = 0; i < node->ctrls_count; i++)
+		if (node->ctrls[i].id == id)
+			return node->ctrls[i].value;
+
+	return 0;
+}
+
+static void exynos_v4l2_fake_ctrl_set(struct exynos_v4l2_fake_node *node, int id, int value)
+{
+	int i;
+
+	for (i = 0; i < node->ctrls_count; i++) {
+		if (node->ctrls[i].id == id) {
+			node->ctrls[i].value = value;
+			return;
+		}
+	}
+
+	if (node->ctrls_count >= EXYNOS_V4L2_FAKE_CTRLS_MAX)
+		return;
+
+	node->ctrls[node->ctrls_count].id = id;
+	node->ctrls[node->ctrls_count].value = value;
+	node->ctrls_count++;
+}
+
+static void exynos_v4l2_fake_af_init(struct exynos_v4l2_fake_node *node)
+{
+	char property[PROPERTY_VALUE_MAX];
+	char *token;
+	char *saveptr;
+
+	property_get("debug.camera.fake.af", property, "1,1,1,2");
+
+	node->af_results_count = 0;
+
+	token = strtok_r(property, ",", &saveptr);
+	while (token != NULL && node->af_results_count < EXYNOS_V4L2_FAKE_AF_MAX) {
+		node->af_results[node->af_results_count++] = atoi(token);
+		token = strtok_r(NULL, ",", &saveptr);
+	}
+
+	if (node->af_results_count == 0)
+		node->af_results[node->af_results_count++] = M5MO_AF_STATUS_SUCCESS;
+}
+
+static void exynos_v4l2_fake_flush(struct exynos_v4l2_fake_node *node)
+{
+	uint64_t value;
+
+	node->queued_count = 0;
+	node->done_count = 0;
+
+	while (read(node->fd, &value, sizeof(value)) > 0);
+}
+
+/*
+ * Frames
+ */
+
+static void exynos_v4l2_fake_jpeg(struct exynos_v4l2_fake_node *node, unsigned char *data)
+{
+	char property[PROPERTY_VALUE_MAX];
+	int size;
+
+	property_get("debug.camera.fake.jpeg", property, "0");
+	size = atoi(property);
+	if (size <= 0)
+		size = node->length / 8;
+
+	// Main picture first, thumbnail in the second half, like the M5MO
+	node->jpeg_main_offset = 0;
+	node->jpeg_main_size = size < node->length / 2 ? size : node->length / 2;
+	node->jpeg_thumb_offset = node->length / 2;
+	node->jpeg_thumb_size = node->length / 64;
+
+	memset(data + node->jpeg_main_offset, 0x55, node->jpeg_main_size);
+	data[node->jpeg_main_offset] = 0xff;
+	data[node->jpeg_main_offset + 1] = 0xd8;
+	data[node->jpeg_main_offset + node->jpeg_main_size - 2] = 0xff;
+	data[node->jpeg_main_offset + node->jpeg_main_size - 1] = 0xd9;
+
+	memset(data + node->jpeg_thumb_offset, 0x55, node->jpeg_thumb_size);
+	data[node->jpeg_thumb_offset] = 0xff;
+	data[node->jpeg_thumb_offset + 1] = 0xd8;
+	data[node->jpeg_thumb_offset + node->jpeg_thumb_size - 2] = 0xff;
+	data[node->jpeg_thumb_offset + node->jpeg_thumb_size - 1] = 0xd9;
+}
+
+static void exynos_v4l2_fake_frame(struct exynos_v4l2_fake_node *node, int index)
+{
+	unsigned char *data;
+	int luma_size;
+
+	if (node->memory == V4L2_MEMORY_USERPTR)
+		data = (unsigned char *) node->userptrs[index];
+	else if (node->mmap_data != NULL)
+		data = (unsigned char *) node->mmap_data + index * node->length;
+	else
+		data = NULL;
+
+	if (data == NULL)
+		return;
+
+	if (node->fmt == V4L2_PIX_FMT_JPEG) {
+		exynos_v4l2_fake_jpeg(node, data);
+		return;
+	}
+
+	// Flat frame that changes brightness over time, with neutral chroma
+	luma_size = node->width * node->height;
+	if (luma_size > node->length)
+		luma_size = node->length;
+
+	memset(data, (node->sequence * 4) & 0xff, luma_size);
+	memset(data + luma_size, 0x80, node->length - luma_size);
+}
+
+static void *exynos_v4l2_fake_thread(void *data)
+{
+	struct exynos_v4l2_fake_node *node;
+	struct timespec next;
+	uint64_t value = 1;
+	int64_t period;
+	int index;
+
+	node = (struct exynos_v4l2_fake_node *) data;
+
+	clock_gettime(CLOCK_MONOTONIC, &next);
+
+	while (node->streaming) {
+		period = 1000000000LL / (node->fps > 0 ? node->fps : 30);
+
+		next.tv_nsec += period % 1000000000LL;
+		next.tv_sec += period / 1000000000LL + next.tv_nsec / 1000000000L;
+		next.tv_nsec %= 1000000000L;
+
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		pthread_mutex_lock(&node->mutex);
+
+		// No buffer queued means the frame is dropped, like FIMC does
+		if (node->streaming && node->queued_count > 0) {
+			index = node->queued[0];
+			memmove(&node->queued[0], &node->queued[1], --node->queued_count * sizeof(int));
+
+			exynos_v4l2_fake_frame(node, index);
+			node->sequence++;
+
+			// FIMC stamps the buffer with the wall clock once it is written
+			gettimeofday(&node->timestamps[index], NULL);
+
+			node->done[node->done_count++] = index;
+			write(node->fd, &value, sizeof(value));
+		}
+
+		pthread_mutex_unlock(&node->mutex);
+	}
+
+	return NULL;
+}
+
+/*
+ * VIDIOC
+ */
+
+static int exynos_v4l2_fake_reqbufs(struct exynos_v4l2_fake_node *node,
+	struct v4l2_requestbuffers *requestbuffers)
+{
+	int count;
+	int length;
+	int size;
+
+	count = requestbuffers->count;
+	if (count > EXYNOS_V4L2_FAKE_BUFFERS_MAX)
+		count = EXYNOS_V4L2_FAKE_BUFFERS_MAX;
+
+	length = exynos_v4l2_fake_length(node->fmt, node->width, node->height);
+	size = count * length;
+
+	/*
+	 * Like FIMC reserved memory, buffers stay in place as long as they fit.
+	 * A bigger request moves them to a fresh region, at new offsets, so that
+	 * mappings of the previous one go stale like after a real REQBUFS.
+	 */
+	if (size == 0 || requestbuffers->memory != V4L2_MEMORY_MMAP || size > node->mmap_size) {
+		if (node->mmap_data != NULL)
+			munmap(node->mmap_data, node->mmap_size);
+		if (node->mmap_fd > 0)
+			close(node->mmap_fd);
+
+		node->mmap_data = NULL;
+		node->mmap_fd = -1;
+		node->mmap_offset += node->mmap_size;
+		node->mmap_size = 0;
+	}
+
+	node->memory = requestbuffers->memory;
+	node->count = count;
+	node->length = length;
+	exynos_v4l2_fake_flush(node);
+	memset(node->userptrs, 0, sizeof(node->userptrs));
+
+	if (size > 0 && node->memory == V4L2_MEMORY_MMAP && node->mmap_data == NULL) {
+		node->mmap_fd = ashmem_create_region("exynos_v4l2_fake", size);
+		if (node->mmap_fd < 0) {
+			ALOGE("%s: Unable to create ashmem region", __func__);
+			return -1;
+		}
+
+		node->mmap_data = mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_SHARED, node->mmap_fd, 0);
+		if (node->mmap_data == MAP_FAILED) {
+			ALOGE("%s: Unable to map ashmem region", __func__);
+			node->mmap_data = NULL;
+			return -1;
+		}
+
+		node->mmap_size = size;
+	}
+
+	requestbuffers->count = count;
+
+	return 0;
+}
+
+static int exynos_v4l2_fake_qbuf(struct exynos_v4l2_fake_node *node,
+	struct v4l2_buffer *buffer)
+{
+	int index;
+
+	index = buffer->index;
+	if (index < 0 || index >= node->count || node->queued_count >= node->count)
+		return -1;
+
+	if (buffer->memory == V4L2_MEMORY_USERPTR)
+		node->userptrs[index] = (void *) buffer->m.userptr;
+
+	node->queued[node->queued_count++] = index;
+
+	return 0;
+}
+
+static int exynos_v4l2_fake_dqbuf(struct exynos_v4l2_fake_node *node,
+	struct v4l2_buffer *buffer)
+{
+	uint64_t value;
+	int index;
+
+	if (node->done_count == 0) {
+		errno = EAGAIN;
+		return -1;
+	}
+
+	index = node->done[0];
+	memmove(&node->done[0], &node->done[1], --node->done_count * sizeof(int));
+
+	read(node->fd, &value, sizeof(value));
+
+	buffer->index = index;
+	buffer->length = node->length;
+	buffer->bytesused = node->length;
+	buffer->sequence = node->sequence;
+	buffer->timestamp = node->timestamps[index];
+	if (node->memory == V4L2_MEMORY_USERPTR)
+		buffer->m.userptr = (unsigned long) node->userptrs[index];
+
+	return 0;
+}
+
+static int exynos_v4l2_fake_streamon(struct exynos_v4l2_fake_node *node)
+{
+	pthread_attr_t thread_attr;
+	int rc;
+
+	if (node->streaming)
+		return 0;
+
+	node->streaming = 1;
+
+	pthread_attr_init(&thread_attr);
+	pthread_attr_setdetachstate(&thread_attr, PTHREAD_CREATE_JOINABLE);
+
+	rc = pthread_create(&node->thread, &thread_attr, exynos_v4l2_fake_thread, node);
+	if (rc != 0) {
+		ALOGE("%s: Unable to create thread", __func__);
+		node->streaming = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+static void exynos_v4l2_fake_streamoff(struct exynos_v4l2_fake_node *node)
+{
+	if (!node->streaming)
+		return;
+
+	// Called with the node mutex held, the thread needs it to exit
+	node->streaming = 0;
+	pthread_mutex_unlock(&node->mutex);
+	pthread_join(node->thread, NULL);
+	pthread_mutex_lock(&node->mutex);
+
+	// FIMC keeps the filled buffers, the picture is dequeued after streamoff
+	node->queued_count = 0;
+}
+
+static int exynos_v4l2_fake_ctrl(struct exynos_v4l2_fake_node *node, unsigned int request,
+	struct v4l2_control *control)
+{
+	if (request == VIDIOC_S_CTRL) {
+		switch (control->id) {
+			case V4L2_CID_CAMERA_SET_AUTO_FOCUS:
+				if (control->value == AUTO_FOCUS_ON)
+					node->af_index = 0;
+				break;
+			case V4L2_CID_PADDR_Y:
+				control->value = EXYNOS_V4L2_FAKE_PADDR_BASE + control->value * node->length;
+				return 0;
+			case V4L2_CID_PADDR_CBCR:
+				control->value = EXYNOS_V4L2_FAKE_PADDR_BASE + control->value * node->length +
+					node->width * node->height;
+				return 0;
+		}
+
+		exynos_v4l2_fake_ctrl_set(node, control->id, control->value);
+		return 0;
+	}
+
+	switch (control->id) {
+		case V4L2_CID_CAMERA_AUTO_FOCUS_RESULT:
+			control->value = node->af_results[node->af_index];
+			if (node->af_index < node->af_results_count - 1)
+				node->af_index++;
+			break;
+		case V4L2_CID_CAM_JPEG_MAIN_SIZE:
+			control->value = node->jpeg_main_size;
+			break;
+		case V4L2_CID_CAM_JPEG_MAIN_OFFSET:
+			control->value = node->jpeg_main_offset;
+			break;
+		case V4L2_CID_CAM_JPEG_THUMB_SIZE:
+			control->value = node->jpeg_thumb_size;
+			break;
+		case V4L2_CID_CAM_JPEG_THUMB_OFFSET:
+			control->value = node->jpeg_thumb_offset;
+			break;
+		default:
+			control->value = exynos_v4l2_fake_ctrl_get(node, control->id);
+			break;
+	}
+
+	return 0;
+}
+
+static int exynos_v4l2_fake_ext_ctrls(struct exynos_v4l2_fake_node *node, unsigned int request,
+	struct v4l2_ext_controls *controls)
+{
+	struct v4l2_control control;
+	unsigned int i;
+
+	// Like the kernel, only one non-private class per call
+	if (request == VIDIOC_S_EXT_CTRLS) {
+		for (i = 0; i < controls->count; i++) {
+			if (controls->ctrl_class == V4L2_CTRL_ID2CLASS(V4L2_CID_PRIVATE_BASE) ||
+				V4L2_CTRL_ID2CLASS(controls->controls[i].id) != controls->ctrl_class) {
+				controls->error_idx = i;
+				errno = EINVAL;
+				return -1;
+			}
+		}
+	}
+
+	for (i = 0; i < controls->count; i++) {
+		if (request == VIDIOC_G_EXT_CTRLS &&
+			controls->controls[i].id == V4L2_CID_CAM_SENSOR_FW_VER) {
+			if (controls->controls[i].string != NULL)
+				strcpy(controls->controls[i].string, "FAKE");
+			continue;
+		}
+
+		control.id = controls->controls[i].id;
+		control.value = controls->controls[i].value;
+
+		exynos_v4l2_fake_ctrl(node, request == VIDIOC_S_EXT_CTRLS ? VIDIOC_S_CTRL : VIDIOC_G_CTRL,
+			&control);
+
+		controls->controls[i].value = control.value;
+	}
+
+	return 0;
+}
+
+/*
+ * Ops
+ */
+
+static int exynos_v4l2_fake_open(int exynos_v4l2_id, const char *node_path)
+{
+	struct exynos_v4l2_fake_node *node = NULL;
+	char property[PROPERTY_VALUE_MAX];
+	int i;
+
+	pthread_mutex_lock(&exynos_v4l2_fake_mutex);
+
+	for (i = 0; i < EXYNOS_CAMERA_MAX_V4L2_NODES_COUNT; i++) {
+		if (exynos_v4l2_fake_nodes[i].fd <= 0) {
+			node = &exynos_v4l2_fake_nodes[i];
+			break;
+		}
+	}
+
+	if (node == NULL) {
+		pthread_mutex_unlock(&exynos_v4l2_fake_mutex);
+		return -1;
+	}
+
+	memset(node, 0, sizeof(struct exynos_v4l2_fake_node));
+	node->exynos_v4l2_id = exynos_v4l2_id;
+	node->mmap_fd = -1;
+
+	property_get("debug.camera.fake.fps", property, "30");
+	node->fps = atoi(property);
+
+	exynos_v4l2_fake_af_init(node);
+	pthread_mutex_init(&node->mutex, NULL);
+
+	node->fd = eventfd(0, EFD_NONBLOCK | EFD_SEMAPHORE);
+
+	pthread_mutex_unlock(&exynos_v4l2_fake_mutex);
+
+	ALOGD("%s: Faking %s as v4l2 node #%d", __func__, node_path, exynos_v4l2_id);
+
+	return node->fd;
+}
+
+static void exynos_v4l2_fake_close(int fd)
+{
+	struct exynos_v4l2_fake_node *node;
+
+	pthread_mutex_lock(&exynos_v4l2_fake_mutex);
+
+	node = exynos_v4l2_fake_node_find(fd);
+	if (node == NULL) {
+		pthread_mutex_unlock(&exynos_v4l2_fake_mutex);
+		return;
+	}
+
+	pthread_mutex_lock(&node->mutex);
+	exynos_v4l2_fake_streamoff(node);
+
+	if (node->mmap_data != NULL)
+		munmap(node->mmap_data, node->mmap_size);
+	if (node->mmap_fd > 0)
+		close(node->mmap_fd);
+
+	close(node->fd);
+	node->fd = -1;
+	pthread_mutex_unlock(&node->mutex);
+
+	pthread_mutex_destroy(&node->mutex);
+
+	pthread_mutex_unlock(&exynos_v4l2_fake_mutex);
+}
+
+static int exynos_v4l2_fake_ioctl(int fd, int request, void *data)
+{
+	struct exynos_v4l2_fake_node *node;
+	struct v4l2_capability *cap;
+	struct v4l2_input *input;
+	struct v4l2_fmtdesc *fmtdesc;
+	struct v4l2_format *format;
+	struct v4l2_buffer *buffer;
+	struct v4l2_streamparm *streamparm;
+	int rc = 0;
+
+	node = exynos_v4l2_fake_node_find(fd);
+	if (node == NULL || data == NULL) {
+		errno = EBADF;
+		return -1;
+	}
+
+	pthread_mutex_lock(&node->mutex);
+
+	switch (request) {
+		case VIDIOC_QUERYCAP:
+			cap = (struct v4l2_capability *) data;
+			memset(cap, 0, sizeof(struct v4l2_capability));
+			strcpy((char *) cap->driver, "exynos_v4l2_fake");
+			cap->capabilities = V4L2_CAP_VIDEO_CAPTURE | V4L2_CAP_VIDEO_OUTPUT |
+				V4L2_CAP_STREAMING;
+			break;
+		case VIDIOC_ENUMINPUT:
+			input = (struct v4l2_input *) data;
+			snprintf((char *) input->name, sizeof(input->name), "fake%d", input->index);
+			break;
+		case VIDIOC_ENUM_FMT:
+			fmtdesc = (struct v4l2_fmtdesc *) data;
+			if (fmtdesc->index >= sizeof(exynos_v4l2_fake_formats) / sizeof(int)) {
+				errno = EINVAL;
+				rc = -1;
+				break;
+			}
+			fmtdesc->pixelformat = exynos_v4l2_fake_formats[fmtdesc->index];
+			break;
+		case VIDIOC_S_FMT:
+			format = (struct v4l2_format *) data;
+			node->width = format->fmt.pix.width;
+			node->height = format->fmt.pix.height;
+			node->fmt = format->fmt.pix.pixelformat;
+			// Fall through
+		case VIDIOC_G_FMT:
+			format = (struct v4l2_format *) data;
+			format->fmt.pix.width = node->width;
+			format->fmt.pix.height = node->height;
+			format->fmt.pix.pixelformat = node->fmt;
+			format->fmt.pix.sizeimage = exynos_v4l2_fake_length(node->fmt,
+				node->width, node->height);
+			break;
+		case VIDIOC_REQBUFS:
+			rc = exynos_v4l2_fake_reqbufs(node, (struct v4l2_requestbuffers *) data);
+			break;
+		case VIDIOC_QUERYBUF:
+			buffer = (struct v4l2_buffer *) data;
+			if ((int) buffer->index >= node->count) {
+				errno = EINVAL;
+				rc = -1;
+				break;
+			}
+			buffer->length = node->length;
+			buffer->m.offset = node->mmap_offset + buffer->index * node->length;
+			break;
+		case VIDIOC_QBUF:
+			rc = exynos_v4l2_fake_qbuf(node, (struct v4l2_buffer *) data);
+			break;
+		case VIDIOC_DQBUF:
+			rc = exynos_v4l2_fake_dqbuf(node, (struct v4l2_buffer *) data);
+			break;
+		case VIDIOC_STREAMON:
+			rc = exynos_v4l2_fake_streamon(node);
+			break;
+		case VIDIOC_STREAMOFF:
+			exynos_v4l2_fake_streamoff(node);
+			break;
+		case VIDIOC_S_PARM:
+			streamparm = (struct v4l2_streamparm *) data;
+			if (streamparm->parm.capture.timeperframe.numerator > 0)
+				node->fps = streamparm->parm.capture.timeperframe.denominator /
+					streamparm->parm.capture.timeperframe.numerator;
+			break;
+		case VIDIOC_G_CTRL:
+		case VIDIOC_S_CTRL:
+			rc = exynos_v4l2_fake_ctrl(node, request, (struct v4l2_control *) data);
+			break;
+		case VIDIOC_G_EXT_CTRLS:
+		case VIDIOC_S_EXT_CTRLS:
+			rc = exynos_v4l2_fake_ext_ctrls(node, request, (struct v4l2_ext_controls *) data);
+			break;
+		default:
+			// S_INPUT, S_CROP and the framebuffer ioctls have nothing to fake
+			break;
+	}
+
+	pthread_mutex_unlock(&node->mutex);
+
+	return rc;
+}
+
+static int exynos_v4l2_fake_mmap_fd(int fd)
+{
+	struct exynos_v4l2_fake_node *node;
+
+	node = exynos_v4l2_fake_node_find(fd);
+	if (node == NULL)
+		return -1;
+
+	return node->mmap_fd;
+}
+
+struct exynos_v4l2_ops exynos_v4l2_fake_ops = {
+	.open = exynos_v4l2_fake_open,
+	.close = exynos_v4l2_fake_close,
+	.ioctl = exynos_v4l2_fake_ioctl,
+	.mmap_fd = exynos_v4l2_fake_mmap_fd,
+};